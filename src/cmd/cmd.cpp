@@ -24,6 +24,7 @@
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QNetworkProxy>
+#include <QSocketNotifier>
 #include <qdebug.h>
 
 #include "account.h"
@@ -36,11 +37,14 @@
 #include "simplesslerrorhandler.h"
 #include "syncengine.h"
 #include "common/syncjournaldb.h"
+#include "common/tracer.h"
 #include "config.h"
 #include "csync_exclude.h"
 
 
 #include "cmd.h"
+#include "syncdaemon.h"
+#include "syncstats.h"
 
 #include "theme.h"
 #include "netrcparser.h"
@@ -51,6 +55,10 @@
 #ifdef Q_OS_WIN32
 #include <windows.h>
 #else
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <sys/socket.h>
 #include <termios.h>
 #include <unistd.h>
 #endif
@@ -81,6 +89,17 @@ struct CmdOptions
     int restartTimes;
     int downlimit;
     int uplimit;
+    bool watch;
+    int pollInterval;
+    int metricsInterval;
+    int parallelJobs;
+    qint64 chunkSize;
+    qint64 minChunkSize;
+    qint64 maxChunkSize;
+    int targetChunkUploadDuration;
+    int bulkUploadBatchSize;
+    QString checksumType;
+    QString statsFile;
 };
 
 // we can't use csync_set_userdata because the SyncEngine sets it already.
@@ -193,7 +212,19 @@ void help()
     std::cout << "  -h                     Sync hidden files, do not ignore them" << std::endl;
     std::cout << "  --version, -v          Display version and exit" << std::endl;
     std::cout << "  --logdebug             More verbose logging" << std::endl;
+    std::cout << "  --tracefile [file]     Record sync timings in Chrome trace format to [file]" << std::endl;
     std::cout << "  --path                 Path to a folder on a remote server" << std::endl;
+    std::cout << "  --max-parallel [n]     Run at most n network jobs in parallel (default 6)" << std::endl;
+    std::cout << "  --chunk-size [n]       Initial upload chunk size in bytes" << std::endl;
+    std::cout << "  --min-chunk-size [n]   Minimum upload chunk size in bytes" << std::endl;
+    std::cout << "  --max-chunk-size [n]   Maximum upload chunk size in bytes" << std::endl;
+    std::cout << "  --target-chunk-upload-duration [ms]  Target duration of a chunk upload, 0 disables dynamic chunk sizing" << std::endl;
+    std::cout << "  --bulk-upload-batch-size [n]  Files per bulk upload request, 0 disables bulk upload (default 100)" << std::endl;
+    std::cout << "  --checksum-type [type] Checksum type used for uploads, e.g. SHA1, MD5 or Adler32" << std::endl;
+    std::cout << "  --stats-file [file]    Write a JSON report of the sync to [file], - for stdout" << std::endl;
+    std::cout << "  --watch                Keep running and sync whenever local or remote changes are detected" << std::endl;
+    std::cout << "  --poll-interval [s]    In watch mode, check for remote changes every s seconds (default 30)" << std::endl;
+    std::cout << "  --metrics-interval [s] In watch mode, print metrics every s seconds, 0 disables (default 60)" << std::endl;
     std::cout << "" << std::endl;
     exit(0);
 }
@@ -270,8 +301,34 @@ void parseOptions(const QStringList &app_args, CmdOptions *options)
         } else if (option == "--logdebug") {
             Logger::instance()->setLogFile("-");
             Logger::instance()->setLogDebug(true);
+        } else if (option == "--tracefile" && !it.peekNext().startsWith("-")) {
+            OCC::Tracer::instance()->start(it.next());
         } else if (option == "--path" && !it.peekNext().startsWith("-")) {
             options->remotePath = it.next();
+        } else if (option == "--max-parallel" && !it.peekNext().startsWith("-")) {
+            options->parallelJobs = it.next().toInt();
+        } else if (option == "--chunk-size" && !it.peekNext().startsWith("-")) {
+            options->chunkSize = it.next().toLongLong();
+        } else if (option == "--min-chunk-size" && !it.peekNext().startsWith("-")) {
+            options->minChunkSize = it.next().toLongLong();
+        } else if (option == "--max-chunk-size" && !it.peekNext().startsWith("-")) {
+            options->maxChunkSize = it.next().toLongLong();
+        } else if (option == "--target-chunk-upload-duration" && !it.peekNext().startsWith("-")) {
+            options->targetChunkUploadDuration = it.next().toInt();
+        } else if (option == "--bulk-upload-batch-size" && !it.peekNext().startsWith("-")) {
+            options->bulkUploadBatchSize = it.next().toInt();
+        } else if (option == "--checksum-type" && !it.peekNext().startsWith("-")) {
+            options->checksumType = it.next();
+        } else if (option == "--stats-file" && !it.peekNext().startsWith("-")) {
+            options->statsFile = it.next();
+        } else if (option == "--stats-file" && it.peekNext() == QLatin1String("-")) {
+            options->statsFile = it.next();
+        } else if (option == "--watch") {
+            options->watch = true;
+        } else if (option == "--poll-interval" && !it.peekNext().startsWith("-")) {
+            options->pollInterval = it.next().toInt();
+        } else if (option == "--metrics-interval" && !it.peekNext().startsWith("-")) {
+            options->metricsInterval = it.next().toInt();
         }
         else {
             help();
@@ -308,6 +365,50 @@ void selectiveSyncFixup(OCC::SyncJournalDb *journal, const QStringList &newList)
     }
 }
 
+#ifndef Q_OS_WIN
+static int terminationSignalFd[2];
+
+static void terminationSignalHandler(int)
+{
+    char signalByte = 1;
+    // Only async-signal-safe calls are allowed here, the event loop picks it up.
+    // If the write fails a byte is already pending, which is just as good.
+    const auto savedErrno = errno;
+    if (::write(terminationSignalFd[0], &signalByte, sizeof(signalByte)) < 0) {
+        errno = savedErrno;
+    }
+}
+#endif
+
+/* Quit the event loop on SIGINT/SIGTERM so the watch mode can save its state */
+void installQuitOnTerminationSignals(QCoreApplication *app)
+{
+#ifndef Q_OS_WIN
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, terminationSignalFd) != 0) {
+        qWarning() << "Could not create the termination signal socket pair";
+        return;
+    }
+    auto notifier = new QSocketNotifier(terminationSignalFd[1], QSocketNotifier::Read, app);
+    QObject::connect(notifier, &QSocketNotifier::activated, app, [app, notifier] {
+        notifier->setEnabled(false);
+        char signalByte = 0;
+        if (::read(terminationSignalFd[1], &signalByte, sizeof(signalByte)) != sizeof(signalByte)) {
+            qWarning() << "Could not read from the termination signal socket:" << strerror(errno);
+        }
+        app->quit();
+    });
+
+    struct sigaction action = {};
+    action.sa_handler = terminationSignalHandler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+#else
+    Q_UNUSED(app);
+#endif
+}
+
 int main(int argc, char **argv)
 {
 #ifdef Q_OS_WIN
@@ -330,6 +431,15 @@ int main(int argc, char **argv)
     options.restartTimes = 3;
     options.uplimit = 0;
     options.downlimit = 0;
+    options.watch = false;
+    options.pollInterval = 30;
+    options.metricsInterval = 60;
+    options.parallelJobs = -1;
+    options.chunkSize = -1;
+    options.minChunkSize = -1;
+    options.maxChunkSize = -1;
+    options.targetChunkUploadDuration = -1;
+    options.bulkUploadBatchSize = -1;
 
     parseOptions(app.arguments(), &options);
 
@@ -471,6 +581,13 @@ int main(int argc, char **argv)
     // much lower age than the default since this utility is usually made to be run right after a change in the tests
     SyncEngine::minimumFileAgeForUpload = std::chrono::milliseconds(0);
 
+    if (!options.checksumType.isEmpty()) {
+        qputenv("OWNCLOUD_CONTENT_CHECKSUM_TYPE", options.checksumType.toUtf8());
+    }
+
+    SyncStats stats;
+    stats.watchNetworkAccessManager(account->networkAccessManager());
+
     int restartCount = 0;
 restart_sync:
 
@@ -503,12 +620,48 @@ restart_sync:
 
     SyncOptions opt;
     opt.fillFromEnvironmentVariables();
+    // Command line options take precedence over the environment
+    if (options.parallelJobs > 0)
+        opt._parallelNetworkJobs = options.parallelJobs;
+    if (options.chunkSize > 0)
+        opt._initialChunkSize = options.chunkSize;
+    if (options.minChunkSize > 0)
+        opt._minChunkSize = options.minChunkSize;
+    if (options.maxChunkSize > 0)
+        opt._maxChunkSize = options.maxChunkSize;
+    if (options.targetChunkUploadDuration >= 0)
+        opt._targetChunkUploadDuration = std::chrono::milliseconds(options.targetChunkUploadDuration);
+    if (options.bulkUploadBatchSize >= 0)
+        opt._bulkUploadBatchSize = options.bulkUploadBatchSize;
+    if (opt._bulkUploadBatchSize < 0) {
+        std::cerr << "The bulk upload batch size must not be negative." << std::endl;
+        return EXIT_FAILURE;
+    }
     opt.verifyChunkSizes();
+
+    if (!options.statsFile.isEmpty()) {
+        QJsonObject configuration;
+        configuration.insert(QStringLiteral("parallelNetworkJobs"), opt._parallelNetworkJobs);
+        configuration.insert(QStringLiteral("initialChunkSize"), opt._initialChunkSize);
+        configuration.insert(QStringLiteral("minChunkSize"), opt._minChunkSize);
+        configuration.insert(QStringLiteral("maxChunkSize"), opt._maxChunkSize);
+        configuration.insert(QStringLiteral("targetChunkUploadDurationMs"), static_cast<qint64>(opt._targetChunkUploadDuration.count()));
+        configuration.insert(QStringLiteral("bulkUploadBatchSize"), opt._bulkUploadBatchSize);
+        configuration.insert(QStringLiteral("bulkUploadAvailable"), account->capabilities().bulkUpload());
+        configuration.insert(QStringLiteral("checksumType"), QString::fromUtf8(account->capabilities().uploadChecksumType()));
+        configuration.insert(QStringLiteral("uploadLimit"), options.uplimit);
+        configuration.insert(QStringLiteral("downloadLimit"), options.downlimit);
+        stats.setConfiguration(configuration);
+    }
+
     SyncEngine engine(account, options.source_dir, opt, folder, &db);
+    stats.watchEngine(&engine);
     engine.setIgnoreHiddenFiles(options.ignoreHiddenFiles);
     engine.setNetworkLimits(options.uplimit, options.downlimit);
-    QObject::connect(&engine, &SyncEngine::finished,
-        [&app](bool result) { app.exit(result ? EXIT_SUCCESS : EXIT_FAILURE); });
+    if (!options.watch) {
+        QObject::connect(&engine, &SyncEngine::finished,
+            [&app](bool result) { app.exit(result ? EXIT_SUCCESS : EXIT_FAILURE); });
+    }
     QObject::connect(&engine, &SyncEngine::transmissionProgress, &cmd, &Cmd::transmissionProgressSlot);
     QObject::connect(&engine, &SyncEngine::syncError,
         [](const QString &error) { qWarning() << "Sync error:" << error; });
@@ -533,6 +686,20 @@ restart_sync:
         return EXIT_FAILURE;
     }
 
+    if (options.watch) {
+        SyncDaemon::Settings settings;
+        settings.pollInterval = std::chrono::seconds(qMax(1, options.pollInterval));
+        settings.metricsInterval = std::chrono::seconds(qMax(0, options.metricsInterval));
+        SyncDaemon daemon(account, &engine, &db, options.source_dir, folder, settings);
+        QObject::connect(&app, &QCoreApplication::aboutToQuit, &daemon, &SyncDaemon::shutdown);
+        installQuitOnTerminationSignals(&app);
+        daemon.start();
+        const int watchResultCode = app.exec();
+        if (!options.statsFile.isEmpty()) {
+            stats.writeReport(options.statsFile);
+        }
+        return watchResultCode;
+    }
 
     // Have to be done async, else, an error before exec() does not terminate the event loop.
     QMetaObject::invokeMethod(&engine, "startSync", Qt::QueuedConnection);
@@ -548,5 +715,9 @@ restart_sync:
         qWarning() << "Another sync is needed, but not done because restart count is exceeded" << restartCount;
     }
 
+    if (!options.statsFile.isEmpty()) {
+        stats.writeReport(options.statsFile);
+    }
+
     return resultCode;
 }
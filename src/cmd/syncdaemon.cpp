@@ -0,0 +1,280 @@
+/*
+ * Copyright (C) by Nextcloud GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "syncdaemon.h"
+
+#include "account.h"
+#include "capabilities.h"
+#include "csync_exclude.h"
+#include "localdiscoverytracker.h"
+#include "networkjobs.h"
+#include "pushnotifications.h"
+#include "syncengine.h"
+#include "common/syncjournaldb.h"
+
+#ifdef Q_OS_LINUX
+#include "folderwatcher.h"
+#endif
+
+#include <QLoggingCategory>
+
+#include <iostream>
+
+namespace OCC {
+
+Q_LOGGING_CATEGORY(lcSyncDaemon, "nextcloud.cmd.daemon", QtInfoMsg)
+
+SyncDaemon::SyncDaemon(AccountPtr account, SyncEngine *engine, SyncJournalDb *journal,
+    const QString &localPath, const QString &remotePath, const Settings &settings, QObject *parent)
+    : QObject(parent)
+    , _account(std::move(account))
+    , _engine(engine)
+    , _journal(journal)
+    , _localPath(localPath)
+    , _remotePath(remotePath)
+    , _settings(settings)
+    , _localDiscoveryTracker(new LocalDiscoveryTracker)
+{
+    connect(_engine, &SyncEngine::finished, _localDiscoveryTracker.data(), &LocalDiscoveryTracker::slotSyncFinished);
+    connect(_engine, &SyncEngine::itemCompleted, _localDiscoveryTracker.data(), &LocalDiscoveryTracker::slotItemCompleted);
+    connect(_engine, &SyncEngine::itemCompleted, this, [this] { ++_itemCount; });
+    connect(_engine, &SyncEngine::finished, this, &SyncDaemon::slotSyncFinished);
+    connect(_engine, &SyncEngine::rootEtag, this, &SyncDaemon::slotRootEtagFromSync);
+
+    _pollTimer.setInterval(_settings.pollInterval);
+    connect(&_pollTimer, &QTimer::timeout, this, &SyncDaemon::slotPollRemote);
+
+    _metricsTimer.setInterval(_settings.metricsInterval);
+    connect(&_metricsTimer, &QTimer::timeout, this, &SyncDaemon::slotPrintMetrics);
+
+    _scheduleTimer.setSingleShot(true);
+    _scheduleTimer.setInterval(_settings.localChangeDelay);
+    connect(&_scheduleTimer, &QTimer::timeout, this, &SyncDaemon::scheduleSync);
+}
+
+SyncDaemon::~SyncDaemon() = default;
+
+void SyncDaemon::start()
+{
+    _uptime.start();
+
+#ifdef Q_OS_LINUX
+    _folderWatcher.reset(new FolderWatcher);
+    connect(_folderWatcher.data(), &FolderWatcher::pathChanged, this, &SyncDaemon::slotPathChanged);
+    connect(_folderWatcher.data(), &FolderWatcher::lostChanges, this, &SyncDaemon::slotNextSyncFullLocalDiscovery);
+    connect(_folderWatcher.data(), &FolderWatcher::becameUnreliable, this, &SyncDaemon::slotWatcherUnreliable);
+    _folderWatcher->init(_localPath);
+
+    // Changes made while the daemon was not running are picked up from the
+    // state saved at the last clean shutdown, which is as good as a full local discovery.
+    if (_localDiscoveryTracker->restoreFromJournal(_journal, _localPath, &_fullLocalDiscoveryAgeAtStart)) {
+        _timeSinceLastFullLocalDiscovery.start();
+        _fullLocalDiscoveryRequested = false;
+    }
+#else
+    qCInfo(lcSyncDaemon) << "No file system watcher available, every sync does a full local discovery";
+#endif
+
+    connect(_account.data(), &Account::pushNotificationsReady, this, &SyncDaemon::slotPushNotificationsReady);
+    _account->trySetupPushNotifications();
+
+    _pollTimer.start();
+    if (_settings.metricsInterval.count() > 0) {
+        _metricsTimer.start();
+    }
+    scheduleSync();
+}
+
+void SyncDaemon::shutdown()
+{
+    _pollTimer.stop();
+    _scheduleTimer.stop();
+    _localDiscoveryTracker->persistToJournal(_journal,
+        watcherIsReliable() && !_fullLocalDiscoveryRequested && _timeSinceLastFullLocalDiscovery.isValid(),
+        _fullLocalDiscoveryAgeAtStart + std::chrono::milliseconds(_timeSinceLastFullLocalDiscovery.elapsed()));
+    slotPrintMetrics();
+}
+
+bool SyncDaemon::watcherIsReliable() const
+{
+#ifdef Q_OS_LINUX
+    return _folderWatcher && _folderWatcher->isReliable();
+#else
+    return false;
+#endif
+}
+
+void SyncDaemon::scheduleSync()
+{
+    if (_engine->isSyncRunning()) {
+        _syncPending = true;
+        return;
+    }
+    // Have to be done async, like the single pass mode does
+    QMetaObject::invokeMethod(this, "startSync", Qt::QueuedConnection);
+}
+
+void SyncDaemon::startSync()
+{
+    if (_engine->isSyncRunning()) {
+        _syncPending = true;
+        return;
+    }
+    _syncPending = false;
+    _scheduleTimer.stop();
+
+    // Files that were just touched are propagated first
+    _engine->setPriorityPaths(_localDiscoveryTracker->localDiscoveryPaths());
+
+    const auto interval = _settings.fullLocalDiscoveryInterval;
+    const bool periodicFullLocalDiscoveryNow = interval.count() >= 0
+        && _timeSinceLastFullLocalDiscovery.isValid()
+        && _fullLocalDiscoveryAgeAtStart.count() + _timeSinceLastFullLocalDiscovery.elapsed() > interval.count();
+    if (watcherIsReliable() && !_fullLocalDiscoveryRequested
+        && _timeSinceLastFullLocalDiscovery.isValid() && !periodicFullLocalDiscoveryNow) {
+        qCInfo(lcSyncDaemon) << "Starting sync with partial local discovery of"
+                             << _localDiscoveryTracker->localDiscoveryPaths().size() << "paths";
+        _engine->setLocalDiscoveryOptions(LocalDiscoveryStyle::DatabaseAndFilesystem,
+            _localDiscoveryTracker->localDiscoveryPaths());
+        _localDiscoveryTracker->startSyncPartialDiscovery();
+        ++_partialDiscoveryCount;
+    } else {
+        qCInfo(lcSyncDaemon) << "Starting sync with full local discovery";
+        _engine->setLocalDiscoveryOptions(LocalDiscoveryStyle::FilesystemOnly);
+        _localDiscoveryTracker->startSyncFullDiscovery();
+    }
+
+    _syncDuration.start();
+    _engine->startSync();
+}
+
+void SyncDaemon::slotSyncFinished(bool success)
+{
+    _lastSyncDurationMs = _syncDuration.elapsed();
+    ++_syncCount;
+    if (!success) {
+        ++_failedSyncCount;
+    }
+    if (_engine->lastLocalDiscoveryStyle() == LocalDiscoveryStyle::FilesystemOnly && success) {
+        _timeSinceLastFullLocalDiscovery.start();
+        _fullLocalDiscoveryAgeAtStart = {};
+        _fullLocalDiscoveryRequested = false;
+    }
+    qCInfo(lcSyncDaemon) << "Sync finished, success:" << success << "duration:" << _lastSyncDurationMs << "ms";
+
+    if (_syncPending || _engine->isAnotherSyncNeeded() != NoFollowUpSync) {
+        scheduleSync();
+    }
+}
+
+void SyncDaemon::slotPathChanged(const QString &path)
+{
+    if (!path.startsWith(_localPath)) {
+        return;
+    }
+    if (_engine->excludedFiles().isExcluded(path, _localPath, _engine->ignoreHiddenFiles())) {
+        return;
+    }
+
+    // Record the path before checking for our own changes so nothing is missed
+    _localDiscoveryTracker->addTouchedPath(path.mid(_localPath.size()));
+
+    if (_engine->wasFileTouched(path)) {
+        qCDebug(lcSyncDaemon) << "Changed path was touched by SyncEngine, ignoring:" << path;
+        return;
+    }
+
+    ++_localChangeCount;
+    if (_engine->isSyncRunning()) {
+        _syncPending = true;
+    } else if (!_scheduleTimer.isActive()) {
+        _scheduleTimer.start();
+    }
+}
+
+void SyncDaemon::slotNextSyncFullLocalDiscovery()
+{
+    _fullLocalDiscoveryRequested = true;
+    scheduleSync();
+}
+
+void SyncDaemon::slotWatcherUnreliable(const QString &message)
+{
+    qCWarning(lcSyncDaemon) << "File system watcher is unreliable, falling back to full local discovery:" << message;
+    slotNextSyncFullLocalDiscovery();
+}
+
+void SyncDaemon::slotPollRemote()
+{
+    // Push notifications make polling unnecessary
+    const auto pushNotifications = _account->pushNotifications();
+    if ((_account->capabilities().availablePushNotifications() & PushNotificationType::Files)
+        && pushNotifications && pushNotifications->isReady()) {
+        return;
+    }
+    if (_requestEtagJob || _engine->isSyncRunning()) {
+        return;
+    }
+
+    _requestEtagJob = new RequestEtagJob(_account, _remotePath, this);
+    _requestEtagJob->setTimeout(60 * 1000);
+    connect(_requestEtagJob.data(), &RequestEtagJob::etagRetrieved, this, &SyncDaemon::slotEtagRetrieved);
+    _requestEtagJob->start();
+}
+
+void SyncDaemon::slotEtagRetrieved(const QByteArray &etag)
+{
+    if (_lastEtag != etag) {
+        qCInfo(lcSyncDaemon) << "Root etag changed from" << _lastEtag << "to" << etag;
+        _lastEtag = etag;
+        ++_remoteChangeCount;
+        scheduleSync();
+    }
+}
+
+void SyncDaemon::slotRootEtagFromSync(const QByteArray &etag)
+{
+    _lastEtag = etag;
+}
+
+void SyncDaemon::slotPushNotificationsReady(Account *account)
+{
+    if (!(account->capabilities().availablePushNotifications() & PushNotificationType::Files)) {
+        return;
+    }
+    qCInfo(lcSyncDaemon) << "Push notifications ready, remote polling is paused";
+    connect(account->pushNotifications(), &PushNotifications::filesChanged, this, &SyncDaemon::slotRemoteFilesChanged, Qt::UniqueConnection);
+}
+
+void SyncDaemon::slotRemoteFilesChanged()
+{
+    ++_remoteChangeCount;
+    scheduleSync();
+}
+
+void SyncDaemon::slotPrintMetrics()
+{
+    std::cout << "uptime_s=" << _uptime.elapsed() / 1000
+              << " syncs=" << _syncCount
+              << " failed=" << _failedSyncCount
+              << " partial_discoveries=" << _partialDiscoveryCount
+              << " items=" << _itemCount
+              << " local_changes=" << _localChangeCount
+              << " remote_changes=" << _remoteChangeCount
+              << " last_sync_ms=" << _lastSyncDurationMs
+              << " watcher_reliable=" << (watcherIsReliable() ? 1 : 0)
+              << std::endl;
+}
+
+} // namespace OCC
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) by Nextcloud GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#ifndef SYNCDAEMON_H
+#define SYNCDAEMON_H
+
+#include "accountfwd.h"
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QPointer>
+#include <QScopedPointer>
+#include <QTimer>
+
+#include <chrono>
+
+namespace OCC {
+
+class Account;
+class FolderWatcher;
+class LocalDiscoveryTracker;
+class RequestEtagJob;
+class SyncEngine;
+class SyncJournalDb;
+
+/**
+ * @brief Keeps a folder in sync until the process is asked to quit
+ *
+ * Used by the --watch mode of the command line client. The journal and the
+ * engine stay alive between runs. Local changes are picked up by the file
+ * system watcher where one is available, so most runs only need a partial
+ * local discovery. Remote changes are detected by polling the root etag and,
+ * when the server supports it, through push notifications.
+ *
+ * @ingroup cmd
+ */
+class SyncDaemon : public QObject
+{
+    Q_OBJECT
+public:
+    struct Settings
+    {
+        /// How often the root etag is polled for remote changes
+        std::chrono::milliseconds pollInterval = std::chrono::seconds(30);
+
+        /// How often a full local discovery is done even with a reliable watcher, negative disables it
+        std::chrono::milliseconds fullLocalDiscoveryInterval = std::chrono::hours(1);
+
+        /// How often metrics are printed, 0 disables it
+        std::chrono::milliseconds metricsInterval = std::chrono::minutes(1);
+
+        /// Delay between a local change and the sync it triggers, so bursts of changes are handled together
+        std::chrono::milliseconds localChangeDelay = std::chrono::seconds(2);
+    };
+
+    SyncDaemon(AccountPtr account, SyncEngine *engine, SyncJournalDb *journal,
+        const QString &localPath, const QString &remotePath, const Settings &settings, QObject *parent = nullptr);
+    ~SyncDaemon() override;
+
+    void start();
+
+public slots:
+    /// Saves the local discovery state so the next start can skip the full local discovery
+    void shutdown();
+
+private slots:
+    void scheduleSync();
+    void startSync();
+    void slotSyncFinished(bool success);
+    void slotPathChanged(const QString &path);
+    void slotNextSyncFullLocalDiscovery();
+    void slotWatcherUnreliable(const QString &message);
+    void slotPollRemote();
+    void slotEtagRetrieved(const QByteArray &etag);
+    void slotRootEtagFromSync(const QByteArray &etag);
+    void slotPushNotificationsReady(Account *account);
+    void slotRemoteFilesChanged();
+    void slotPrintMetrics();
+
+private:
+    bool watcherIsReliable() const;
+
+    AccountPtr _account;
+    SyncEngine *_engine;
+    SyncJournalDb *_journal;
+    QString _localPath;
+    QString _remotePath;
+    Settings _settings;
+
+    QScopedPointer<LocalDiscoveryTracker> _localDiscoveryTracker;
+#ifdef Q_OS_LINUX
+    QScopedPointer<FolderWatcher> _folderWatcher;
+#endif
+    QPointer<RequestEtagJob> _requestEtagJob;
+    QTimer _pollTimer;
+    QTimer _metricsTimer;
+    QTimer _scheduleTimer;
+    QByteArray _lastEtag;
+    QElapsedTimer _timeSinceLastFullLocalDiscovery;
+    // Age of the last full local discovery when the timer above was started,
+    // only non-zero when it was restored from the journal
+    std::chrono::milliseconds _fullLocalDiscoveryAgeAtStart{0};
+    bool _syncPending = false;
+    bool _fullLocalDiscoveryRequested = true;
+
+    // metrics
+    QElapsedTimer _uptime;
+    QElapsedTimer _syncDuration;
+    qint64 _lastSyncDurationMs = 0;
+    int _syncCount = 0;
+    int _failedSyncCount = 0;
+    int _partialDiscoveryCount = 0;
+    int _localChangeCount = 0;
+    int _remoteChangeCount = 0;
+    int _itemCount = 0;
+};
+
+} // namespace OCC
+
+#endif
@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) by Nextcloud GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "syncstats.h"
+#include "syncengine.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QJsonDocument>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+
+namespace OCC {
+
+SyncStats::SyncStats(QObject *parent)
+    : QObject(parent)
+{
+    _total.start();
+}
+
+void SyncStats::watchEngine(SyncEngine *engine)
+{
+    connect(engine, &SyncEngine::started, this, &SyncStats::slotStarted);
+    connect(engine, &SyncEngine::aboutToPropagate, this, &SyncStats::slotAboutToPropagate);
+    connect(engine, &SyncEngine::itemCompleted, this, &SyncStats::slotItemCompleted);
+    connect(engine, &SyncEngine::finished, this, [this, engine](bool success) {
+        slotFinished(success, engine->isAnotherSyncNeeded() != NoFollowUpSync);
+    });
+}
+
+void SyncStats::watchNetworkAccessManager(QNetworkAccessManager *qnam)
+{
+    connect(qnam, &QNetworkAccessManager::finished, this, [this](QNetworkReply *reply) {
+        ++_requests;
+        if (reply->error() != QNetworkReply::NoError) {
+            ++_failedRequests;
+        }
+    });
+}
+
+void SyncStats::setConfiguration(const QJsonObject &configuration)
+{
+    _configuration = configuration;
+}
+
+void SyncStats::slotStarted()
+{
+    if (_restartPending) {
+        ++_retries;
+        _restartPending = false;
+    }
+    _phase.start();
+    _propagating = false;
+}
+
+void SyncStats::slotAboutToPropagate()
+{
+    _discoveryMs += _phase.restart();
+    _propagating = true;
+}
+
+void SyncStats::slotItemCompleted(const SyncFileItemPtr &item)
+{
+    if (item->_direction == SyncFileItem::None) {
+        return;
+    }
+    auto &stats = item->_direction == SyncFileItem::Up ? _upload : _download;
+    if (item->hasErrorStatus()) {
+        ++stats.errors;
+        return;
+    }
+
+    switch (item->_instruction) {
+    case CSYNC_INSTRUCTION_NEW:
+    case CSYNC_INSTRUCTION_SYNC:
+    case CSYNC_INSTRUCTION_CONFLICT:
+    case CSYNC_INSTRUCTION_TYPE_CHANGE:
+        if (item->isDirectory()) {
+            ++stats.directories;
+        } else {
+            ++stats.files;
+            stats.bytes += item->_size;
+        }
+        break;
+    case CSYNC_INSTRUCTION_REMOVE:
+        ++stats.deletions;
+        break;
+    case CSYNC_INSTRUCTION_RENAME:
+        ++stats.moves;
+        break;
+    default:
+        break;
+    }
+}
+
+void SyncStats::slotFinished(bool success, bool anotherSyncNeeded)
+{
+    ++_syncRuns;
+    if (!success) {
+        ++_failedSyncRuns;
+    }
+    // The next run is a retry only if this one asked for it, not if it
+    // was started for new changes
+    _restartPending = anotherSyncNeeded;
+    if (!_phase.isValid()) {
+        return;
+    }
+    if (_propagating) {
+        _propagationMs += _phase.elapsed();
+    } else {
+        // the sync ended before anything was propagated
+        _discoveryMs += _phase.elapsed();
+    }
+    _phase.invalidate();
+    _propagating = false;
+}
+
+QJsonObject SyncStats::DirectionStats::toJson(qint64 propagationMs) const
+{
+    QJsonObject json;
+    json.insert(QStringLiteral("files"), files);
+    json.insert(QStringLiteral("bytes"), bytes);
+    json.insert(QStringLiteral("directories"), directories);
+    json.insert(QStringLiteral("deletions"), deletions);
+    json.insert(QStringLiteral("moves"), moves);
+    json.insert(QStringLiteral("errors"), errors);
+    json.insert(QStringLiteral("bytesPerSecond"), propagationMs > 0 ? bytes * 1000 / propagationMs : 0);
+    return json;
+}
+
+QJsonObject SyncStats::toJson() const
+{
+    QJsonObject phases;
+    phases.insert(QStringLiteral("discoveryMs"), _discoveryMs);
+    phases.insert(QStringLiteral("propagationMs"), _propagationMs);
+    phases.insert(QStringLiteral("totalMs"), _total.elapsed());
+
+    QJsonObject requests;
+    requests.insert(QStringLiteral("total"), _requests);
+    requests.insert(QStringLiteral("failed"), _failedRequests);
+
+    QJsonObject json;
+    json.insert(QStringLiteral("configuration"), _configuration);
+    json.insert(QStringLiteral("syncRuns"), _syncRuns);
+    json.insert(QStringLiteral("failedSyncRuns"), _failedSyncRuns);
+    json.insert(QStringLiteral("retries"), _retries);
+    json.insert(QStringLiteral("upload"), _upload.toJson(_propagationMs));
+    json.insert(QStringLiteral("download"), _download.toJson(_propagationMs));
+    json.insert(QStringLiteral("phases"), phases);
+    json.insert(QStringLiteral("requests"), requests);
+    return json;
+}
+
+bool SyncStats::writeReport(const QString &fileName) const
+{
+    const auto data = QJsonDocument(toJson()).toJson();
+    if (fileName == QLatin1String("-")) {
+        QFile out;
+        return out.open(stdout, QIODevice::WriteOnly) && out.write(data) == data.size();
+    }
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Could not write the stats report to" << fileName << file.errorString();
+        return false;
+    }
+    return file.write(data) == data.size();
+}
+
+} // namespace OCC
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) by Nextcloud GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#ifndef SYNCSTATS_H
+#define SYNCSTATS_H
+
+#include "syncfileitem.h"
+
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QObject>
+
+class QNetworkAccessManager;
+
+namespace OCC {
+
+class SyncEngine;
+
+/**
+ * @brief Collects what the command line client did for the --stats-file report
+ *
+ * Counts accumulate over all sync runs, including the ones started because
+ * another sync was needed.
+ *
+ * @ingroup cmd
+ */
+class SyncStats : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SyncStats(QObject *parent = nullptr);
+
+    void watchEngine(SyncEngine *engine);
+    void watchNetworkAccessManager(QNetworkAccessManager *qnam);
+
+    /// Extra keys stored in the report, e.g. the options used for the run
+    void setConfiguration(const QJsonObject &configuration);
+
+    QJsonObject toJson() const;
+    bool writeReport(const QString &fileName) const;
+
+private slots:
+    void slotStarted();
+    void slotAboutToPropagate();
+    void slotItemCompleted(const SyncFileItemPtr &item);
+    void slotFinished(bool success, bool anotherSyncNeeded);
+
+private:
+    struct DirectionStats
+    {
+        qint64 files = 0;
+        qint64 bytes = 0;
+        qint64 directories = 0;
+        qint64 deletions = 0;
+        qint64 moves = 0;
+        qint64 errors = 0;
+
+        QJsonObject toJson(qint64 propagationMs) const;
+    };
+
+    QJsonObject _configuration;
+    DirectionStats _upload;
+    DirectionStats _download;
+    QElapsedTimer _total;
+    QElapsedTimer _phase;
+    qint64 _discoveryMs = 0;
+    qint64 _propagationMs = 0;
+    qint64 _requests = 0;
+    qint64 _failedRequests = 0;
+    int _syncRuns = 0;
+    int _failedSyncRuns = 0;
+    // Runs started because the previous one needed another sync
+    int _retries = 0;
+    bool _restartPending = false;
+    bool _propagating = false;
+};
+
+} // namespace OCC
+
+#endif
@@ -18,6 +18,7 @@
 #include "config.h"
 #include "filesystembase.h"
 #include "common/checksums.h"
+#include "common/tracer.h"
 #include "asserts.h"
 
 #include <QLoggingCategory>
@@ -263,7 +264,14 @@ void ComputeChecksum::startImpl(std::unique_ptr<QIODevice> device)
             }
             return QByteArray();
         }
+        auto file = qobject_cast<QFile *>(sharedDevice.data());
+        if (file) {
+            FileSystem::adviseSequentialRead(*file);
+        }
         auto result = ComputeChecksum::computeNow(sharedDevice.data(), type);
+        if (file) {
+            FileSystem::releasePageCache(*file);
+        }
         sharedDevice->close();
         return result;
     }));
@@ -277,7 +285,10 @@ QByteArray ComputeChecksum::computeNowOnFile(const QString &filePath, const QByt
         return QByteArray();
     }
 
-    return computeNow(&file, checksumType);
+    FileSystem::adviseSequentialRead(file);
+    const auto result = computeNow(&file, checksumType);
+    FileSystem::releasePageCache(file);
+    return result;
 }
 
 QByteArray ComputeChecksum::computeNow(QIODevice *device, const QByteArray &checksumType)
@@ -287,6 +298,9 @@ QByteArray ComputeChecksum::computeNow(QIODevice *device, const QByteArray &chec
         return QByteArray();
     }
 
+    TraceSpan traceSpan("checksum", checksumType.constData());
+    traceSpan.setArgument(QStringLiteral("size"), device->size());
+
     if (checksumType == checkSumMD5C) {
         return calcMd5(device);
     } else if (checksumType == checkSumSHA1C) {
@@ -37,6 +37,11 @@
 #include <io.h>
 #endif
 
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <cerrno>
+#endif
+
 namespace OCC {
 
 Q_LOGGING_CATEGORY(lcFileSystem, "nextcloud.sync.filesystem", QtInfoMsg)
@@ -288,6 +293,63 @@ bool FileSystem::openAndSeekFileSharedRead(QFile *file, QString *errorOrNull, qi
 #endif
 }
 
+bool FileSystem::preallocate(QFile &file, qint64 size, QString *errorString)
+{
+#if defined(Q_OS_LINUX) && defined(FALLOC_FL_KEEP_SIZE)
+    const auto fd = file.handle();
+    if (fd == -1 || size <= 0) {
+        return true;
+    }
+    // Keep the size: resuming a download relies on the size of the temporary file
+    if (::fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, size) == 0) {
+        return true;
+    }
+    const auto error = errno;
+    // EFBIG is about the file size limit, not free space: let the download run into it
+    if (error == ENOSPC || error == EDQUOT) {
+        if (errorString) {
+            *errorString = qt_error_string(error);
+        }
+        return false;
+    }
+    // EOPNOTSUPP and the like: the filesystem just can't do it
+    qCDebug(lcFileSystem) << "Could not preallocate" << size << "bytes for" << file.fileName() << qt_error_string(error);
+#else
+    Q_UNUSED(file)
+    Q_UNUSED(size)
+    Q_UNUSED(errorString)
+#endif
+    return true;
+}
+
+void FileSystem::adviseSequentialRead(QFile &file, qint64 offset, qint64 length)
+{
+#ifdef Q_OS_LINUX
+    const auto fd = file.handle();
+    if (fd != -1) {
+        ::posix_fadvise(fd, offset, length, POSIX_FADV_SEQUENTIAL);
+    }
+#else
+    Q_UNUSED(file)
+    Q_UNUSED(offset)
+    Q_UNUSED(length)
+#endif
+}
+
+void FileSystem::releasePageCache(QFile &file, qint64 offset, qint64 length)
+{
+#ifdef Q_OS_LINUX
+    const auto fd = file.handle();
+    if (fd != -1 && file.size() >= pageCacheReleaseThreshold) {
+        ::posix_fadvise(fd, offset, length, POSIX_FADV_DONTNEED);
+    }
+#else
+    Q_UNUSED(file)
+    Q_UNUSED(offset)
+    Q_UNUSED(length)
+#endif
+}
+
 #ifdef Q_OS_WIN
 static bool fileExistsWin(const QString &filename)
 {
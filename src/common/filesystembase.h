@@ -123,6 +123,34 @@ namespace FileSystem {
      */
     bool OCSYNC_EXPORT openAndSeekFileSharedRead(QFile *file, QString *error, qint64 seek);
 
+    /// Files below this size are left in the page cache by releasePageCache()
+    constexpr qint64 pageCacheReleaseThreshold = 64 * 1024 * 1024;
+
+    /**
+     * Reserves the disk blocks for \a size bytes of the open \a file without changing its size.
+     *
+     * This makes a download fail before the transfer when the disk is full and keeps
+     * the file from fragmenting. Returns false only when the space is not available;
+     * where the platform or filesystem can't preallocate, nothing happens. (Linux only)
+     */
+    bool OCSYNC_EXPORT preallocate(QFile &file, qint64 size, QString *errorString = nullptr);
+
+    /**
+     * Tells the kernel that \a length bytes of the open \a file starting at \a offset
+     * will be read sequentially, so it reads ahead more aggressively.
+     * A length of 0 means up to the end of the file. (Linux only)
+     */
+    void OCSYNC_EXPORT adviseSequentialRead(QFile &file, qint64 offset = 0, qint64 length = 0);
+
+    /**
+     * Drops the cached pages of a range of the open \a file once it was read through.
+     *
+     * Streaming large files through the page cache during a sync would otherwise evict
+     * the user's working set. Files smaller than pageCacheReleaseThreshold are kept
+     * cached. A length of 0 means up to the end of the file. (Linux only)
+     */
+    void OCSYNC_EXPORT releasePageCache(QFile &file, qint64 offset = 0, qint64 length = 0);
+
 #ifdef Q_OS_WIN
     /**
      * Returns the file system used at the given path.
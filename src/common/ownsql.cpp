@@ -28,6 +28,8 @@
 #include "common/asserts.h"
 #include <sqlite3.h>
 
+#include <atomic>
+
 #define SQLITE_SLEEP_TIME_USEC 100000
 #define SQLITE_REPEAT_COUNT 20
 
@@ -43,6 +45,10 @@ namespace OCC {
 
 Q_LOGGING_CATEGORY(lcSql, "nextcloud.sync.database.sql", QtInfoMsg)
 
+namespace {
+std::atomic<quint64> sqlExecutedCount{0};
+}
+
 SqlDatabase::SqlDatabase() = default;
 
 SqlDatabase::~SqlDatabase()
@@ -298,6 +304,7 @@ bool SqlQuery::exec()
         qCWarning(lcSql) << "Can't exec query, statement unprepared.";
         return false;
     }
+    sqlExecutedCount.fetch_add(1, std::memory_order_relaxed);
 
     // Don't do anything for selects, that is how we use the lib :-|
     if (!isSelect() && !isPragma()) {
@@ -466,6 +473,11 @@ const QByteArray &SqlQuery::lastQuery() const
     return _sql;
 }
 
+quint64 SqlQuery::executedCount()
+{
+    return sqlExecutedCount.load(std::memory_order_relaxed);
+}
+
 int SqlQuery::numRowsAffected()
 {
     return sqlite3_changes(_db);
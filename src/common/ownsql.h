@@ -156,6 +156,9 @@ public:
     int numRowsAffected();
     void reset_and_clear_bindings();
 
+    /// Number of statements executed by all SqlQuery instances of this process, used by benchmarks
+    static quint64 executedCount();
+
 private:
     void bindValueInternal(int pos, const QVariant &value);
     void finish();
@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) by Nextcloud GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "pinstatetrie.h"
+
+namespace OCC {
+
+static QList<QByteArray> pathComponents(const QByteArray &path)
+{
+    if (path.isEmpty())
+        return {};
+    return path.split('/');
+}
+
+void PinStateTrie::clear()
+{
+    _root.state = PinState::Inherited;
+    _root.subtreeCounts = {};
+    _root.children.clear();
+}
+
+const PinStateTrie::Node *PinStateTrie::find(const QByteArray &path, std::vector<const Node *> *chain) const
+{
+    const Node *node = &_root;
+    if (chain)
+        chain->push_back(node);
+    for (const auto &component : pathComponents(path)) {
+        const auto it = node->children.find(component);
+        if (it == node->children.end())
+            return nullptr;
+        node = it->second.get();
+        if (chain)
+            chain->push_back(node);
+    }
+    return node;
+}
+
+std::vector<PinStateTrie::Node *> PinStateTrie::createChain(const QByteArray &path)
+{
+    std::vector<Node *> chain{ &_root };
+    for (const auto &component : pathComponents(path)) {
+        auto &child = chain.back()->children[component];
+        if (!child)
+            child = std::make_unique<Node>();
+        chain.push_back(child.get());
+    }
+    return chain;
+}
+
+void PinStateTrie::prune(const std::vector<Node *> &chain, const QList<QByteArray> &components)
+{
+    for (auto i = chain.size() - 1; i > 0; --i) {
+        const auto node = chain[i];
+        if (node->state != PinState::Inherited || !node->children.empty())
+            return;
+        chain[i - 1]->children.erase(components[static_cast<int>(i - 1)]);
+    }
+}
+
+void PinStateTrie::set(const QByteArray &path, PinState state)
+{
+    // Nothing to remove, and no nodes must be created for it
+    if (state == PinState::Inherited && !find(path))
+        return;
+
+    const auto chain = createChain(path);
+    const auto node = chain.back();
+    if (node->state == state)
+        return;
+
+    for (const auto ancestor : chain) {
+        if (node->state != PinState::Inherited)
+            --ancestor->subtreeCounts[static_cast<size_t>(node->state)];
+        if (state != PinState::Inherited)
+            ++ancestor->subtreeCounts[static_cast<size_t>(state)];
+    }
+    node->state = state;
+
+    if (state == PinState::Inherited)
+        prune(chain, pathComponents(path));
+}
+
+void PinStateTrie::wipeForPathAndBelow(const QByteArray &path)
+{
+    if (path.isEmpty()) {
+        clear();
+        return;
+    }
+
+    const auto components = pathComponents(path);
+    std::vector<Node *> chain{ &_root };
+    for (const auto &component : components) {
+        const auto it = chain.back()->children.find(component);
+        if (it == chain.back()->children.end())
+            return;
+        chain.push_back(it->second.get());
+    }
+
+    const auto wiped = chain.back();
+    chain.pop_back();
+    for (const auto ancestor : chain) {
+        for (size_t i = 0; i < ancestor->subtreeCounts.size(); ++i)
+            ancestor->subtreeCounts[i] -= wiped->subtreeCounts[i];
+    }
+    chain.back()->children.erase(components.last());
+    prune(chain, components);
+}
+
+PinState PinStateTrie::raw(const QByteArray &path) const
+{
+    const auto node = find(path);
+    return node ? node->state : PinState::Inherited;
+}
+
+PinState PinStateTrie::effective(const QByteArray &path) const
+{
+    std::vector<const Node *> chain;
+    find(path, &chain);
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+        if ((*it)->state != PinState::Inherited)
+            return (*it)->state;
+    }
+    // If the root path has no setting, assume AlwaysLocal
+    return PinState::AlwaysLocal;
+}
+
+PinState PinStateTrie::effectiveRecursive(const QByteArray &path) const
+{
+    std::vector<const Node *> chain;
+    const auto node = find(path, &chain);
+
+    PinState base = PinState::AlwaysLocal;
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+        if ((*it)->state != PinState::Inherited) {
+            base = (*it)->state;
+            break;
+        }
+    }
+    if (!node)
+        return base;
+
+    // Any explicit pin state below the item that differs from its own
+    // effective state makes the subtree mixed
+    for (size_t i = 0; i < node->subtreeCounts.size(); ++i) {
+        if (i != static_cast<size_t>(base) && node->subtreeCounts[i] > 0)
+            return PinState::Inherited;
+    }
+    return base;
+}
+
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) by Nextcloud GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#ifndef PINSTATETRIE_H
+#define PINSTATETRIE_H
+
+#include "ocsynclib.h"
+#include "common/pinstate.h"
+
+#include <QByteArray>
+#include <QList>
+
+#include <array>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace OCC {
+
+/**
+ * @brief In-memory mirror of the explicit pin states stored in the journal's flags table
+ *
+ * Paths are split into their components and stored in a trie. Only
+ * non-inherited pin states are kept; a missing node means Inherited.
+ *
+ * Every node additionally counts the explicit pin states in its subtree
+ * so that effectiveRecursive() does not need to visit the descendants.
+ * All lookups are O(depth of path).
+ *
+ * The "" path is the sync root and maps to the root node.
+ *
+ * Not thread safe, SyncJournalDb guards it with its mutex.
+ *
+ * @ingroup libsync
+ */
+class OCSYNC_EXPORT PinStateTrie
+{
+public:
+    void clear();
+
+    /// Sets the explicit pin state of path. Inherited removes the entry.
+    void set(const QByteArray &path, PinState state);
+
+    /// Removes the entries of path and everything below it
+    void wipeForPathAndBelow(const QByteArray &path);
+
+    /// The explicit pin state of path, Inherited if there is none
+    [[nodiscard]] PinState raw(const QByteArray &path) const;
+
+    /// Same semantics as SyncJournalDb::PinStateInterface::effectiveForPath()
+    [[nodiscard]] PinState effective(const QByteArray &path) const;
+
+    /// Same semantics as SyncJournalDb::PinStateInterface::effectiveForPathRecursive()
+    [[nodiscard]] PinState effectiveRecursive(const QByteArray &path) const;
+
+private:
+    struct Node
+    {
+        PinState state = PinState::Inherited;
+        // number of explicit pin states in this subtree, including the
+        // node itself, indexed by PinState
+        std::array<qint64, 4> subtreeCounts = {};
+        std::map<QByteArray, std::unique_ptr<Node>> children;
+    };
+
+    // Returns the node for path or nullptr if it does not exist.
+    // If chain is given it receives all nodes from the root down to the
+    // last one found.
+    const Node *find(const QByteArray &path, std::vector<const Node *> *chain = nullptr) const;
+
+    // Returns the nodes from the root to path, creating missing ones
+    std::vector<Node *> createChain(const QByteArray &path);
+
+    // Drops nodes without state and without children from the end of chain,
+    // chain[i + 1] being the child of chain[i] called components[i]
+    static void prune(const std::vector<Node *> &chain, const QList<QByteArray> &components);
+
+    Node _root;
+};
+
+}
+
+#endif // PINSTATETRIE_H
@@ -63,6 +63,7 @@ public:
         GetFileRecordQueryByMangledName,
         GetFileRecordQueryByInode,
         GetFileRecordQueryByFileId,
+        GetFileRecordQueryByContentChecksum,
         GetFilesBelowPathQuery,
         GetAllFilesQuery,
         ListFilesInPathQuery,
@@ -77,6 +78,8 @@ public:
         DeleteUploadInfoQuery,
         DeleteFileRecordPhash,
         DeleteFileRecordRecursively,
+        MoveFileRecordsBelowPathQuery,
+        MovePinStatesBelowPathQuery,
         GetErrorBlacklistQuery,
         SetErrorBlacklistQuery,
         GetSelectiveSyncListQuery,
@@ -92,9 +95,6 @@ public:
         GetConflictRecordQuery,
         SetConflictRecordQuery,
         DeleteConflictRecordQuery,
-        GetRawPinStateQuery,
-        GetEffectivePinStateQuery,
-        GetSubPinsQuery,
         CountDehydratedFilesQuery,
         SetPinStateQuery,
         WipePinStateQuery,
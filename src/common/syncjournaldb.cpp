@@ -34,6 +34,7 @@
 #include "common/preparedsqlquerymanager.h"
 
 #include "common/c_jhash.h"
+#include "common/tracer.h"
 
 // SQL expression to check whether path.startswith(prefix + '/')
 // Note: '/' + 1 == '0'
@@ -237,6 +238,7 @@ void SyncJournalDb::startTransaction()
             return;
         }
         _transaction = 1;
+        _transactionTraceStart = Tracer::instance()->isEnabled() ? Tracer::instance()->timestamp() : -1;
     } else {
         qCDebug(lcDb) << "Database Transaction is running, not starting another one!";
     }
@@ -245,11 +247,18 @@ void SyncJournalDb::startTransaction()
 void SyncJournalDb::commitTransaction()
 {
     if (_transaction == 1) {
-        if (!_db.commit()) {
-            qCWarning(lcDb) << "ERROR committing to the database:" << _db.error();
-            return;
+        {
+            TraceSpan traceSpan("journal", "commit");
+            if (!_db.commit()) {
+                qCWarning(lcDb) << "ERROR committing to the database:" << _db.error();
+                return;
+            }
         }
         _transaction = 0;
+        if (_transactionTraceStart >= 0) {
+            Tracer::instance()->asyncSpan("journal", QStringLiteral("transaction"), reinterpret_cast<quintptr>(this), _transactionTraceStart);
+            _transactionTraceStart = -1;
+        }
     } else {
         qCDebug(lcDb) << "No database Transaction to commit";
     }
@@ -516,6 +525,14 @@ bool SyncJournalDb::checkConnect()
         return sqlFail(QStringLiteral("Create table conflicts"), createQuery);
     }
 
+    // create the localdiscoverypaths table.
+    createQuery.prepare("CREATE TABLE IF NOT EXISTS localdiscoverypaths("
+                        "path TEXT PRIMARY KEY"
+                        ");");
+    if (!createQuery.exec()) {
+        return sqlFail(QStringLiteral("Create table localdiscoverypaths"), createQuery);
+    }
+
     createQuery.prepare("CREATE TABLE IF NOT EXISTS version("
                         "major INTEGER(8),"
                         "minor INTEGER(8),"
@@ -643,6 +660,8 @@ void SyncJournalDb::close()
     _db.close();
     clearEtagStorageFilter();
     _metadataTableIsEmpty = false;
+    _pinStateCache.clear();
+    _pinStateCacheLoaded = false;
 }
 
 
@@ -763,6 +782,16 @@ bool SyncJournalDb::updateMetadataTableStructure()
         commitInternal(QStringLiteral("update database structure: add e2eMangledName index"));
     }
 
+    if (true) {
+        SqlQuery query(_db);
+        query.prepare("CREATE INDEX IF NOT EXISTS metadata_contentChecksum ON metadata(contentChecksum);");
+        if (!query.exec()) {
+            sqlFail(QStringLiteral("updateMetadataTableStructure: create index contentChecksum"), query);
+            re = false;
+        }
+        commitInternal(QStringLiteral("update database structure: add contentChecksum index"));
+    }
+
     addColumn(QStringLiteral("lock"), QStringLiteral("INTEGER"));
     addColumn(QStringLiteral("lockType"), QStringLiteral("INTEGER"));
     addColumn(QStringLiteral("lockOwnerDisplayName"), QStringLiteral("TEXT"));
@@ -1049,6 +1078,54 @@ bool SyncJournalDb::deleteFileRecord(const QString &filename, bool recursively)
     }
 }
 
+bool SyncJournalDb::moveFileRecordsBelowPath(const QByteArray &from, const QByteArray &to)
+{
+    QMutexLocker locker(&_mutex);
+
+    if (!checkConnect()) {
+        qCWarning(lcDb) << "Failed to connect database.";
+        return false;
+    }
+    if (from.isEmpty() || to.isEmpty()) {
+        return false;
+    }
+
+    // parent_hash(p || '/') is the phash of p, pathlen counts bytes
+    const auto query = _queryManager.get(PreparedSqlQueryManager::MoveFileRecordsBelowPathQuery, QByteArrayLiteral("UPDATE OR REPLACE metadata SET "
+                                                                                                                    "path = ?2 || substr(path, length(?1) + 1), "
+                                                                                                                    "pathlen = pathlen - length(CAST(?1 AS BLOB)) + length(CAST(?2 AS BLOB)), "
+                                                                                                                    "phash = parent_hash(?2 || substr(path, length(?1) + 1) || '/') "
+                                                                                                                    "WHERE " IS_PREFIX_PATH_OF("?1", "path")),
+        _db);
+    if (!query) {
+        return false;
+    }
+    query->bindValue(1, from);
+    query->bindValue(2, to);
+    if (!query->exec()) {
+        return false;
+    }
+    qCInfo(lcDb) << "Moved" << query->numRowsAffected() << "records from" << from << "to" << to;
+
+    const auto pinQuery = _queryManager.get(PreparedSqlQueryManager::MovePinStatesBelowPathQuery, QByteArrayLiteral("UPDATE OR REPLACE flags SET "
+                                                                                                                     "path = ?2 || substr(path, length(?1) + 1) "
+                                                                                                                     "WHERE " IS_PREFIX_PATH_OF("?1", "path")),
+        _db);
+    if (!pinQuery) {
+        return false;
+    }
+    pinQuery->bindValue(1, from);
+    pinQuery->bindValue(2, to);
+    if (!pinQuery->exec()) {
+        return false;
+    }
+    if (pinQuery->numRowsAffected() > 0) {
+        _pinStateCache.clear();
+        _pinStateCacheLoaded = false;
+    }
+    return true;
+}
+
 
 bool SyncJournalDb::getFileRecord(const QByteArray &filename, SyncJournalFileRecord *rec)
 {
@@ -1203,6 +1280,44 @@ bool SyncJournalDb::getFileRecordsByFileId(const QByteArray &fileId, const std::
     return true;
 }
 
+bool SyncJournalDb::getFileRecordsByContentChecksum(const QByteArray &checksumHeader, qint64 size, const std::function<void(const SyncJournalFileRecord &)> &rowCallback)
+{
+    QMutexLocker locker(&_mutex);
+
+    QByteArray checksumType, checksum;
+    if (!parseChecksumHeader(checksumHeader, &checksumType, &checksum) || checksum.isEmpty() || _metadataTableIsEmpty)
+        return true; // no error, yet nothing found
+
+    if (!checkConnect())
+        return false;
+
+    const auto query = _queryManager.get(PreparedSqlQueryManager::GetFileRecordQueryByContentChecksum, QByteArrayLiteral(GET_FILE_RECORD_QUERY " WHERE contentChecksum=?1 AND contentchecksumtype.name=?2 AND filesize=?3"), _db);
+    if (!query) {
+        return false;
+    }
+
+    query->bindValue(1, checksum);
+    query->bindValue(2, checksumType);
+    query->bindValue(3, size);
+
+    if (!query->exec())
+        return false;
+
+    forever {
+        auto next = query->next();
+        if (!next.ok)
+            return false;
+        if (!next.hasData)
+            break;
+
+        SyncJournalFileRecord rec;
+        fillFileRecordFromGetQuery(rec, *query);
+        rowCallback(rec);
+    }
+
+    return true;
+}
+
 bool SyncJournalDb::getFilesBelowPath(const QByteArray &path, const std::function<void(const SyncJournalFileRecord&)> &rowCallback)
 {
     QMutexLocker locker(&_mutex);
@@ -1720,6 +1835,9 @@ void SyncJournalDb::deleteStaleFlagsEntries()
     if (!checkConnect())
         return;
 
+    // The cache is reloaded lazily rather than replaying the deletion
+    _pinStateCacheLoaded = false;
+
     SqlQuery delQuery("DELETE FROM flags WHERE path != '' AND path NOT IN (SELECT path from metadata);", _db);
     if (!delQuery.exec()) {
         sqlFail(QStringLiteral("deleteStaleFlagsEntries"), delQuery);
@@ -1950,6 +2068,64 @@ void SyncJournalDb::setSelectiveSyncList(SyncJournalDb::SelectiveSyncListType ty
     commitInternal(QStringLiteral("setSelectiveSyncList"));
 }
 
+QStringList SyncJournalDb::getLocalDiscoveryPaths(bool *ok)
+{
+    QStringList result;
+    ASSERT(ok);
+
+    QMutexLocker locker(&_mutex);
+    if (!checkConnect()) {
+        *ok = false;
+        return result;
+    }
+
+    SqlQuery query("SELECT path FROM localdiscoverypaths", _db);
+    if (!query.exec()) {
+        *ok = false;
+        return result;
+    }
+    forever {
+        auto next = query.next();
+        if (!next.ok) {
+            *ok = false;
+            return result;
+        }
+        if (!next.hasData)
+            break;
+
+        result.append(query.stringValue(0));
+    }
+    *ok = true;
+
+    return result;
+}
+
+void SyncJournalDb::setLocalDiscoveryPaths(const QStringList &paths)
+{
+    QMutexLocker locker(&_mutex);
+    if (!checkConnect()) {
+        return;
+    }
+
+    startTransaction();
+
+    SqlQuery delQuery("DELETE FROM localdiscoverypaths", _db);
+    if (!delQuery.exec()) {
+        qCWarning(lcDb) << "SQL error when deleting local discovery paths" << delQuery.error();
+    }
+
+    SqlQuery insQuery("INSERT OR IGNORE INTO localdiscoverypaths VALUES (?1)", _db);
+    for (const auto &path : paths) {
+        insQuery.reset_and_clear_bindings();
+        insQuery.bindValue(1, path);
+        if (!insQuery.exec()) {
+            qCWarning(lcDb) << "SQL error when inserting local discovery path" << path << insQuery.error();
+        }
+    }
+
+    commitInternal(QStringLiteral("setLocalDiscoveryPaths"));
+}
+
 void SyncJournalDb::avoidRenamesOnNextSync(const QByteArray &path)
 {
     QMutexLocker locker(&_mutex);
@@ -2265,88 +2441,62 @@ void SyncJournalDb::markVirtualFileForDownloadRecursively(const QByteArray &path
     }
 }
 
+bool SyncJournalDb::ensurePinStateCacheLoaded()
+{
+    if (_pinStateCacheLoaded)
+        return true;
+
+    SqlQuery query("SELECT path, pinState FROM flags WHERE pinState is not null AND pinState != 0;", _db);
+    if (!query.exec()) {
+        return sqlFail(QStringLiteral("ensurePinStateCacheLoaded"), query);
+    }
+
+    _pinStateCache.clear();
+    forever {
+        auto next = query.next();
+        if (!next.ok) {
+            _pinStateCache.clear();
+            return false;
+        }
+        if (!next.hasData)
+            break;
+        const auto pinState = query.intValue(1);
+        if (pinState < static_cast<int>(PinState::AlwaysLocal) || pinState > static_cast<int>(PinState::Unspecified)) {
+            qCWarning(lcDb) << "Ignoring invalid pin state" << pinState << "of" << query.baValue(0);
+            continue;
+        }
+        _pinStateCache.set(query.baValue(0), static_cast<PinState>(pinState));
+    }
+    _pinStateCacheLoaded = true;
+    return true;
+}
+
 Optional<PinState> SyncJournalDb::PinStateInterface::rawForPath(const QByteArray &path)
 {
     QMutexLocker lock(&_db->_mutex);
-    if (!_db->checkConnect())
+    if (!_db->checkConnect() || !_db->ensurePinStateCacheLoaded())
         return {};
 
-    const auto query = _db->_queryManager.get(PreparedSqlQueryManager::GetRawPinStateQuery, QByteArrayLiteral("SELECT pinState FROM flags WHERE path == ?1;"), _db->_db);
-    ASSERT(query)
-    query->bindValue(1, path);
-    query->exec();
-
-    auto next = query->next();
-    if (!next.ok)
-        return {};
     // no-entry means Inherited
-    if (!next.hasData)
-        return PinState::Inherited;
-
-    return static_cast<PinState>(query->intValue(0));
+    return _db->_pinStateCache.raw(path);
 }
 
 Optional<PinState> SyncJournalDb::PinStateInterface::effectiveForPath(const QByteArray &path)
 {
     QMutexLocker lock(&_db->_mutex);
-    if (!_db->checkConnect())
-        return {};
-
-    const auto query = _db->_queryManager.get(PreparedSqlQueryManager::GetEffectivePinStateQuery, QByteArrayLiteral("SELECT pinState FROM flags WHERE"
-                                                                                                                    // explicitly allow "" to represent the root path
-                                                                                                                    // (it'd be great if paths started with a / and "/" could be the root)
-                                                                                                                    " (" IS_PREFIX_PATH_OR_EQUAL("path", "?1") " OR path == '')"
-                                                                                                                                                               " AND pinState is not null AND pinState != 0"
-                                                                                                                                                               " ORDER BY length(path) DESC LIMIT 1;"),
-        _db->_db);
-    ASSERT(query)
-    query->bindValue(1, path);
-    query->exec();
-
-    auto next = query->next();
-    if (!next.ok)
+    if (!_db->checkConnect() || !_db->ensurePinStateCacheLoaded())
         return {};
-    // If the root path has no setting, assume AlwaysLocal
-    if (!next.hasData)
-        return PinState::AlwaysLocal;
 
-    return static_cast<PinState>(query->intValue(0));
+    return _db->_pinStateCache.effective(path);
 }
 
 Optional<PinState> SyncJournalDb::PinStateInterface::effectiveForPathRecursive(const QByteArray &path)
 {
-    // Get the item's effective pin state. We'll compare subitem's pin states
-    // against this.
-    const auto basePin = effectiveForPath(path);
-    if (!basePin)
-        return {};
-
     QMutexLocker lock(&_db->_mutex);
-    if (!_db->checkConnect())
+    if (!_db->checkConnect() || !_db->ensurePinStateCacheLoaded())
         return {};
 
-    // Find all the non-inherited pin states below the item
-    const auto query = _db->_queryManager.get(PreparedSqlQueryManager::GetSubPinsQuery, QByteArrayLiteral("SELECT DISTINCT pinState FROM flags WHERE"
-                                                                                                          " (" IS_PREFIX_PATH_OF("?1", "path") " OR ?1 == '')"
-                                                                                                                                               " AND pinState is not null and pinState != 0;"),
-        _db->_db);
-    ASSERT(query)
-    query->bindValue(1, path);
-    query->exec();
-
-    // Check if they are all identical
-    forever {
-        auto next = query->next();
-        if (!next.ok)
-            return {};
-        if (!next.hasData)
-            break;
-        const auto subPin = static_cast<PinState>(query->intValue(0));
-        if (subPin != *basePin)
-            return PinState::Inherited;
-    }
-
-    return *basePin;
+    return _db->_pinStateCache.effectiveRecursive(path);
 }
 
 void SyncJournalDb::PinStateInterface::setForPath(const QByteArray &path, PinState state)
@@ -2366,7 +2516,11 @@ void SyncJournalDb::PinStateInterface::setForPath(const QByteArray &path, PinSta
     ASSERT(query)
     query->bindValue(1, path);
     query->bindValue(2, state);
-    query->exec();
+    if (query->exec()) {
+        _db->_pinStateCache.set(path, state);
+    } else {
+        _db->_pinStateCacheLoaded = false;
+    }
 }
 
 void SyncJournalDb::PinStateInterface::wipeForPathAndBelow(const QByteArray &path)
@@ -2381,7 +2535,11 @@ void SyncJournalDb::PinStateInterface::wipeForPathAndBelow(const QByteArray &pat
         _db->_db);
     ASSERT(query)
     query->bindValue(1, path);
-    query->exec();
+    if (query->exec()) {
+        _db->_pinStateCache.wipeForPathAndBelow(path);
+    } else {
+        _db->_pinStateCacheLoaded = false;
+    }
 }
 
 Optional<QVector<QPair<QByteArray, PinState>>>
@@ -32,6 +32,7 @@
 #include "common/syncjournalfilerecord.h"
 #include "common/result.h"
 #include "common/pinstate.h"
+#include "common/pinstatetrie.h"
 
 namespace OCC {
 class SyncJournalFileRecord;
@@ -64,6 +65,8 @@ public:
     [[nodiscard]] bool getFileRecordByE2eMangledName(const QString &mangledName, SyncJournalFileRecord *rec);
     [[nodiscard]] bool getFileRecordByInode(quint64 inode, SyncJournalFileRecord *rec);
     [[nodiscard]] bool getFileRecordsByFileId(const QByteArray &fileId, const std::function<void(const SyncJournalFileRecord &)> &rowCallback);
+    /// Records whose content checksum (given as checksum header, like "SHA1:abc") and size match
+    [[nodiscard]] bool getFileRecordsByContentChecksum(const QByteArray &checksumHeader, qint64 size, const std::function<void(const SyncJournalFileRecord &)> &rowCallback);
     [[nodiscard]] bool getFilesBelowPath(const QByteArray &path, const std::function<void(const SyncJournalFileRecord&)> &rowCallback);
     [[nodiscard]] bool listFilesInPath(const QByteArray &path, const std::function<void(const SyncJournalFileRecord&)> &rowCallback);
     [[nodiscard]] Result<void, QString> setFileRecord(const SyncJournalFileRecord &record);
@@ -73,6 +76,15 @@ public:
     void keyValueStoreDelete(const QString &key);
 
     [[nodiscard]] bool deleteFileRecord(const QString &filename, bool recursively = false);
+    /**
+     * Moves the records of everything below \a from to below \a to.
+     *
+     * Paths and phashes of the file records and pin states are rewritten with
+     * one statement each instead of a delete and insert per file. The records
+     * of \a from and \a to themselves are not touched. Existing records
+     * below \a to are replaced.
+     */
+    [[nodiscard]] bool moveFileRecordsBelowPath(const QByteArray &from, const QByteArray &to);
     [[nodiscard]] bool updateFileRecordChecksum(
         const QString &filename,
         const QByteArray &contentChecksum,
@@ -175,6 +187,15 @@ public:
     /* Write the selective sync list (remove all other entries of that list */
     void setSelectiveSyncList(SelectiveSyncListType type, const QStringList &list);
 
+    /**
+     * Paths that still need local rediscovery, persisted across restarts.
+     *
+     * See LocalDiscoveryTracker::persistToJournal().
+     */
+    QStringList getLocalDiscoveryPaths(bool *ok);
+    /* Replace the stored local discovery paths (remove all other entries) */
+    void setLocalDiscoveryPaths(const QStringList &paths);
+
     /**
      * Make sure that on the next sync fileName and its parents are discovered from the server.
      *
@@ -279,6 +300,9 @@ public:
     /** Grouping for all functions relating to pin states,
      *
      * Use internalPinStates() to get at them.
+     *
+     * Reads are answered from an in-memory copy of the flags table that
+     * is loaded on first use and kept up to date by the writers here.
      */
     struct OCSYNC_EXPORT PinStateInterface
     {
@@ -386,6 +410,9 @@ private:
     // Same as forceRemoteDiscoveryNextSync but without acquiring the lock
     void forceRemoteDiscoveryNextSyncLocked();
 
+    // Fills _pinStateCache from the flags table unless it is already loaded
+    bool ensurePinStateCacheLoaded();
+
     // Returns the integer id of the checksum type
     //
     // Returns 0 on failure and for empty checksum types.
@@ -396,6 +423,7 @@ private:
     QRecursiveMutex _mutex; // Public functions are protected with the mutex.
     QMap<QByteArray, int> _checksymTypeCache;
     int _transaction;
+    qint64 _transactionTraceStart = -1; // see Tracer
     bool _metadataTableIsEmpty;
 
     /* Storing etags to these folders, or their parent folders, is filtered out.
@@ -420,6 +448,14 @@ private:
      */
     QByteArray _journalMode;
 
+    /** In-memory copy of the explicit pin states of the flags table.
+     *
+     * Only valid while _pinStateCacheLoaded is set. It's dropped when
+     * the db is closed or rows are removed behind PinStateInterface's back.
+     */
+    PinStateTrie _pinStateCache;
+    bool _pinStateCacheLoaded = false;
+
     PreparedSqlQueryManager _queryManager;
 };
 
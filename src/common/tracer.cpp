@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) by Nextcloud GmbH
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "tracer.h"
+
+#include <QCoreApplication>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+#include <QThread>
+
+namespace OCC {
+
+Q_LOGGING_CATEGORY(lcTracer, "nextcloud.common.tracer", QtInfoMsg)
+
+Tracer *Tracer::instance()
+{
+    static Tracer tracer;
+    return &tracer;
+}
+
+Tracer::Tracer()
+{
+    const auto fileName = qEnvironmentVariable("OWNCLOUD_TRACE_FILE");
+    if (!fileName.isEmpty()) {
+        start(fileName);
+    }
+}
+
+Tracer::~Tracer()
+{
+    stop();
+}
+
+bool Tracer::start(const QString &fileName)
+{
+    QMutexLocker lock(&_mutex);
+    if (_file.isOpen()) {
+        _file.close();
+    }
+    _file.setFileName(fileName);
+    if (!_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qCWarning(lcTracer) << "Could not open trace file" << fileName << _file.errorString();
+        _enabled = false;
+        return false;
+    }
+    qCInfo(lcTracer) << "Writing trace to" << fileName;
+
+    _file.write("[");
+    _firstEvent = true;
+    _clock.start();
+    _enabled = true;
+
+    // Name the process so several traces can be loaded side by side
+    writeEvent({ { QStringLiteral("name"), QStringLiteral("process_name") },
+        { QStringLiteral("ph"), QStringLiteral("M") },
+        { QStringLiteral("pid"), QCoreApplication::applicationPid() },
+        { QStringLiteral("args"), QVariantMap{ { QStringLiteral("name"), QCoreApplication::applicationName() } } } });
+    return true;
+}
+
+void Tracer::stop()
+{
+    QMutexLocker lock(&_mutex);
+    _enabled = false;
+    if (_file.isOpen()) {
+        _file.write("\n]\n");
+        _file.close();
+    }
+}
+
+qint64 Tracer::timestamp() const
+{
+    return _clock.nsecsElapsed() / 1000;
+}
+
+void Tracer::completeSpan(const char *category, const QString &name, qint64 startTimestamp, const QVariantMap &args)
+{
+    if (!isEnabled())
+        return;
+
+    const auto now = timestamp();
+    QVariantMap event{ { QStringLiteral("name"), name },
+        { QStringLiteral("cat"), QString::fromLatin1(category) },
+        { QStringLiteral("ph"), QStringLiteral("X") },
+        { QStringLiteral("ts"), startTimestamp },
+        { QStringLiteral("dur"), now - startTimestamp },
+        { QStringLiteral("pid"), QCoreApplication::applicationPid() },
+        { QStringLiteral("tid"), static_cast<qulonglong>(reinterpret_cast<quintptr>(QThread::currentThreadId())) } };
+    if (!args.isEmpty())
+        event.insert(QStringLiteral("args"), args);
+
+    QMutexLocker lock(&_mutex);
+    writeEvent(event);
+}
+
+void Tracer::asyncSpan(const char *category, const QString &name, quintptr id, qint64 startTimestamp, const QVariantMap &args)
+{
+    if (!isEnabled())
+        return;
+
+    const auto now = timestamp();
+    QVariantMap event{ { QStringLiteral("name"), name },
+        { QStringLiteral("cat"), QString::fromLatin1(category) },
+        { QStringLiteral("ph"), QStringLiteral("b") },
+        { QStringLiteral("ts"), startTimestamp },
+        { QStringLiteral("id"), QString::number(static_cast<qulonglong>(id), 16) },
+        { QStringLiteral("pid"), QCoreApplication::applicationPid() },
+        { QStringLiteral("tid"), static_cast<qulonglong>(reinterpret_cast<quintptr>(QThread::currentThreadId())) } };
+    if (!args.isEmpty())
+        event.insert(QStringLiteral("args"), args);
+
+    QMutexLocker lock(&_mutex);
+    writeEvent(event);
+    event[QStringLiteral("ph")] = QStringLiteral("e");
+    event[QStringLiteral("ts")] = now;
+    event.remove(QStringLiteral("args"));
+    writeEvent(event);
+}
+
+void Tracer::flush()
+{
+    QMutexLocker lock(&_mutex);
+    if (_file.isOpen())
+        _file.flush();
+}
+
+void Tracer::writeEvent(const QVariantMap &event)
+{
+    if (!_file.isOpen())
+        return;
+    _file.write(_firstEvent ? "\n" : ",\n");
+    _file.write(QJsonDocument(QJsonObject::fromVariantMap(event)).toJson(QJsonDocument::Compact));
+    _firstEvent = false;
+}
+
+TraceSpan::TraceSpan(const char *category, const char *name, const QString &detail)
+    : _category(category)
+{
+    auto tracer = Tracer::instance();
+    if (tracer->isEnabled()) {
+        _name = QString::fromLatin1(name);
+        if (!detail.isEmpty())
+            _name += QLatin1Char(' ') + detail;
+        _start = tracer->timestamp();
+    }
+}
+
+TraceSpan::~TraceSpan()
+{
+    if (_start >= 0)
+        Tracer::instance()->completeSpan(_category, _name, _start, _args);
+}
+
+void TraceSpan::setArgument(const QString &key, const QVariant &value)
+{
+    if (_start >= 0)
+        _args.insert(key, value);
+}
+
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) by Nextcloud GmbH
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#pragma once
+
+#include "ocsynclib.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+#include <QString>
+#include <QVariantMap>
+
+#include <atomic>
+
+namespace OCC {
+
+/**
+ * @brief Records timing spans of the sync into a trace file
+ *
+ * The file uses the JSON array flavour of the Chrome trace event format
+ * and can be opened with chrome://tracing or ui.perfetto.dev. Events are
+ * appended as they finish, the closing bracket is optional in that format
+ * so the file stays valid if the process dies.
+ *
+ * Tracing is off by default. A disabled span then only checks isEnabled(),
+ * call sites must not build names or arguments before that check. It is
+ * enabled with start(), the --tracefile option of the client and of
+ * nextcloudcmd or the OWNCLOUD_TRACE_FILE environment variable.
+ */
+class OCSYNC_EXPORT Tracer
+{
+public:
+    static Tracer *instance();
+
+    /// Starts writing events to fileName, replacing its contents
+    bool start(const QString &fileName);
+    void stop();
+
+    [[nodiscard]] bool isEnabled() const { return _enabled.load(std::memory_order_relaxed); }
+
+    /// Microseconds since start(), the time base of all events
+    [[nodiscard]] qint64 timestamp() const;
+
+    /** Records a span that began at startTimestamp and ends now
+     *
+     * The span belongs to the calling thread and must nest with the other
+     * spans of that thread, like a function call.
+     */
+    void completeSpan(const char *category, const QString &name, qint64 startTimestamp, const QVariantMap &args = {});
+
+    /** Records a span that may overlap others, like a network job
+     *
+     * id must be unique among the spans of the category that are running
+     * at the same time, the address of the job object does.
+     */
+    void asyncSpan(const char *category, const QString &name, quintptr id, qint64 startTimestamp, const QVariantMap &args = {});
+
+    /// Pushes the written events to disk, e.g. at the end of a sync run
+    void flush();
+
+private:
+    Tracer();
+    ~Tracer();
+
+    // Needs _mutex
+    void writeEvent(const QVariantMap &event);
+
+    std::atomic<bool> _enabled{ false };
+    QMutex _mutex;
+    QFile _file;
+    bool _firstEvent = true;
+    QElapsedTimer _clock;
+};
+
+/**
+ * @brief Records a Tracer::completeSpan() for the lifetime of the object
+ *
+ * Does nothing when tracing is disabled. The name is only put together
+ * from name and detail when the span is recorded.
+ */
+class OCSYNC_EXPORT TraceSpan
+{
+public:
+    /// The span is called name, followed by detail if that is not empty
+    TraceSpan(const char *category, const char *name, const QString &detail = QString());
+    ~TraceSpan();
+
+    TraceSpan(const TraceSpan &) = delete;
+    TraceSpan &operator=(const TraceSpan &) = delete;
+
+    /// Extra information shown with the span, only kept when tracing
+    void setArgument(const QString &key, const QVariant &value);
+
+private:
+    const char *_category;
+    QString _name;
+    qint64 _start = -1;
+    QVariantMap _args;
+};
+
+}
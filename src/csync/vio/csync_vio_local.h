@@ -21,6 +21,11 @@
 #ifndef _CSYNC_VIO_LOCAL_H
 #define _CSYNC_VIO_LOCAL_H
 
+#include <cstdint>
+#include <ctime>
+
+#include <QByteArray>
+#include <QHash>
 #include <QString>
 
 struct csync_vio_handle_t;
@@ -28,10 +33,39 @@ namespace OCC {
 class Vfs;
 }
 
+/**
+ * Journal metadata of a hydrated file, see csync_vio_local_set_known_files()
+ */
+struct csync_vio_local_known_file_t {
+    int64_t size = 0;
+    time_t modtime = 0;
+    uint64_t inode = 0;
+};
+
+/**
+ * What csync_vio_local_readdir() passes as stat_data to
+ * Vfs::statTypeVirtualFile() on unix.
+ */
+struct csync_vio_local_unix_stat_data_t {
+    const QByteArray *parentPath; // encoded directory path, no trailing slash
+    const QByteArray *fullPath; // encoded path of the entry
+    int dirFd; // descriptor of the open parent directory
+    bool matchesKnownFile; // entry is unchanged since it was synced as a hydrated file
+};
+
 csync_vio_handle_t OCSYNC_EXPORT *csync_vio_local_opendir(const QString &name);
 int OCSYNC_EXPORT csync_vio_local_closedir(csync_vio_handle_t *dhandle);
 std::unique_ptr<csync_file_stat_t> OCSYNC_EXPORT csync_vio_local_readdir(csync_vio_handle_t *dhandle, OCC::Vfs *vfs);
 
+/**
+ * Tells readdir about files that the journal knows as hydrated, keyed by
+ * their utf8 name. Entries whose size, mtime and inode still match can't
+ * have become placeholders and don't need to be probed by the vfs.
+ *
+ * Only used on unix, a no-op elsewhere.
+ */
+void OCSYNC_EXPORT csync_vio_local_set_known_files(csync_vio_handle_t *dhandle, const QHash<QByteArray, csync_vio_local_known_file_t> &knownFiles);
+
 int OCSYNC_EXPORT csync_vio_local_stat(const QString &uri, csync_file_stat_t *buf);
 
 #endif /* _CSYNC_VIO_LOCAL_H */
@@ -47,9 +47,11 @@ Q_LOGGING_CATEGORY(lcCSyncVIOLocal, "nextcloud.sync.csync.vio_local", QtInfoMsg)
 struct csync_vio_handle_t {
   DIR *dh;
   QByteArray path;
+  QHash<QByteArray, csync_vio_local_known_file_t> knownFiles;
 };
 
 static int _csync_vio_local_stat_mb(const mbchar_t *wuri, csync_file_stat_t *buf);
+static void _csync_vio_local_fill_stat(const csync_stat_t &sb, csync_file_stat_t *buf);
 
 csync_vio_handle_t *csync_vio_local_opendir(const QString &name) {
     QScopedPointer<csync_vio_handle_t> handle(new csync_vio_handle_t{});
@@ -115,22 +117,41 @@ std::unique_ptr<csync_file_stat_t> csync_vio_local_readdir(csync_vio_handle_t *h
   if (file_stat->path.isNull())
       return file_stat;
 
-  if (_csync_vio_local_stat_mb(fullPath.constData(), file_stat.get()) < 0) {
+  // Stat relative to the open directory, that saves resolving the full path
+  const auto dirFd = dirfd(handle->dh);
+  csync_stat_t sb{};
+  if (fstatat(dirFd, dirent->d_name, &sb, AT_SYMLINK_NOFOLLOW) < 0) {
       // Will get excluded by _csync_detect_update.
       file_stat->type = ItemTypeSkip;
+  } else {
+      _csync_vio_local_fill_stat(sb, file_stat.get());
   }
 
   // Override type for virtual files if desired
   if (vfs) {
+      csync_vio_local_unix_stat_data_t statData{ &handle->path, &fullPath, dirFd, false };
+      const auto known = handle->knownFiles.constFind(file_stat->path);
+      if (known != handle->knownFiles.constEnd() && file_stat->type == ItemTypeFile) {
+          statData.matchesKnownFile = known->size == file_stat->size
+              && known->modtime == file_stat->modtime
+              && known->inode == file_stat->inode;
+      }
+
       // Directly modifies file_stat->type.
       // We can ignore the return value since we're done here anyway.
-      const auto result = vfs->statTypeVirtualFile(file_stat.get(), &handle->path);
+      const auto result = vfs->statTypeVirtualFile(file_stat.get(), &statData);
       Q_UNUSED(result)
   }
 
   return file_stat;
 }
 
+void csync_vio_local_set_known_files(csync_vio_handle_t *handle, const QHash<QByteArray, csync_vio_local_known_file_t> &knownFiles)
+{
+    Q_ASSERT(handle);
+    handle->knownFiles = knownFiles;
+}
+
 
 int csync_vio_local_stat(const QString &uri, csync_file_stat_t *buf)
 {
@@ -145,6 +166,12 @@ static int _csync_vio_local_stat_mb(const mbchar_t *wuri, csync_file_stat_t *buf
         return -1;
     }
 
+    _csync_vio_local_fill_stat(sb, buf);
+    return 0;
+}
+
+static void _csync_vio_local_fill_stat(const csync_stat_t &sb, csync_file_stat_t *buf)
+{
     switch (sb.st_mode & S_IFMT) {
     case S_IFDIR:
       buf->type = ItemTypeDirectory;
@@ -170,5 +197,4 @@ static int _csync_vio_local_stat_mb(const mbchar_t *wuri, csync_file_stat_t *buf
   buf->inode = sb.st_ino;
   buf->modtime = sb.st_mtime;
   buf->size = sb.st_size;
-  return 0;
 }
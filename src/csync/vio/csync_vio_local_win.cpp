@@ -113,6 +113,11 @@ static time_t FileTimeToUnixTime(FILETIME *filetime, DWORD *remainder)
     }
 }
 
+void csync_vio_local_set_known_files(csync_vio_handle_t *, const QHash<QByteArray, csync_vio_local_known_file_t> &)
+{
+    // The cfapi plugin gets the placeholder state from the find data for free
+}
+
 std::unique_ptr<csync_file_stat_t> csync_vio_local_readdir(csync_vio_handle_t *handle, OCC::Vfs *vfs) {
 
   std::unique_ptr<csync_file_stat_t> file_stat;
@@ -45,6 +45,7 @@
 #include "version.h"
 #include "csync_exclude.h"
 #include "common/vfs.h"
+#include "common/tracer.h"
 
 #include "config.h"
 
@@ -83,6 +84,7 @@ namespace {
         "                         (to be used with --logdir)\n"
         "  --logflush           : flush the log file after every write.\n"
         "  --logdebug           : also output debug-level messages in the log.\n"
+        "  --tracefile <file>   : record sync timings in Chrome trace format to <file>.\n"
         "  --confdir <dirname>  : Use the given configuration folder.\n"
         "  --background         : launch the application in the background.\n";
 
@@ -546,6 +548,10 @@ void Application::setupLogging()
 
     logger->enterNextLogFile();
 
+    if (!_traceFile.isEmpty()) {
+        Tracer::instance()->start(_traceFile);
+    }
+
     qCInfo(lcApplication) << "##################" << _theme->appName()
                           << "locale:" << QLocale::system().name()
                           << "ui_lang:" << property("ui_lang")
@@ -632,6 +638,12 @@ void Application::parseOptions(const QStringList &options)
             _logFlush = true;
         } else if (option == QLatin1String("--logdebug")) {
             _logDebug = true;
+        } else if (option == QLatin1String("--tracefile")) {
+            if (it.hasNext() && !it.peekNext().startsWith(QLatin1String("--"))) {
+                _traceFile = it.next();
+            } else {
+                showHint("Trace file not specified");
+            }
         } else if (option == QLatin1String("--confdir")) {
             if (it.hasNext() && !it.peekNext().startsWith(QLatin1String("--"))) {
                 QString confDir = it.next();
@@ -137,6 +137,7 @@ private:
     int _logExpire;
     bool _logFlush;
     bool _logDebug;
+    QString _traceFile;
     bool _userTriggeredConnect;
     bool _debugMode;
     bool _backgroundMode;
@@ -145,9 +145,15 @@ Folder::Folder(const FolderDefinition &definition,
 Folder::~Folder()
 {
     // If wipeForRemoval() was called the vfs has already shut down.
-    if (_vfs)
+    if (_vfs) {
         _vfs->stop();
 
+        // Allow the next start to skip the full local discovery
+        _localDiscoveryTracker->persistToJournal(&_journal,
+            _folderWatcher && _folderWatcher->isReliable() && _timeSinceLastFullLocalDiscovery.isValid(),
+            _fullLocalDiscoveryAgeAtStart + std::chrono::milliseconds(_timeSinceLastFullLocalDiscovery.elapsed()));
+    }
+
     // Reset then engine first as it will abort and try to access members of the Folder
     _engine.reset();
 }
@@ -860,10 +866,13 @@ void Folder::startSync(const QStringList &pathList)
         }
         return interval;
     }();
+    // Files that were just touched or requested by the user are propagated first
+    _engine->setPriorityPaths(_localDiscoveryTracker->localDiscoveryPaths());
+
     bool hasDoneFullLocalDiscovery = _timeSinceLastFullLocalDiscovery.isValid();
     bool periodicFullLocalDiscoveryNow =
         fullLocalDiscoveryInterval.count() >= 0 // negative means we don't require periodic full runs
-        && _timeSinceLastFullLocalDiscovery.hasExpired(fullLocalDiscoveryInterval.count());
+        && _fullLocalDiscoveryAgeAtStart.count() + _timeSinceLastFullLocalDiscovery.elapsed() > fullLocalDiscoveryInterval.count();
     if (_folderWatcher && _folderWatcher->isReliable()
         && hasDoneFullLocalDiscovery
         && !periodicFullLocalDiscoveryNow) {
@@ -917,6 +926,9 @@ SyncOptions Folder::initializeSyncOptions() const
     opt._minChunkSize = cfgFile.minChunkSize();
     opt._maxChunkSize = cfgFile.maxChunkSize();
     opt._targetChunkUploadDuration = cfgFile.targetChunkUploadDuration();
+    opt._minServerSideCopySize = cfgFile.minServerSideCopySize();
+    opt._progressUpdateInterval = cfgFile.progressUpdateInterval();
+    opt._remoteChangeSearch = cfgFile.remoteChangeSearch();
 
     opt.fillFromEnvironmentVariables();
     opt.verifyChunkSizes();
@@ -1012,6 +1024,7 @@ void Folder::slotSyncFinished(bool success)
         && success) {
         if (_engine->lastLocalDiscoveryStyle() == LocalDiscoveryStyle::FilesystemOnly) {
             _timeSinceLastFullLocalDiscovery.start();
+            _fullLocalDiscoveryAgeAtStart = {};
         }
     }
 
@@ -1256,6 +1269,13 @@ void Folder::registerFolderWatcher()
         this, &Folder::slotWatcherUnreliable);
     _folderWatcher->init(path());
     _folderWatcher->startNotificatonTest(path() + QLatin1String(".owncloudsync.log"));
+
+    // Now that changes are tracked again, pick up the state from the last
+    // clean shutdown. It is as good as a full local discovery, but the periodic
+    // full local discovery stays due when it was before the shutdown.
+    if (_localDiscoveryTracker->restoreFromJournal(&_journal, path(), &_fullLocalDiscoveryAgeAtStart)) {
+        _timeSinceLastFullLocalDiscovery.start();
+    }
 }
 
 bool Folder::virtualFilesEnabled() const
@@ -459,6 +459,9 @@ private:
     QElapsedTimer _timeSinceLastSyncDone;
     QElapsedTimer _timeSinceLastSyncStart;
     QElapsedTimer _timeSinceLastFullLocalDiscovery;
+    /// Age of the last full local discovery when _timeSinceLastFullLocalDiscovery
+    /// was started, only non-zero when it was restored from the journal.
+    std::chrono::milliseconds _fullLocalDiscoveryAgeAtStart{0};
     std::chrono::milliseconds _lastSyncDuration;
 
     /// The number of syncs that failed in a row.
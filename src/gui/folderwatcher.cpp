@@ -32,15 +32,23 @@
 #include "folderwatcher_linux.h"
 #endif
 
+#ifndef FOLDERWATCHER_WITHOUT_FOLDER
 #include "folder.h"
+#endif
 #include "filesystem.h"
+#include "common/utility.h"
 
 namespace OCC {
 
 Q_LOGGING_CATEGORY(lcFolderWatcher, "nextcloud.gui.folderwatcher", QtInfoMsg)
 
 FolderWatcher::FolderWatcher(Folder *folder)
+#ifndef FOLDERWATCHER_WITHOUT_FOLDER
     : QObject(folder)
+#else
+    // Folder is incomplete here, nextcloudcmd never passes one
+    : QObject(nullptr)
+#endif
     , _folder(folder)
 {
 }
@@ -60,7 +68,7 @@ bool FolderWatcher::pathIsIgnored(const QString &path)
     if (!_folder)
         return false;
 
-#ifndef OWNCLOUD_TEST
+#if !defined(OWNCLOUD_TEST) && !defined(FOLDERWATCHER_WITHOUT_FOLDER)
     if (_folder->isFileExcludedAbsolute(path) && !Utility::isConflictFile(path)) {
         qCDebug(lcFolderWatcher) << "* Ignoring file" << path;
         return true;
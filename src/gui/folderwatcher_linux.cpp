@@ -16,10 +16,15 @@
 
 #include <sys/inotify.h>
 
+#ifndef FOLDERWATCHER_WITHOUT_FOLDER
 #include "folder.h"
+#endif
 #include "folderwatcher_linux.h"
 
 #include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <QFileInfo>
 #include <QStringList>
 #include <QObject>
 #include <QVarLengthArray>
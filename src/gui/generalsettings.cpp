@@ -35,6 +35,7 @@
 #include "ignorelisteditor.h"
 #include "common/utility.h"
 #include "logger.h"
+#include "httplogger.h"
 
 #include "legalnotice.h"
 
@@ -128,6 +129,11 @@ void createDebugArchive(const QString &filename)
     zip.prepareWriting("__nextcloud_client_buildinfo.txt", {}, {}, buildInfo.size());
     zip.writeData(buildInfo, buildInfo.size());
     zip.finishWriting(buildInfo.size());
+
+    const auto networkEvents = OCC::NetworkEventRecorder::instance()->renderText();
+    zip.prepareWriting("__nextcloud_network_events.txt", {}, {}, networkEvents.size());
+    zip.writeData(networkEvents, networkEvents.size());
+    zip.finishWriting(networkEvents.size());
 }
 }
 
@@ -195,7 +195,7 @@ Q_LOGGING_CATEGORY(lcSocketApi, "nextcloud.gui.socketapi", QtInfoMsg)
 Q_LOGGING_CATEGORY(lcPublicLink, "nextcloud.gui.socketapi.publiclink", QtInfoMsg)
 
 
-void SocketListener::sendMessage(const QString &message, bool doWait) const
+void SocketListener::sendMessage(const QString &message, bool doWait)
 {
     if (!socket) {
         qCWarning(lcSocketApi) << "Not sending message to dead socket:" << message;
@@ -203,19 +203,38 @@ void SocketListener::sendMessage(const QString &message, bool doWait) const
     }
 
     qCDebug(lcSocketApi) << "Sending SocketAPI message -->" << message << "to" << socket;
-    QString localMessage = message;
-    if (!localMessage.endsWith(QLatin1Char('\n'))) {
-        localMessage.append(QLatin1Char('\n'));
+    _pendingMessages += message.toUtf8();
+    if (!message.endsWith(QLatin1Char('\n'))) {
+        _pendingMessages += '\n';
     }
 
-    QByteArray bytesToSend = localMessage.toUtf8();
-    qint64 sent = socket->write(bytesToSend);
     if (doWait) {
-        socket->waitForBytesWritten(1000);
+        flush();
+        if (socket) {
+            socket->waitForBytesWritten(1000);
+        }
+    } else if (!_flushTimer.isActive()) {
+        _flushTimer.start();
     }
-    if (sent != bytesToSend.length()) {
-        qCWarning(lcSocketApi) << "Could not send all data on socket for " << localMessage;
+}
+
+void SocketListener::flush()
+{
+    _flushTimer.stop();
+    if (_pendingMessages.isEmpty()) {
+        return;
     }
+    if (!socket) {
+        qCWarning(lcSocketApi) << "Dropping" << _pendingMessages.size() << "bytes for dead socket";
+        _pendingMessages.clear();
+        return;
+    }
+
+    const qint64 sent = socket->write(_pendingMessages);
+    if (sent != _pendingMessages.size()) {
+        qCWarning(lcSocketApi) << "Could not send all data on socket, sent" << sent << "of" << _pendingMessages.size() << "bytes";
+    }
+    _pendingMessages.clear();
 }
 
 SocketApi::SocketApi(QObject *parent)
@@ -359,22 +378,21 @@ void SocketApi::slotReadSocket()
         // Make sure to normalize the input from the socket to
         // make sure that the path will match, especially on OS X.
         const QString line = QString::fromUtf8(socket->readLine().trimmed()).normalized(QString::NormalizationForm_C);
-        qCInfo(lcSocketApi) << "Received SocketAPI message <--" << line << "from" << socket;
         const int argPos = line.indexOf(QLatin1Char(':'));
         const QByteArray command = line.midRef(0, argPos).toUtf8().toUpper();
+
+        // File managers ask for the status of every file they show, answer those right away
+        if (command == "RETRIEVE_FILE_STATUS" || command == "RETRIEVE_FOLDER_STATUS") {
+            qCDebug(lcSocketApi) << "Received SocketAPI message <--" << line << "from" << socket;
+            command_RETRIEVE_FILE_STATUS(argPos != -1 ? line.mid(argPos + 1) : QString(), listener.data());
+            continue;
+        }
+
+        qCInfo(lcSocketApi) << "Received SocketAPI message <--" << line << "from" << socket;
         const int indexOfMethod = [&] {
-            QByteArray functionWithArguments = QByteArrayLiteral("command_");
-            if (command.startsWith("ASYNC_")) {
-                functionWithArguments += command + QByteArrayLiteral("(QSharedPointer<SocketApiJob>)");
-            } else if (command.startsWith("V2/")) {
-                functionWithArguments += QByteArrayLiteral("V2_") + command.mid(3) + QByteArrayLiteral("(QSharedPointer<SocketApiJobV2>)");
-            } else {
-                functionWithArguments += command + QByteArrayLiteral("(QString,SocketListener*)");
-            }
-            Q_ASSERT(staticQtMetaObject.normalizedSignature(functionWithArguments) == functionWithArguments);
-            const auto out = staticMetaObject.indexOfMethod(functionWithArguments);
+            const auto out = commandMethodIndexes().value(command, -1);
             if (out == -1) {
-                listener->sendError(QStringLiteral("Function %1 not found").arg(QString::fromUtf8(functionWithArguments)));
+                listener->sendError(QStringLiteral("Function command_%1 not found").arg(QString::fromUtf8(command)));
             }
             ASSERT(out != -1)
             return out;
@@ -433,6 +451,27 @@ void SocketApi::slotReadSocket()
     }
 }
 
+const QHash<QByteArray, int> &SocketApi::commandMethodIndexes()
+{
+    static const auto indexes = [] {
+        QHash<QByteArray, int> out;
+        const QByteArray prefix = QByteArrayLiteral("command_");
+        for (int i = staticMetaObject.methodOffset(); i < staticMetaObject.methodCount(); ++i) {
+            const auto name = staticMetaObject.method(i).name();
+            if (!name.startsWith(prefix)) {
+                continue;
+            }
+            auto command = name.mid(prefix.size());
+            if (command.startsWith("V2_")) {
+                command = QByteArrayLiteral("V2/") + command.mid(3);
+            }
+            out.insert(command, i);
+        }
+        return out;
+    }();
+    return indexes;
+}
+
 void SocketApi::slotRegisterPath(const QString &alias)
 {
     // Make sure not to register twice to each connected client
@@ -545,9 +584,9 @@ void SocketApi::broadcastStatusPushMessage(const QString &systemPath, SyncFileSt
 {
     QString msg = buildMessage(QLatin1String("STATUS"), systemPath, fileStatus.toSocketAPIString());
     Q_ASSERT(!systemPath.endsWith('/'));
-    uint directoryHash = qHash(systemPath.left(systemPath.lastIndexOf('/')));
+    const QString directory = systemPath.left(systemPath.lastIndexOf('/'));
     for (const auto &listener : qAsConst(_listeners)) {
-        listener->sendMessageIfDirectoryMonitored(msg, directoryHash);
+        listener->sendMessageIfDirectoryMonitored(msg, directory);
     }
 }
 
@@ -569,7 +608,7 @@ void SocketApi::command_RETRIEVE_FILE_STATUS(const QString &argument, SocketList
         // The user probably visited this directory in the file shell.
         // Let the listener know that it should now send status pushes for sibblings of this file.
         QString directory = fileData.localPath.left(fileData.localPath.lastIndexOf('/'));
-        listener->registerMonitoredDirectory(qHash(directory));
+        listener->registerMonitoredDirectory(directory);
 
         SyncFileStatus fileStatus = fileData.syncFileStatus();
         statusString = fileStatus.toSocketAPIString();
@@ -1076,7 +1115,7 @@ void SocketApi::sendSharingContextMenuOptions(const FileData &fileData, SocketLi
 void SocketApi::sendLockFileCommandMenuEntries(const QFileInfo &fileInfo,
                                                Folder* const syncFolder,
                                                const FileData &fileData,
-                                               const OCC::SocketListener* const listener) const
+                                               OCC::SocketListener* const listener) const
 {
     if (!fileInfo.isDir() && syncFolder->accountState()->account()->capabilities().filesLockAvailable()) {
         if (syncFolder->accountState()->account()->fileLockStatus(syncFolder->journalDb(), fileData.folderRelativePath) == SyncFileItem::LockStatus::UnlockedItem) {
@@ -1092,7 +1131,7 @@ void SocketApi::sendLockFileCommandMenuEntries(const QFileInfo &fileInfo,
 void SocketApi::sendLockFileInfoMenuEntries(const QFileInfo &fileInfo,
                                             Folder * const syncFolder,
                                             const FileData &fileData,
-                                            const SocketListener * const listener,
+                                            SocketListener * const listener,
                                             const SyncJournalFileRecord &record) const
 {
     static constexpr auto SECONDS_PER_MINUTE = 60;
@@ -101,6 +101,10 @@ private:
 
     void broadcastMessage(const QString &msg, bool doWait = false);
 
+    // Maps the upper case commands received on the socket to the index of
+    // their command_ method, built once from the meta object
+    static const QHash<QByteArray, int> &commandMethodIndexes();
+
     // opens share dialog, sends reply
     void processShareRequest(const QString &localFile, SocketListener *listener, ShareDialogStartPage startPage);
     void processFileActivityRequest(const QString &localFile);
@@ -153,12 +157,12 @@ private:
     void sendLockFileCommandMenuEntries(const QFileInfo &fileInfo,
                                         Folder * const syncFolder,
                                         const FileData &fileData,
-                                        const SocketListener * const listener) const;
+                                        SocketListener * const listener) const;
 
     void sendLockFileInfoMenuEntries(const QFileInfo &fileInfo,
                                      Folder * const syncFolder,
                                      const FileData &fileData,
-                                     const SocketListener * const listener,
+                                     SocketListener * const listener,
                                      const SyncJournalFileRecord &record) const;
 
     /** Send the list of menu item. (added in version 1.1)
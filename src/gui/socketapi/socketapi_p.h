@@ -18,7 +18,9 @@
 #define SOCKETAPI_P_H
 
 #include <functional>
-#include <QBitArray>
+#include <list>
+#include <QHash>
+#include <QIODevice>
 #include <QPointer>
 
 #include <QJsonDocument>
@@ -29,32 +31,49 @@
 
 namespace OCC {
 
-class BloomFilter
+/**
+ * @brief The directories a file manager extension looked at recently
+ *
+ * Status pushes are only sent for files in these directories. Once the
+ * capacity is reached, the least recently used directory is dropped.
+ */
+class MonitoredDirectories
 {
-    // Initialize with m=1024 bits and k=2 (high and low 16 bits of a qHash).
-    // For a client navigating in less than 100 directories, this gives us a probability less than
-    // (1-e^(-2*100/1024))^2 = 0.03147872136 false positives.
-    const static int NumBits = 1024;
-
 public:
-    BloomFilter()
-        : hashBits(NumBits)
+    static constexpr int DefaultCapacity = 512;
+
+    explicit MonitoredDirectories(int capacity = DefaultCapacity)
+        : _capacity(capacity)
     {
     }
 
-    void storeHash(uint hash)
+    void insert(const QString &directory)
     {
-        hashBits.setBit((hash & 0xFFFF) % NumBits); // NOLINT it's uint all the way and the modulo puts us back in the 0..1023 range
-        hashBits.setBit((hash >> 16) % NumBits); // NOLINT
+        const auto it = _index.constFind(directory);
+        if (it != _index.constEnd()) {
+            _lru.splice(_lru.begin(), _lru, it.value());
+            return;
+        }
+        _lru.push_front(directory);
+        _index.insert(directory, _lru.begin());
+        if (_lru.size() > static_cast<size_t>(_capacity)) {
+            _index.remove(_lru.back());
+            _lru.pop_back();
+        }
     }
-    bool isHashMaybeStored(uint hash) const
+
+    [[nodiscard]] bool contains(const QString &directory) const
     {
-        return hashBits.testBit((hash & 0xFFFF) % NumBits) // NOLINT
-            && hashBits.testBit((hash >> 16) % NumBits); // NOLINT
+        return _index.contains(directory);
     }
 
+    [[nodiscard]] int size() const { return _index.size(); }
+
 private:
-    QBitArray hashBits;
+    int _capacity;
+    // Most recently used first
+    std::list<QString> _lru;
+    QHash<QString, std::list<QString>::iterator> _index;
 };
 
 class SocketListener
@@ -65,31 +84,41 @@ public:
     explicit SocketListener(QIODevice *_socket)
         : socket(_socket)
     {
+        // Messages are written once per event loop iteration, file managers
+        // get flooded with status pushes during large syncs otherwise
+        _flushTimer.setSingleShot(true);
+        _flushTimer.setInterval(0);
+        QObject::connect(&_flushTimer, &QTimer::timeout, &_flushTimer, [this] { flush(); });
     }
 
-    void sendMessage(const QString &message, bool doWait = false) const;
-    void sendWarning(const QString &message, bool doWait = false) const
+    void sendMessage(const QString &message, bool doWait = false);
+    void sendWarning(const QString &message, bool doWait = false)
     {
         sendMessage(QStringLiteral("WARNING:") + message, doWait);
     }
-    void sendError(const QString &message, bool doWait = false) const
+    void sendError(const QString &message, bool doWait = false)
     {
         sendMessage(QStringLiteral("ERROR:") + message, doWait);
     }
 
-    void sendMessageIfDirectoryMonitored(const QString &message, uint systemDirectoryHash) const
+    /// Writes the queued messages to the socket
+    void flush();
+
+    void sendMessageIfDirectoryMonitored(const QString &message, const QString &systemDirectory)
     {
-        if (_monitoredDirectoriesBloomFilter.isHashMaybeStored(systemDirectoryHash))
+        if (_monitoredDirectories.contains(systemDirectory))
             sendMessage(message, false);
     }
 
-    void registerMonitoredDirectory(uint systemDirectoryHash)
+    void registerMonitoredDirectory(const QString &systemDirectory)
     {
-        _monitoredDirectoriesBloomFilter.storeHash(systemDirectoryHash);
+        _monitoredDirectories.insert(systemDirectory);
     }
 
 private:
-    BloomFilter _monitoredDirectoriesBloomFilter;
+    MonitoredDirectories _monitoredDirectories;
+    QByteArray _pendingMessages;
+    QTimer _flushTimer;
 };
 
 class ListenerClosure : public QObject
@@ -70,7 +70,11 @@ void AbstractPropagateRemoteDeleteEncrypted::slotFolderEncryptedIdReceived(const
     qCDebug(ABSTRACT_PROPAGATE_REMOVE_ENCRYPTED) << "Received id of folder, trying to lock it so we can prepare the metadata";
     auto job = qobject_cast<LsColJob *>(sender());
     const ExtraFolderInfo folderInfo = job->_folderInfos.value(list.first());
-    slotTryLock(folderInfo.fileId);
+    // Uploads running in parallel may still hold the lock of the folder
+    const auto folderId = folderInfo.fileId;
+    _propagator->whenEncryptedFolderUnlocked(folderId, this, [this, folderId] {
+        slotTryLock(folderId);
+    });
 }
 
 void AbstractPropagateRemoteDeleteEncrypted::slotTryLock(const QByteArray &folderId)
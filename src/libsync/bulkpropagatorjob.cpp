@@ -64,8 +64,6 @@ QByteArray getHeaderFromJsonReply(const QJsonObject &reply, const QByteArray &he
     return reply.value(headerName).toString().toLatin1();
 }
 
-constexpr auto batchSize = 100;
-
 constexpr auto parallelJobsMaximumCount = 1;
 }
 
@@ -76,6 +74,7 @@ BulkPropagatorJob::BulkPropagatorJob(OwncloudPropagator *propagator,
     : PropagatorJob(propagator)
     , _items(items)
 {
+    const auto batchSize = propagator->syncOptions()._bulkUploadBatchSize;
     _filesToUpload.reserve(batchSize);
     _pendingChecksumFiles.reserve(batchSize);
 }
@@ -90,6 +89,7 @@ bool BulkPropagatorJob::scheduleSelfOrChild()
     }
 
     _state = Running;
+    const auto batchSize = propagator()->syncOptions()._bulkUploadBatchSize;
     for(int i = 0; i < batchSize && !_items.empty(); ++i) {
         auto currentItem = _items.front();
         _items.pop_front();
@@ -34,6 +34,7 @@
 #include <QUuid>
 #include <QScopeGuard>
 #include <QRandomGenerator>
+#include <QCryptographicHash>
 
 #include <qt5keychain/keychain.h>
 #include <common/utility.h>
@@ -1064,6 +1065,7 @@ void ClientSideEncryption::forgetSensitiveData(const AccountPtr &account)
     _certificate = QSslCertificate();
     _publicKey = QSslKey();
     _mnemonic = QString();
+    _folderMetadataCache.clear();
 
     auto startDeleteJob = [account](QString user) {
         auto *job = new DeletePasswordJob(Theme::instance()->appName());
@@ -1365,6 +1367,48 @@ void ClientSideEncryption::fetchAndValidatePublicKeyFromServer(const AccountPtr
     job->start();
 }
 
+FolderMetadataCache::FolderMetadataCache(int maxFileNames)
+    : _entries(maxFileNames)
+{
+}
+
+Optional<FolderMetadataCache::FileNames> FolderMetadataCache::fileNamesForEtag(const QByteArray &fileId, const QByteArray &etag) const
+{
+    // Marks the entry as recently used
+    const auto entry = _entries.object(fileId);
+    if (!entry || etag.isEmpty() || entry->etag != etag) {
+        return {};
+    }
+    return entry->fileNames;
+}
+
+Optional<FolderMetadataCache::FileNames> FolderMetadataCache::fileNamesForMetadata(const QByteArray &fileId, const QByteArray &etag, const QByteArray &metadata)
+{
+    const auto entry = _entries.object(fileId);
+    if (!entry || entry->metadataHash != QCryptographicHash::hash(metadata, QCryptographicHash::Sha256)) {
+        return {};
+    }
+    entry->etag = etag;
+    return entry->fileNames;
+}
+
+void FolderMetadataCache::insert(const QByteArray &fileId, const QByteArray &etag, const QByteArray &metadata, const FileNames &fileNames)
+{
+    // Empty folders still take a slot
+    const auto cost = qMax(1, fileNames.size());
+    _entries.insert(fileId, new Entry{ etag, QCryptographicHash::hash(metadata, QCryptographicHash::Sha256), fileNames }, cost);
+}
+
+void FolderMetadataCache::clear()
+{
+    _entries.clear();
+}
+
+int FolderMetadataCache::size() const
+{
+    return _entries.size();
+}
+
 FolderMetadata::FolderMetadata(AccountPtr account, const QByteArray& metadata, int statusCode) : _account(account)
 {
     if (metadata.isEmpty() || statusCode == 404) {
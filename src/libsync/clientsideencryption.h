@@ -9,6 +9,8 @@
 #include <QFile>
 #include <QVector>
 #include <QMap>
+#include <QHash>
+#include <QCache>
 
 #include <openssl/evp.h>
 
@@ -113,6 +115,40 @@ private:
 };
 }
 
+/* Keeps the decrypted file names of encrypted folders between discoveries
+ *
+ * Entries are keyed by the file id of the folder. They are used without
+ * asking the server while the folder etag is unchanged, and without
+ * decrypting the metadata again while the server returns the same one.
+ *
+ * The least recently used folders are dropped once the cached file names
+ * exceed maxFileNames.
+ */
+class OWNCLOUDSYNC_EXPORT FolderMetadataCache {
+public:
+    // encrypted file name -> original file name
+    using FileNames = QHash<QString, QString>;
+
+    explicit FolderMetadataCache(int maxFileNames = 100000);
+
+    Optional<FileNames> fileNamesForEtag(const QByteArray &fileId, const QByteArray &etag) const;
+
+    // Also makes etag the current etag of the entry when the metadata matches
+    Optional<FileNames> fileNamesForMetadata(const QByteArray &fileId, const QByteArray &etag, const QByteArray &metadata);
+
+    void insert(const QByteArray &fileId, const QByteArray &etag, const QByteArray &metadata, const FileNames &fileNames);
+    void clear();
+    int size() const;
+
+private:
+    struct Entry {
+        QByteArray etag;
+        QByteArray metadataHash;
+        FileNames fileNames;
+    };
+    QCache<QByteArray, Entry> _entries;
+};
+
 class OWNCLOUDSYNC_EXPORT ClientSideEncryption : public QObject {
     Q_OBJECT
 public:
@@ -165,6 +201,7 @@ public:
     QSslCertificate _certificate;
     QString _mnemonic;
     bool _newMnemonicGenerated = false;
+    FolderMetadataCache _folderMetadataCache;
 };
 
 /* Generates the Metadata for the folder */
@@ -81,6 +81,9 @@ static const char chunkSizeC[] = "chunkSize";
 static const char minChunkSizeC[] = "minChunkSize";
 static const char maxChunkSizeC[] = "maxChunkSize";
 static const char targetChunkUploadDurationC[] = "targetChunkUploadDuration";
+static const char minServerSideCopySizeC[] = "minServerSideCopySize";
+static const char progressUpdateIntervalC[] = "progressUpdateInterval";
+static const char remoteChangeSearchC[] = "remoteChangeSearch";
 static const char automaticLogDirC[] = "logToTemporaryLogDir";
 static const char logDirC[] = "logDir";
 static const char logDebugC[] = "logDebug";
@@ -257,6 +260,24 @@ chrono::milliseconds ConfigFile::targetChunkUploadDuration() const
     return millisecondsValue(settings, targetChunkUploadDurationC, chrono::minutes(1));
 }
 
+qint64 ConfigFile::minServerSideCopySize() const
+{
+    QSettings settings(configFile(), QSettings::IniFormat);
+    return settings.value(QLatin1String(minServerSideCopySizeC), 1000 * 1000).toLongLong(); // default to 1 MB
+}
+
+chrono::milliseconds ConfigFile::progressUpdateInterval() const
+{
+    QSettings settings(configFile(), QSettings::IniFormat);
+    return millisecondsValue(settings, progressUpdateIntervalC, chrono::milliseconds(100));
+}
+
+bool ConfigFile::remoteChangeSearch() const
+{
+    QSettings settings(configFile(), QSettings::IniFormat);
+    return settings.value(QLatin1String(remoteChangeSearchC), false).toBool();
+}
+
 void ConfigFile::setOptionalServerNotifications(bool show)
 {
     QSettings settings(configFile(), QSettings::IniFormat);
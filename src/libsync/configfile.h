@@ -163,6 +163,9 @@ public:
     qint64 maxChunkSize() const;
     qint64 minChunkSize() const;
     std::chrono::milliseconds targetChunkUploadDuration() const;
+    qint64 minServerSideCopySize() const;
+    std::chrono::milliseconds progressUpdateInterval() const;
+    bool remoteChangeSearch() const;
 
     void saveGeometry(QWidget *w);
     void restoreGeometry(QWidget *w);
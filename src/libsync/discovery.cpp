@@ -15,6 +15,7 @@
 #include "discovery.h"
 #include "common/filesystembase.h"
 #include "common/syncjournaldb.h"
+#include "common/tracer.h"
 #include "filesystem.h"
 #include "syncfileitem.h"
 #include <QDebug>
@@ -69,6 +70,7 @@ void ProcessDirectoryJob::start()
 void ProcessDirectoryJob::process()
 {
     ASSERT(_localQueryDone && _serverQueryDone);
+    TraceSpan traceSpan("discovery", "process", _currentFolder._original);
 
     // Build lookup tables for local, remote and db entries.
     // For suffix-virtual files, the key will normally be the base file name
@@ -465,8 +467,11 @@ void ProcessDirectoryJob::processFileAnalyzeRemoteInfo(
     item->_remotePerm = serverEntry.remotePerm;
     item->_type = serverEntry.isDirectory ? ItemTypeDirectory : ItemTypeFile;
     item->_etag = serverEntry.etag;
-    item->_directDownloadUrl = serverEntry.directDownloadUrl;
-    item->_directDownloadCookies = serverEntry.directDownloadCookies;
+    if (!serverEntry.directDownloadUrl.isEmpty()) {
+        auto &extra = item->extraForUpdate();
+        extra._directDownloadUrl = serverEntry.directDownloadUrl;
+        extra._directDownloadCookies = serverEntry.directDownloadCookies;
+    }
     item->_isEncrypted = serverEntry.isE2eEncrypted;
     item->_encryptedFileName = [=] {
         if (serverEntry.e2eMangledName.isEmpty()) {
@@ -480,14 +485,17 @@ void ProcessDirectoryJob::processFileAnalyzeRemoteInfo(
         Q_ASSERT(serverEntry.e2eMangledName.startsWith(rootPath));
         return serverEntry.e2eMangledName.mid(rootPath.length());
     }();
-    item->_locked = serverEntry.locked;
-    item->_lockOwnerDisplayName = serverEntry.lockOwnerDisplayName;
-    item->_lockOwnerId = serverEntry.lockOwnerId;
-    item->_lockOwnerType = serverEntry.lockOwnerType;
-    item->_lockEditorApp = serverEntry.lockEditorApp;
-    item->_lockTime = serverEntry.lockTime;
-    item->_lockTimeout = serverEntry.lockTimeout;
-    qCInfo(lcDisco()) << item->_locked << item->_lockOwnerDisplayName << item->_lockOwnerId << item->_lockOwnerType << item->_lockEditorApp << item->_lockTime << item->_lockTimeout;
+    if (serverEntry.locked == SyncFileItem::LockStatus::LockedItem) {
+        auto &lock = item->extraForUpdate();
+        lock._locked = serverEntry.locked;
+        lock._lockOwnerDisplayName = serverEntry.lockOwnerDisplayName;
+        lock._lockOwnerId = serverEntry.lockOwnerId;
+        lock._lockOwnerType = serverEntry.lockOwnerType;
+        lock._lockEditorApp = serverEntry.lockEditorApp;
+        lock._lockTime = serverEntry.lockTime;
+        lock._lockTimeout = serverEntry.lockTimeout;
+        qCInfo(lcDisco()) << item->_file << "is locked" << lock._lockOwnerDisplayName << lock._lockOwnerId << lock._lockOwnerType << lock._lockEditorApp << lock._lockTime << lock._lockTimeout;
+    }
 
     // Check for missing server data
     {
@@ -1781,8 +1789,16 @@ void ProcessDirectoryJob::chopVirtualFileSuffix(QString &str) const
 
 DiscoverySingleDirectoryJob *ProcessDirectoryJob::startAsyncServerQuery()
 {
-    auto serverJob = new DiscoverySingleDirectoryJob(_discoveryData->_account,
-        _discoveryData->_remoteFolder + _currentFolder._server, this);
+    const auto serverPath = _discoveryData->_remoteFolder + _currentFolder._server;
+    if (_dirItem && _discoveryData->_syncOptions._remoteChangeSearch) {
+        if (const auto entries = _discoveryData->takePrefetchedListing(serverPath, _dirItem->_etag)) {
+            _serverNormalQueryEntries = *entries;
+            _serverQueryDone = true;
+            return nullptr;
+        }
+    }
+
+    auto serverJob = new DiscoverySingleDirectoryJob(_discoveryData->_account, serverPath, this);
     if (!_dirItem)
         serverJob->setIsRootPath(); // query the fingerprint on the root
     connect(serverJob, &DiscoverySingleDirectoryJob::etag, this, &ProcessDirectoryJob::etag);
@@ -1830,10 +1846,16 @@ void ProcessDirectoryJob::startAsyncLocalQuery()
 {
     QString localPath = _discoveryData->_localDir + _currentFolder._local;
     auto localJob = new DiscoverySingleLocalDirectoryJob(_discoveryData->_account, localPath, _discoveryData->_syncOptions._vfs.data());
+    localJob->setJournalPath(_discoveryData->_statedb, _currentFolder._original);
 
     _discoveryData->_currentlyActiveJobs++;
     _pendingAsyncJobs++;
 
+    connect(localJob, &DiscoverySingleLocalDirectoryJob::placeholderStatistics, _discoveryData, [this](int placeholderCount, int skippedProbeCount) {
+        _discoveryData->_localPlaceholderCount += placeholderCount;
+        _discoveryData->_skippedPlaceholderProbeCount += skippedProbeCount;
+    });
+
     connect(localJob, &DiscoverySingleLocalDirectoryJob::itemDiscovered, _discoveryData, &DiscoveryPhase::itemDiscovered);
 
     connect(localJob, &DiscoverySingleLocalDirectoryJob::childIgnored, this, [this](bool b) {
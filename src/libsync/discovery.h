@@ -226,6 +226,7 @@ private:
     /** Start a remote discovery network job
      *
      * It fills _serverNormalQueryEntries and sets _serverQueryDone when done.
+     * Returns nullptr if a listing prefetched by the DiscoveryPhase was used.
      */
     DiscoverySingleDirectoryJob *startAsyncServerQuery();
 
@@ -20,6 +20,9 @@
 
 #include "common/asserts.h"
 #include "common/checksums.h"
+#include "common/syncjournaldb.h"
+#include "common/tracer.h"
+#include "common/vfs.h"
 
 #include <csync_exclude.h>
 #include "vio/csync_vio_local.h"
@@ -37,6 +40,11 @@ namespace OCC {
 
 Q_LOGGING_CATEGORY(lcDiscovery, "nextcloud.sync.discovery", QtInfoMsg)
 
+// Client and server clocks differ, search a bit before the last sync
+static constexpr qint64 remoteChangeSearchMarginSecs = 10 * 60;
+// Beyond that many changed items the walk is left to find the rest
+static constexpr int remoteChangeSearchMaxResults = 1000;
+
 /* Given a sorted list of paths ending with '/', return whether or not the given path is within one of the paths of the list*/
 static bool findPathInList(const QStringList &list, const QString &path)
 {
@@ -255,6 +263,108 @@ void DiscoveryPhase::scheduleMoreJobs()
     if (_currentRootJob && _currentlyActiveJobs < limit) {
         _currentRootJob->processSubJobs(limit - _currentlyActiveJobs);
     }
+    // The walk goes first, prefetches only use the remaining slots
+    startNextPrefetches();
+}
+
+void DiscoveryPhase::startRemoteChangeSearch(qint64 lastSyncTimestamp)
+{
+    auto job = new SearchModifiedItemsJob(_account, _remoteFolder, lastSyncTimestamp - remoteChangeSearchMarginSecs, this);
+    job->setMaxResults(remoteChangeSearchMaxResults);
+    connect(job, &SearchModifiedItemsJob::finishedWithError, this, [](QNetworkReply *reply) {
+        qCInfo(lcDiscovery) << "Remote change search not available, discovering by etag only"
+                            << reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() << reply->errorString();
+    });
+    connect(job, &SearchModifiedItemsJob::finishedWithoutError, this, [this](const QStringList &directories, const QStringList &files) {
+        if (!_currentRootJob) {
+            return;
+        }
+
+        // Paths relative to the sync root of the changed directories and their parents
+        QSet<QString> changed;
+        const auto addWithParents = [&](QString path) {
+            while (!path.isEmpty() && !changed.contains(path)) {
+                changed.insert(path);
+                path = path.left(qMax(0, path.lastIndexOf(QLatin1Char('/'))));
+            }
+        };
+        const auto relativeToSyncRoot = [this](const QString &davPath) {
+            const auto serverPath = QLatin1Char('/') + davPath;
+            return serverPath.startsWith(_remoteFolder) ? serverPath.mid(_remoteFolder.size()) : QString();
+        };
+        for (const auto &directory : directories) {
+            addWithParents(relativeToSyncRoot(directory));
+        }
+        for (const auto &file : files) {
+            const auto path = relativeToSyncRoot(file);
+            addWithParents(path.left(qMax(0, path.lastIndexOf(QLatin1Char('/')))));
+        }
+
+        QStringList paths;
+        for (const auto &path : qAsConst(changed)) {
+            if (!isInSelectiveSyncBlackList(path) && !_listedServerPaths.contains(_remoteFolder + path)) {
+                paths.append(path);
+            }
+        }
+        // Shallow directories first, the walk reaches them first
+        std::sort(paths.begin(), paths.end(), [](const QString &a, const QString &b) {
+            const auto depthA = a.count(QLatin1Char('/'));
+            const auto depthB = b.count(QLatin1Char('/'));
+            return depthA != depthB ? depthA < depthB : a < b;
+        });
+        qCInfo(lcDiscovery) << "Remote change search found" << directories.size() + files.size() << "items,"
+                            << paths.size() << "directories to list ahead";
+        for (const auto &path : qAsConst(paths)) {
+            _prefetchQueue.push_back(_remoteFolder + path);
+        }
+        startNextPrefetches();
+    });
+    job->start();
+}
+
+void DiscoveryPhase::startNextPrefetches()
+{
+    const auto limit = qMax(1, _syncOptions._parallelNetworkJobs);
+    while (_currentRootJob && !_prefetchQueue.empty() && _currentlyActiveJobs < limit) {
+        const auto path = _prefetchQueue.front();
+        _prefetchQueue.pop_front();
+        if (_listedServerPaths.contains(path)) {
+            continue;
+        }
+
+        auto job = new DiscoverySingleDirectoryJob(_account, path, this);
+        auto etag = QSharedPointer<QByteArray>::create();
+        connect(job, &DiscoverySingleDirectoryJob::etag, this, [etag](const QByteArray &value, const QDateTime &) {
+            *etag = value;
+        });
+        connect(job, &DiscoverySingleDirectoryJob::finished, this, [this, path, etag](const HttpResult<QVector<RemoteInfo>> &results) {
+            _currentlyActiveJobs--;
+            // On errors the walk lists the directory itself and handles the error
+            if (results && !_listedServerPaths.contains(path)) {
+                _prefetchedListings.insert(path, { *etag, *results });
+            }
+            scheduleMoreJobs();
+        });
+        _currentlyActiveJobs++;
+        job->start();
+    }
+}
+
+Optional<QVector<RemoteInfo>> DiscoveryPhase::takePrefetchedListing(const QString &serverPath, const QByteArray &etag)
+{
+    _listedServerPaths.insert(serverPath);
+    const auto it = _prefetchedListings.find(serverPath);
+    if (it == _prefetchedListings.end()) {
+        return {};
+    }
+    const auto listing = *it;
+    _prefetchedListings.erase(it);
+    if (listing.etag != etag) {
+        qCInfo(lcDiscovery) << "Prefetched listing of" << serverPath << "is outdated" << listing.etag << etag;
+        return {};
+    }
+    ++_usedPrefetchedListingCount;
+    return listing.entries;
 }
 
 DiscoverySingleLocalDirectoryJob::DiscoverySingleLocalDirectoryJob(const AccountPtr &account, const QString &localPath, OCC::Vfs *vfs, QObject *parent)
@@ -263,12 +373,41 @@ DiscoverySingleLocalDirectoryJob::DiscoverySingleLocalDirectoryJob(const Account
     qRegisterMetaType<QVector<LocalInfo> >("QVector<LocalInfo>");
 }
 
+void DiscoverySingleLocalDirectoryJob::setJournalPath(SyncJournalDb *journal, const QString &dbPath)
+{
+    _journal = journal;
+    _dbPath = dbPath;
+}
+
+static QHash<QByteArray, csync_vio_local_known_file_t> hydratedFilesInJournal(SyncJournalDb *journal, const QString &dbPath)
+{
+    QHash<QByteArray, csync_vio_local_known_file_t> knownFiles;
+    const auto ok = journal->listFilesInPath(dbPath.toUtf8(), [&](const SyncJournalFileRecord &rec) {
+        if (rec._type != ItemTypeFile)
+            return;
+        const auto name = rec._path.mid(rec._path.lastIndexOf('/') + 1);
+        knownFiles.insert(name, { rec._fileSize, rec._modtime, rec._inode });
+    });
+    if (!ok) {
+        // Not fatal, all files just get probed
+        knownFiles.clear();
+    }
+    return knownFiles;
+}
+
 // Use as QRunnable
 void DiscoverySingleLocalDirectoryJob::run() {
+    TraceSpan traceSpan("discovery", "local", _localPath);
+
     QString localPath = _localPath;
     if (localPath.endsWith('/')) // Happens if _currentFolder._local.isEmpty()
         localPath.chop(1);
 
+    QHash<QByteArray, csync_vio_local_known_file_t> knownFiles;
+    if (_journal && _vfs && _vfs->mode() == Vfs::XAttr) {
+        knownFiles = hydratedFilesInJournal(_journal, _dbPath);
+    }
+
     auto dh = csync_vio_local_opendir(localPath);
     if (!dh) {
         qCInfo(lcDiscovery) << "Error while opening directory" << (localPath) << errno;
@@ -287,8 +426,11 @@ void DiscoverySingleLocalDirectoryJob::run() {
         emit finishedFatalError(errorString);
         return;
     }
+    csync_vio_local_set_known_files(dh, knownFiles);
 
     QVector<LocalInfo> results;
+    int placeholderCount = 0;
+    int skippedProbeCount = 0;
     while (true) {
         errno = 0;
         auto dirent = csync_vio_local_readdir(dh, _vfs);
@@ -322,6 +464,16 @@ void DiscoverySingleLocalDirectoryJob::run() {
         i.isVirtualFile = dirent->type == ItemTypeVirtualFile || dirent->type == ItemTypeVirtualFileDownload;
         i.type = dirent->type;
         results.push_back(i);
+
+        if (i.isVirtualFile) {
+            ++placeholderCount;
+        } else if (dirent->type == ItemTypeFile || dirent->type == ItemTypeVirtualFileDehydration) {
+            const auto known = knownFiles.constFind(dirent->path);
+            if (known != knownFiles.constEnd() && known->size == dirent->size
+                && known->modtime == dirent->modtime && known->inode == dirent->inode) {
+                ++skippedProbeCount;
+            }
+        }
     }
     if (errno != 0) {
         csync_vio_local_closedir(dh);
@@ -338,6 +490,7 @@ void DiscoverySingleLocalDirectoryJob::run() {
         qCWarning(lcDiscovery) << "closedir failed for file in " << localPath << " - errno: " << errno;
     }
 
+    emit placeholderStatistics(placeholderCount, skippedProbeCount);
     emit finished(results);
 }
 
@@ -354,6 +507,14 @@ DiscoverySingleDirectoryJob::DiscoverySingleDirectoryJob(const AccountPtr &accou
 
 void DiscoverySingleDirectoryJob::start()
 {
+    if (Tracer::instance()->isEnabled()) {
+        const auto traceStart = Tracer::instance()->timestamp();
+        connect(this, &DiscoverySingleDirectoryJob::finished, this, [this, traceStart](const HttpResult<QVector<RemoteInfo>> &result) {
+            Tracer::instance()->asyncSpan("discovery", QStringLiteral("PROPFIND ") + _subPath, reinterpret_cast<quintptr>(this), traceStart,
+                { { QStringLiteral("entries"), result ? result->size() : 0 } });
+        });
+    }
+
     // Start the actual HTTP job
     auto *lsColJob = new LsColJob(_account, _subPath, this);
 
@@ -573,6 +734,11 @@ void DiscoverySingleDirectoryJob::lsJobFinishedWithoutErrorSlot()
         return;
     } else if (_isE2eEncrypted) {
         emit etag(_firstEtag, QDateTime::fromString(QString::fromUtf8(_lsColJob->responseTimestamp()), Qt::RFC2822Date));
+        if (const auto fileNames = metadataCache().fileNamesForEtag(_localFileId, _firstEtag)) {
+            qCDebug(lcDiscovery) << "Metadata of" << _subPath << "unchanged since etag" << _firstEtag;
+            applyE2eFileNames(*fileNames);
+            return;
+        }
         fetchE2eMetadata();
         return;
     }
@@ -614,37 +780,49 @@ void DiscoverySingleDirectoryJob::fetchE2eMetadata()
 void DiscoverySingleDirectoryJob::metadataReceived(const QJsonDocument &json, int statusCode)
 {
     qCDebug(lcDiscovery) << "Metadata received, applying it to the result list";
-    Q_ASSERT(_subPath.startsWith('/'));
 
-    const auto metadata = FolderMetadata(_account, json.toJson(QJsonDocument::Compact), statusCode);
-    const auto encryptedFiles = metadata.files();
+    const auto rawMetadata = json.toJson(QJsonDocument::Compact);
+    if (const auto fileNames = metadataCache().fileNamesForMetadata(_localFileId, _firstEtag, rawMetadata)) {
+        applyE2eFileNames(*fileNames);
+        return;
+    }
 
-    const auto findEncryptedFile = [=](const QString &name) {
-        const auto it = std::find_if(std::cbegin(encryptedFiles), std::cend(encryptedFiles), [=](const EncryptedFile &file) {
-            return file.encryptedFilename == name;
-        });
-        if (it == std::cend(encryptedFiles)) {
-            return Optional<EncryptedFile>();
-        } else {
-            return Optional<EncryptedFile>(*it);
-        }
-    };
+    const auto metadata = FolderMetadata(_account, rawMetadata, statusCode);
+    FolderMetadataCache::FileNames fileNames;
+    bool decrypted = !_account->e2e()->_privateKey.isEmpty();
+    for (const auto &file : metadata.files()) {
+        decrypted = decrypted && !file.originalFilename.isEmpty();
+        fileNames.insert(file.encryptedFilename, file.originalFilename);
+    }
+    // Only remember metadata that could be read, a later discovery may have the keys
+    if (decrypted && statusCode == 200) {
+        metadataCache().insert(_localFileId, _firstEtag, rawMetadata, fileNames);
+    }
+    applyE2eFileNames(fileNames);
+}
 
-    std::transform(std::cbegin(_results), std::cend(_results), std::begin(_results), [=](const RemoteInfo &info) {
-        auto result = info;
-        const auto encryptedFileInfo = findEncryptedFile(result.name);
-        if (encryptedFileInfo) {
+void DiscoverySingleDirectoryJob::applyE2eFileNames(const FolderMetadataCache::FileNames &fileNames)
+{
+    Q_ASSERT(_subPath.startsWith('/'));
+
+    for (auto &result : _results) {
+        const auto it = fileNames.constFind(result.name);
+        if (it != fileNames.constEnd()) {
             result.isE2eEncrypted = true;
             result.e2eMangledName = _subPath.mid(1) + QLatin1Char('/') + result.name;
-            result.name = encryptedFileInfo->originalFilename;
+            result.name = *it;
         }
-        return result;
-    });
+    }
 
     emit finished(_results);
     deleteLater();
 }
 
+FolderMetadataCache &DiscoverySingleDirectoryJob::metadataCache() const
+{
+    return _account->e2e()->_folderMetadataCache;
+}
+
 void DiscoverySingleDirectoryJob::metadataError(const QByteArray &fileId, int httpReturnCode)
 {
     qCWarning(lcDiscovery) << "E2EE Metadata job error. Trying to proceed without it." << fileId << httpReturnCode;
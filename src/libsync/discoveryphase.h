@@ -27,6 +27,7 @@
 #include <deque>
 #include "syncoptions.h"
 #include "syncfileitem.h"
+#include "clientsideencryption.h"
 
 class ExcludedFiles;
 
@@ -102,9 +103,18 @@ class DiscoverySingleLocalDirectoryJob : public QObject, public QRunnable
 public:
     explicit DiscoverySingleLocalDirectoryJob(const AccountPtr &account, const QString &localPath, OCC::Vfs *vfs, QObject *parent = nullptr);
 
+    /** Look up the journal entries of the directory before listing it
+     *
+     * Files that are unchanged since they were synced as hydrated files
+     * then skip the vfs placeholder probe.
+     */
+    void setJournalPath(SyncJournalDb *journal, const QString &dbPath);
+
     void run() override;
 signals:
     void finished(QVector<LocalInfo> result);
+    // Emitted before finished()
+    void placeholderStatistics(int placeholderCount, int skippedProbeCount);
     void finishedFatalError(QString errorString);
     void finishedNonFatalError(QString errorString);
 
@@ -115,6 +125,8 @@ private:
     QString _localPath;
     AccountPtr _account;
     OCC::Vfs* _vfs;
+    SyncJournalDb *_journal = nullptr;
+    QString _dbPath;
 public:
 };
 
@@ -149,6 +161,10 @@ private slots:
     void metadataError(const QByteArray& fileId, int httpReturnCode);
 
 private:
+    // Replaces the encrypted names of the results and finishes the job
+    void applyE2eFileNames(const FolderMetadataCache::FileNames &fileNames);
+    FolderMetadataCache &metadataCache() const;
+
     QVector<RemoteInfo> _results;
     QString _subPath;
     QByteArray _firstEtag;
@@ -226,6 +242,37 @@ class DiscoveryPhase : public QObject
 
     int _currentlyActiveJobs = 0;
 
+    // Local placeholders found and placeholder probes saved by journal
+    // hints, for the discovery logs
+    int _localPlaceholderCount = 0;
+    int _skippedPlaceholderProbeCount = 0;
+
+    /** Server listings requested before the directory walk reached them
+     *
+     * See startRemoteChangeSearch(). Keyed by the server path, as passed to
+     * DiscoverySingleDirectoryJob. The etag is the one the listing reported
+     * for the directory itself.
+     */
+    struct PrefetchedListing
+    {
+        QByteArray etag;
+        QVector<RemoteInfo> entries;
+    };
+    QHash<QString, PrefetchedListing> _prefetchedListings;
+    std::deque<QString> _prefetchQueue;
+    // Server paths the walk listed itself, they are not prefetched anymore
+    QSet<QString> _listedServerPaths;
+
+    void startNextPrefetches();
+
+    /** Returns the prefetched entries of a server directory, if any
+     *
+     * They are only returned if the listing has the etag the walk saw for the
+     * directory in the listing of its parent. Otherwise the directory changed
+     * in between and the walk must list it again.
+     */
+    Optional<QVector<RemoteInfo>> takePrefetchedListing(const QString &serverPath, const QByteArray &etag);
+
     // both must contain a sorted list
     QStringList _selectiveSyncBlackList;
     QStringList _selectiveSyncWhiteList;
@@ -277,12 +324,23 @@ public:
 
     void startJob(ProcessDirectoryJob *);
 
+    /** Asks the server for the items modified since the given time and lists
+     * the directories containing them ahead of the directory walk
+     *
+     * The walk still decides which directories to descend into by comparing
+     * etags; this only saves the round-trip per directory level. If the server
+     * does not support SEARCH the walk continues as if it was never called.
+     */
+    void startRemoteChangeSearch(qint64 lastSyncTimestamp);
+
     void setSelectiveSyncBlackList(const QStringList &list);
     void setSelectiveSyncWhiteList(const QStringList &list);
 
     // output
     QByteArray _dataFingerprint;
     bool _anotherSyncNeeded = false;
+    // Directory listings the walk took from startRemoteChangeSearch(), for the discovery logs
+    int _usedPrefetchedListingCount = 0;
 
 signals:
     void fatalError(const QString &errorString);
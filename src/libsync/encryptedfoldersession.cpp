@@ -0,0 +1,249 @@
+/*
+ * Copyright (C) by Nextcloud GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "encryptedfoldersession.h"
+#include "account.h"
+#include "clientsideencryption.h"
+#include "clientsideencryptionjobs.h"
+
+#include <QJsonDocument>
+#include <QLoggingCategory>
+#include <QTimer>
+
+#include <utility>
+
+namespace OCC {
+
+Q_LOGGING_CATEGORY(lcEncryptedFolderSession, "nextcloud.sync.propagator.encryptedfoldersession", QtInfoMsg)
+
+namespace {
+    // Another client may hold the lock: retry that long before giving up
+    constexpr int lockRetryIntervalMs = 5 * 1000;
+    constexpr qint64 lockRetryTimeoutMs = 5 * 60 * 1000;
+}
+
+EncryptedFolderSession::EncryptedFolderSession(const AccountPtr &account, const QByteArray &folderId, QObject *parent)
+    : QObject(parent)
+    , _account(account)
+    , _folderId(folderId)
+{
+}
+
+EncryptedFolderSession::~EncryptedFolderSession()
+{
+    if (_state == State::Locked) {
+        qCWarning(lcEncryptedFolderSession) << "Folder" << _folderId << "is still locked by" << _users << "users, unlocking it";
+        // Not parented to the session, so the unlock still goes out
+        auto unlockJob = new UnlockEncryptFolderApiJob(_account, _folderId, _token);
+        unlockJob->start();
+    } else if (_state == State::Unlocking && _unlockJob) {
+        qCInfo(lcEncryptedFolderSession) << "Letting the unlock of folder" << _folderId << "finish";
+        // Destroying the job would abort the request and leave the folder locked
+        _unlockJob->setParent(nullptr);
+    }
+}
+
+template <typename Callback, typename... Args>
+void EncryptedFolderSession::notify(QVector<Waiter<Callback>> &waiters, Args... args)
+{
+    // The callbacks may register new waiters
+    const auto current = std::exchange(waiters, {});
+    for (const auto &waiter : current) {
+        if (waiter.context) {
+            waiter.callback(args...);
+        }
+    }
+}
+
+void EncryptedFolderSession::acquire(QObject *context, const std::function<void(bool)> &callback)
+{
+    ++_users;
+    if (_state == State::Locked) {
+        callback(true);
+        return;
+    }
+
+    _acquireWaiters.append({ context, callback });
+    if (_state == State::Unlocked) {
+        _lockFirstTry.start();
+        startLock();
+    }
+    // Locking: the waiter is served when the lock is there.
+    // Unlocking: the folder is locked again once the unlock finished.
+}
+
+void EncryptedFolderSession::startLock()
+{
+    _state = State::Locking;
+    qCDebug(lcEncryptedFolderSession) << "Locking folder" << _folderId;
+    auto lockJob = new LockEncryptFolderApiJob(_account, _folderId, this);
+    connect(lockJob, &LockEncryptFolderApiJob::success, this, [this](const QByteArray &, const QByteArray &token) {
+        slotLocked(token);
+    });
+    connect(lockJob, &LockEncryptFolderApiJob::error, this, [this](const QByteArray &, int httpErrorCode) {
+        slotLockError(httpErrorCode);
+    });
+    lockJob->start();
+}
+
+void EncryptedFolderSession::slotLocked(const QByteArray &token)
+{
+    qCDebug(lcEncryptedFolderSession) << "Folder" << _folderId << "locked, fetching metadata";
+    _token = token;
+
+    auto job = new GetMetadataApiJob(_account, _folderId, this);
+    connect(job, &GetMetadataApiJob::jsonReceived, this, [this](const QJsonDocument &json, int statusCode) {
+        slotMetadataReceived(json.toJson(QJsonDocument::Compact), statusCode);
+    });
+    connect(job, &GetMetadataApiJob::error, this, [this](const QByteArray &, int httpReturnCode) {
+        qCDebug(lcEncryptedFolderSession) << "Error getting the metadata of" << _folderId << httpReturnCode << "pretending it is empty";
+        slotMetadataReceived(QByteArray(), httpReturnCode);
+    });
+    job->start();
+}
+
+void EncryptedFolderSession::slotLockError(int httpErrorCode)
+{
+    if (_lockFirstTry.elapsed() < lockRetryTimeoutMs) {
+        qCInfo(lcEncryptedFolderSession) << "Could not lock folder" << _folderId << httpErrorCode << "retrying";
+        QTimer::singleShot(lockRetryIntervalMs, this, &EncryptedFolderSession::startLock);
+        return;
+    }
+
+    qCWarning(lcEncryptedFolderSession) << "Giving up locking folder" << _folderId << httpErrorCode;
+    _state = State::Unlocked;
+    _users -= _acquireWaiters.size();
+    notify(_acquireWaiters, false);
+    notify(_unlockWaiters);
+}
+
+void EncryptedFolderSession::slotMetadataReceived(const QByteArray &json, int statusCode)
+{
+    _metadata = std::make_unique<FolderMetadata>(_account, json, statusCode);
+    _metadataMissing = statusCode == 404;
+    _state = State::Locked;
+    for (const auto &waiter : qAsConst(_acquireWaiters)) {
+        // Users that went away while waiting won't release
+        if (!waiter.context) {
+            --_users;
+        }
+    }
+    notify(_acquireWaiters, true);
+    // Everybody may have left again already
+    unlockIfUnused();
+}
+
+void EncryptedFolderSession::commitMetadata(QObject *context, const std::function<void(bool)> &callback)
+{
+    Q_ASSERT(_state == State::Locked);
+    _pendingCommits.append({ context, callback });
+    if (_runningCommits.isEmpty() && _pendingCommits.size() == 1) {
+        // Users that are served in the same event loop iteration share one update
+        QTimer::singleShot(0, this, &EncryptedFolderSession::startCommit);
+    }
+}
+
+void EncryptedFolderSession::startCommit()
+{
+    if (!_runningCommits.isEmpty() || _pendingCommits.isEmpty()) {
+        return;
+    }
+    _runningCommits = std::exchange(_pendingCommits, {});
+    qCDebug(lcEncryptedFolderSession) << "Sending the metadata of" << _folderId << "for" << _runningCommits.size() << "changes";
+
+    if (_metadataMissing) {
+        auto job = new StoreMetaDataApiJob(_account, _folderId, _metadata->encryptedMetadata(), this);
+        connect(job, &StoreMetaDataApiJob::success, this, [this] { slotCommitFinished(true); });
+        connect(job, &StoreMetaDataApiJob::error, this, [this] { slotCommitFinished(false); });
+        job->start();
+    } else {
+        auto job = new UpdateMetadataApiJob(_account, _folderId, _metadata->encryptedMetadata(), _token, this);
+        connect(job, &UpdateMetadataApiJob::success, this, [this] { slotCommitFinished(true); });
+        connect(job, &UpdateMetadataApiJob::error, this, [this] { slotCommitFinished(false); });
+        job->start();
+    }
+}
+
+void EncryptedFolderSession::slotCommitFinished(bool ok)
+{
+    if (ok) {
+        _metadataMissing = false;
+    } else {
+        qCWarning(lcEncryptedFolderSession) << "Sending the metadata of" << _folderId << "failed";
+    }
+    notify(_runningCommits, ok);
+    if (!_pendingCommits.isEmpty()) {
+        startCommit();
+    } else {
+        unlockIfUnused();
+    }
+}
+
+void EncryptedFolderSession::release(QObject *context, const std::function<void(int)> &callback)
+{
+    Q_ASSERT(_users > 0);
+    --_users;
+    if (_users > 0 || _state != State::Locked) {
+        callback(200);
+        return;
+    }
+    _releaseWaiters.append({ context, callback });
+    unlockIfUnused();
+}
+
+void EncryptedFolderSession::unlockIfUnused()
+{
+    if (_users > 0 || _state != State::Locked || !_runningCommits.isEmpty() || !_pendingCommits.isEmpty()) {
+        return;
+    }
+
+    qCDebug(lcEncryptedFolderSession) << "Unlocking folder" << _folderId;
+    _state = State::Unlocking;
+    _unlockJob = new UnlockEncryptFolderApiJob(_account, _folderId, _token, this);
+    connect(_unlockJob, &UnlockEncryptFolderApiJob::success, this, [this] { slotUnlockFinished(200); });
+    connect(_unlockJob, &UnlockEncryptFolderApiJob::error, this, [this](const QByteArray &, int httpStatus) {
+        slotUnlockFinished(httpStatus);
+    });
+    _unlockJob->start();
+}
+
+void EncryptedFolderSession::slotUnlockFinished(int httpStatus)
+{
+    if (httpStatus != 200) {
+        qCWarning(lcEncryptedFolderSession) << "Unlocking folder" << _folderId << "failed" << httpStatus;
+    }
+    _state = State::Unlocked;
+    _token.clear();
+    _metadata.reset();
+    notify(_releaseWaiters, httpStatus);
+
+    if (!_acquireWaiters.isEmpty()) {
+        // Users arrived while the unlock was running
+        _lockFirstTry.start();
+        startLock();
+    } else {
+        notify(_unlockWaiters);
+    }
+}
+
+void EncryptedFolderSession::whenUnlocked(QObject *context, const std::function<void()> &callback)
+{
+    if (_state == State::Unlocked) {
+        callback();
+        return;
+    }
+    _unlockWaiters.append({ context, callback });
+}
+
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) by Nextcloud GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#ifndef ENCRYPTEDFOLDERSESSION_H
+#define ENCRYPTEDFOLDERSESSION_H
+
+#include "accountfwd.h"
+#include "owncloudlib.h"
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QPointer>
+#include <QVector>
+
+#include <functional>
+#include <memory>
+
+namespace OCC {
+
+class FolderMetadata;
+class UnlockEncryptFolderApiJob;
+
+/**
+ * @brief Shares the lock and the metadata of one end-to-end encrypted folder
+ * between the propagation jobs working in it.
+ *
+ * The first user locks the folder and fetches its metadata; users that come
+ * while the folder is locked reuse both. Metadata changes made while an update
+ * is being sent go out together in the next one, and the last user to leave
+ * unlocks the folder. This lets several uploads into the same folder run at
+ * the same time with one lock/unlock cycle instead of one per file.
+ *
+ * Sessions are owned by the OwncloudPropagator, see encryptedFolderSession().
+ *
+ * @ingroup libsync
+ */
+class OWNCLOUDSYNC_EXPORT EncryptedFolderSession : public QObject
+{
+    Q_OBJECT
+public:
+    EncryptedFolderSession(const AccountPtr &account, const QByteArray &folderId, QObject *parent = nullptr);
+    ~EncryptedFolderSession() override;
+
+    QByteArray folderId() const { return _folderId; }
+
+    /// The lock token, only valid between a successful acquire() and release()
+    QByteArray token() const { return _token; }
+
+    /// The decrypted metadata, only valid between a successful acquire() and release()
+    FolderMetadata *metadata() const { return _metadata.get(); }
+
+    bool isLocked() const { return _state != State::Unlocked; }
+
+    /**
+     * Registers a user of the folder and locks it and fetches its metadata unless
+     * that already happened. \a callback gets whether this succeeded; a user
+     * whose acquire failed must not call release().
+     */
+    void acquire(QObject *context, const std::function<void(bool ok)> &callback);
+
+    /**
+     * Sends the metadata to the server with all the changes made to it so far.
+     * \a callback gets whether the server has stored them.
+     */
+    void commitMetadata(QObject *context, const std::function<void(bool ok)> &callback);
+
+    /**
+     * Deregisters a user; the last one unlocks the folder. \a callback gets the
+     * http status of the unlock, or 200 if the folder stays locked for others.
+     */
+    void release(QObject *context, const std::function<void(int httpStatus)> &callback);
+
+    /// Calls \a callback once this session does not hold the lock of the folder
+    void whenUnlocked(QObject *context, const std::function<void()> &callback);
+
+private:
+    enum class State {
+        Unlocked,
+        Locking,
+        Locked,
+        Unlocking,
+    };
+
+    template <typename Callback>
+    struct Waiter
+    {
+        QPointer<QObject> context;
+        Callback callback;
+    };
+
+    void startLock();
+    void slotLocked(const QByteArray &token);
+    void slotLockError(int httpErrorCode);
+    void slotMetadataReceived(const QByteArray &json, int statusCode);
+    void startCommit();
+    void slotCommitFinished(bool ok);
+    void unlockIfUnused();
+    void slotUnlockFinished(int httpStatus);
+
+    template <typename Callback, typename... Args>
+    static void notify(QVector<Waiter<Callback>> &waiters, Args... args);
+
+    AccountPtr _account;
+    QByteArray _folderId;
+    QByteArray _token;
+    std::unique_ptr<FolderMetadata> _metadata;
+    // The server answered the metadata request with 404, so the first commit creates it
+    bool _metadataMissing = false;
+
+    State _state = State::Unlocked;
+    QPointer<UnlockEncryptFolderApiJob> _unlockJob;
+    int _users = 0;
+    QElapsedTimer _lockFirstTry;
+
+    QVector<Waiter<std::function<void(bool)>>> _acquireWaiters;
+    QVector<Waiter<std::function<void(bool)>>> _pendingCommits;
+    QVector<Waiter<std::function<void(bool)>>> _runningCommits;
+    QVector<Waiter<std::function<void(int)>>> _releaseWaiters;
+    QVector<Waiter<std::function<void()>>> _unlockWaiters;
+};
+
+}
+
+#endif // ENCRYPTEDFOLDERSESSION_H
@@ -21,15 +21,33 @@
 #include <QDirIterator>
 #include <QCoreApplication>
 
+#include <cstring>
+
 #include "csync.h"
 #include "vio/csync_vio_local.h"
 #include "std/c_time.h"
 
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#elif defined(Q_OS_MACOS)
+#include <sys/attr.h>
+#include <sys/clonefile.h>
+#endif
+
 namespace OCC {
 
 bool FileSystem::fileEquals(const QString &fn1, const QString &fn2)
 {
     // compare two files with given filename and return true if they have the same content
+    const qint64 size = getSize(fn1);
+    if (size != getSize(fn2)) {
+        return false;
+    }
+
     QFile f1(fn1);
     QFile f2(fn2);
     if (!f1.open(QIODevice::ReadOnly) || !f2.open(QIODevice::ReadOnly)) {
@@ -37,21 +55,23 @@ bool FileSystem::fileEquals(const QString &fn1, const QString &fn2)
         return false;
     }
 
-    if (getSize(fn1) != getSize(fn2)) {
-        return false;
-    }
-
-    const int BufferSize = 16 * 1024;
-    QByteArray buffer1(BufferSize, 0);
-    QByteArray buffer2(BufferSize, 0);
-    // the files have the same size, compare all of it
-    while(!f1.atEnd()){
-        f1.read(buffer1.data(), BufferSize);
-        f2.read(buffer2.data(), BufferSize);
-        if (buffer1 != buffer2) {
+    // Large blocks keep the number of reads low, memcmp stops at the first difference
+    const qint64 BufferSize = 1024 * 1024;
+    QByteArray buffer1(BufferSize, Qt::Uninitialized);
+    QByteArray buffer2(BufferSize, Qt::Uninitialized);
+    qint64 remaining = size;
+    while (remaining > 0) {
+        const qint64 blockSize = qMin(remaining, BufferSize);
+        if (f1.read(buffer1.data(), blockSize) != blockSize
+            || f2.read(buffer2.data(), blockSize) != blockSize) {
+            qCWarning(lcFileSystem) << "fileEquals: Failed to read " << fn1 << "or" << fn2;
             return false;
         }
-    };
+        if (std::memcmp(buffer1.constData(), buffer2.constData(), static_cast<size_t>(blockSize)) != 0) {
+            return false;
+        }
+        remaining -= blockSize;
+    }
     return true;
 }
 
@@ -107,6 +127,73 @@ bool FileSystem::verifyFileUnchanged(const QString &fileName,
     return true;
 }
 
+bool FileSystem::cloneFile(const QString &source, const QString &destination, QString *errorString)
+{
+#ifdef Q_OS_LINUX
+    const int sourceFd = ::open(QFile::encodeName(source).constData(), O_RDONLY | O_CLOEXEC);
+    if (sourceFd != -1) {
+        const int destinationFd = ::open(QFile::encodeName(destination).constData(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        bool cloned = false;
+        if (destinationFd != -1) {
+#ifdef FICLONE
+            cloned = ::ioctl(destinationFd, FICLONE, sourceFd) == 0;
+#endif
+            struct stat sourceStat;
+            if (!cloned && ::fstat(sourceFd, &sourceStat) == 0) {
+                off_t remaining = sourceStat.st_size;
+                while (remaining > 0) {
+                    const auto copied = ::copy_file_range(sourceFd, nullptr, destinationFd, nullptr, static_cast<size_t>(remaining), 0);
+                    if (copied <= 0) {
+                        break;
+                    }
+                    remaining -= copied;
+                }
+                cloned = remaining == 0;
+            }
+            ::close(destinationFd);
+        }
+        ::close(sourceFd);
+        if (cloned) {
+            return true;
+        }
+    }
+#elif defined(Q_OS_MACOS)
+    // clonefile() refuses to replace an existing destination
+    QFile::remove(destination);
+    if (::clonefile(QFile::encodeName(source).constData(), QFile::encodeName(destination).constData(), 0) == 0) {
+        return true;
+    }
+#endif
+
+    QFile sourceFile(source);
+    QFile destinationFile(destination);
+    if (!sourceFile.open(QIODevice::ReadOnly)) {
+        if (errorString) {
+            *errorString = sourceFile.errorString();
+        }
+        return false;
+    }
+    if (!destinationFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        if (errorString) {
+            *errorString = destinationFile.errorString();
+        }
+        return false;
+    }
+
+    const qint64 BufferSize = 1024 * 1024;
+    QByteArray buffer(BufferSize, Qt::Uninitialized);
+    while (!sourceFile.atEnd()) {
+        const auto read = sourceFile.read(buffer.data(), BufferSize);
+        if (read < 0 || destinationFile.write(buffer.constData(), read) != read) {
+            if (errorString) {
+                *errorString = read < 0 ? sourceFile.errorString() : destinationFile.errorString();
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
 #ifdef Q_OS_WIN
 static qint64 getSizeWithCsync(const QString &filename)
 {
@@ -42,8 +42,10 @@ namespace FileSystem {
 
     /**
      * @brief compare two files with given filename and return true if they have the same content
+     *
+     * Reads both files completely if they are equal, prefer calling it from a worker thread.
      */
-    bool fileEquals(const QString &fn1, const QString &fn2);
+    bool OWNCLOUDSYNC_EXPORT fileEquals(const QString &fn1, const QString &fn2);
 
     /**
      * @brief Get the mtime for a filepath
@@ -86,6 +88,15 @@ namespace FileSystem {
         qint64 previousSize,
         time_t previousMtime);
 
+    /**
+     * @brief Copies the content of \a source to \a destination, replacing it
+     *
+     * Shares the data blocks (FICLONE, clonefile) or copies inside the kernel
+     * (copy_file_range) where the platform and filesystem allow it, and falls
+     * back to a plain copy otherwise.
+     */
+    bool OWNCLOUDSYNC_EXPORT cloneFile(const QString &source, const QString &destination, QString *errorString = nullptr);
+
     /**
      * Removes a directory and its contents recursively
      *
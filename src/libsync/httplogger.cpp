@@ -17,6 +17,10 @@
 #include <QRegularExpression>
 #include <QLoggingCategory>
 #include <QBuffer>
+#include <QDateTime>
+#include <QElapsedTimer>
+
+#include <memory>
 
 namespace {
 Q_LOGGING_CATEGORY(lcNetworkHttp, "sync.httplogger", QtWarningMsg)
@@ -86,9 +90,84 @@ void logHttp(const QByteArray &verb, const QString &url, const QByteArray &id, c
 
 namespace OCC {
 
+NetworkEventRecorder *NetworkEventRecorder::instance()
+{
+    static NetworkEventRecorder recorder;
+    return &recorder;
+}
+
+void NetworkEventRecorder::record(const Event &event)
+{
+    QMutexLocker locker(&_mutex);
+    _events[_recorded % Capacity] = event;
+    ++_recorded;
+}
+
+std::vector<NetworkEventRecorder::Event> NetworkEventRecorder::events() const
+{
+    QMutexLocker locker(&_mutex);
+    const auto count = static_cast<int>(qMin<quint64>(_recorded, Capacity));
+    std::vector<Event> result;
+    result.reserve(count);
+    for (auto i = _recorded - count; i < _recorded; ++i) {
+        result.push_back(_events[i % Capacity]);
+    }
+    return result;
+}
+
+QByteArray NetworkEventRecorder::renderText() const
+{
+    QByteArray text;
+    const auto recorded = events();
+    for (const auto &event : recorded) {
+        text += QDateTime::fromMSecsSinceEpoch(event.startTime).toString(Qt::ISODateWithMs).toUtf8();
+        text += ' ';
+        text += event.requestId;
+        text += ' ';
+        text += event.verb;
+        text += " status=" + QByteArray::number(event.httpStatus);
+        if (event.networkError != QNetworkReply::NoError) {
+            text += " error=" + QByteArray::number(event.networkError);
+        }
+        text += " sent=" + QByteArray::number(event.requestSize);
+        text += " received=" + QByteArray::number(event.responseSize);
+        text += " duration=" + QByteArray::number(event.durationMs) + "ms\n";
+    }
+    return text;
+}
+
+void NetworkEventRecorder::clear()
+{
+    QMutexLocker locker(&_mutex);
+    _recorded = 0;
+}
+
 void HttpLogger::logRequest(QNetworkReply *reply, QNetworkAccessManager::Operation operation, QIODevice *device)
 {
     const auto request = reply->request();
+
+    NetworkEventRecorder::Event event;
+    event.startTime = QDateTime::currentMSecsSinceEpoch();
+    event.requestSize = device ? device->size() : 0;
+    const auto verb = requestVerb(operation, request);
+    qstrncpy(event.verb, verb.constData(), sizeof(event.verb));
+    const auto requestId = request.rawHeader(XRequestId());
+    qstrncpy(event.requestId, requestId.constData(), sizeof(event.requestId));
+    QElapsedTimer timer;
+    timer.start();
+    // Content-Length is missing for chunked and compressed responses, count what arrives
+    const auto received = std::make_shared<qint64>(0);
+    QObject::connect(reply, &QNetworkReply::downloadProgress, reply, [received](qint64 bytesReceived, qint64) {
+        *received = bytesReceived;
+    });
+    QObject::connect(reply, &QNetworkReply::finished, reply, [reply, event, timer, received]() mutable {
+        event.durationMs = static_cast<qint32>(timer.elapsed());
+        event.httpStatus = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        event.networkError = reply->error();
+        event.responseSize = *received;
+        NetworkEventRecorder::instance()->record(event);
+    });
+
     if (!lcNetworkHttp().isInfoEnabled()) {
         return;
     }
@@ -98,9 +177,9 @@ void HttpLogger::logRequest(QNetworkReply *reply, QNetworkAccessManager::Operati
     for (const auto &key : keys) {
         header << qMakePair(key, request.rawHeader(key));
     }
-    logHttp(requestVerb(operation, request),
+    logHttp(verb,
         request.url().toString(),
-        request.rawHeader(XRequestId()),
+        requestId,
         request.header(QNetworkRequest::ContentTypeHeader).toString(),
         header,
         device);
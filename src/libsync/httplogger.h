@@ -15,10 +15,57 @@
 
 #include "owncloudlib.h"
 
+#include <QMutex>
 #include <QNetworkReply>
 #include <QUrl>
 
+#include <array>
+#include <vector>
+
 namespace OCC {
+
+/**
+ * @brief Keeps the last network requests in a ring buffer of fixed size records
+ *
+ * Recording only copies a few numbers, so unlike the http log category it stays
+ * enabled all the time. The records are turned into text only when needed,
+ * e.g. for the debug archive.
+ */
+class OWNCLOUDSYNC_EXPORT NetworkEventRecorder
+{
+public:
+    struct Event
+    {
+        qint64 startTime = 0; // msecs since epoch
+        qint32 durationMs = 0;
+        qint32 httpStatus = 0;
+        qint32 networkError = 0;
+        qint64 requestSize = 0;
+        qint64 responseSize = 0;
+        char verb[12] = {};
+        char requestId[40] = {};
+    };
+
+    static constexpr int Capacity = 4096;
+
+    static NetworkEventRecorder *instance();
+
+    void record(const Event &event);
+
+    /// The recorded events, oldest first
+    std::vector<Event> events() const;
+
+    /// One line per recorded event
+    QByteArray renderText() const;
+
+    void clear();
+
+private:
+    mutable QMutex _mutex;
+    std::array<Event, Capacity> _events;
+    quint64 _recorded = 0;
+};
+
 namespace HttpLogger {
     void OWNCLOUDSYNC_EXPORT logRequest(QNetworkReply *reply, QNetworkAccessManager::Operation operation, QIODevice *device);
 
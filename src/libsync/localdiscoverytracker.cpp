@@ -15,13 +15,43 @@
 #include "localdiscoverytracker.h"
 
 #include "syncfileitem.h"
+#include "filesystem.h"
+#include "common/syncjournaldb.h"
 
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QHash>
 #include <QLoggingCategory>
 
+#include <algorithm>
+
 using namespace OCC;
 
 Q_LOGGING_CATEGORY(lcLocalDiscoveryTracker, "sync.localdiscoverytracker", QtInfoMsg)
 
+namespace {
+
+// Key in the journal's key_value_store, holds the time of the last clean
+// shutdown with a reliable file watcher or 0.
+const char cleanShutdownTimeC[] = "local_discovery_clean_shutdown_time";
+
+// Key in the journal's key_value_store, holds the time of the last full
+// local discovery before that shutdown.
+const char lastFullDiscoveryTimeC[] = "local_discovery_last_full_time";
+
+// If more directories than this changed while the client was not running
+// a full local discovery is used instead.
+constexpr int maxChangedDirectoriesC = 1000;
+
+// The verification runs on the GUI thread while the folder is registered:
+// on trees larger or slower to scan than this a full local discovery is used.
+constexpr int maxScannedDirectoriesC = 20000;
+constexpr qint64 maxVerificationMsecC = 2000;
+
+}
+
 LocalDiscoveryTracker::LocalDiscoveryTracker() = default;
 
 void LocalDiscoveryTracker::addTouchedPath(const QString &relativePath)
@@ -55,6 +85,136 @@ const std::set<QString> &LocalDiscoveryTracker::localDiscoveryPaths() const
     return _localDiscoveryPaths;
 }
 
+void LocalDiscoveryTracker::persistToJournal(SyncJournalDb *journal, bool watcherReliable,
+    std::chrono::milliseconds timeSinceLastFullDiscovery) const
+{
+    // The paths of an unfinished sync run must be rediscovered as well
+    std::set<QString> paths = _localDiscoveryPaths;
+    paths.insert(_previousLocalDiscoveryPaths.begin(), _previousLocalDiscoveryPaths.end());
+
+    QStringList list;
+    list.reserve(static_cast<int>(paths.size()));
+    for (const auto &path : paths)
+        list.append(path);
+    journal->setLocalDiscoveryPaths(list);
+
+    const qint64 shutdownTime = watcherReliable ? QDateTime::currentSecsSinceEpoch() : 0;
+    const qint64 lastFullDiscoveryTime = watcherReliable
+        ? shutdownTime - std::chrono::duration_cast<std::chrono::seconds>(timeSinceLastFullDiscovery).count()
+        : 0;
+    journal->keyValueStoreSet(QString::fromLatin1(cleanShutdownTimeC), shutdownTime);
+    journal->keyValueStoreSet(QString::fromLatin1(lastFullDiscoveryTimeC), lastFullDiscoveryTime);
+
+    qCInfo(lcLocalDiscoveryTracker) << "persisted" << list.size() << "local discovery paths, watcher reliable:" << watcherReliable;
+}
+
+bool LocalDiscoveryTracker::restoreFromJournal(SyncJournalDb *journal, const QString &localPath,
+    std::chrono::milliseconds *timeSinceLastFullDiscovery)
+{
+    const auto shutdownTime = journal->keyValueStoreGetInt(QString::fromLatin1(cleanShutdownTimeC), 0);
+    const auto lastFullDiscoveryTime = journal->keyValueStoreGetInt(QString::fromLatin1(lastFullDiscoveryTimeC), 0);
+    bool ok = false;
+    const auto paths = journal->getLocalDiscoveryPaths(&ok);
+
+    // The saved state is only valid for the first start after a clean shutdown
+    journal->keyValueStoreSet(QString::fromLatin1(cleanShutdownTimeC), 0);
+    journal->keyValueStoreSet(QString::fromLatin1(lastFullDiscoveryTimeC), 0);
+    journal->setLocalDiscoveryPaths({});
+
+    if (!ok) {
+        qCWarning(lcLocalDiscoveryTracker) << "could not read persisted local discovery paths";
+        return false;
+    }
+    for (const auto &path : paths)
+        _localDiscoveryPaths.insert(path);
+
+    if (shutdownTime <= 0 || lastFullDiscoveryTime <= 0) {
+        qCInfo(lcLocalDiscoveryTracker) << "no state from a clean shutdown with a reliable watcher, full local discovery needed";
+        return false;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    if (!addPathsChangedSince(journal, localPath, static_cast<time_t>(shutdownTime))) {
+        return false;
+    }
+    qCInfo(lcLocalDiscoveryTracker) << "restored local discovery state with" << _localDiscoveryPaths.size()
+                                    << "paths, verification took" << timer.elapsed() << "ms";
+    if (timeSinceLastFullDiscovery) {
+        // The clock may have been set back while the client was not running
+        const auto secondsSince = std::max<qint64>(0, QDateTime::currentSecsSinceEpoch() - lastFullDiscoveryTime);
+        *timeSinceLastFullDiscovery = std::chrono::seconds(secondsSince);
+    }
+    return true;
+}
+
+bool LocalDiscoveryTracker::addPathsChangedSince(SyncJournalDb *journal, const QString &localPath, time_t shutdownTime)
+{
+    QString basePath = localPath;
+    if (!basePath.endsWith(QLatin1Char('/')))
+        basePath.append(QLatin1Char('/'));
+    if (!QDir(basePath).exists())
+        return false;
+
+    QElapsedTimer timer;
+    timer.start();
+    int scannedDirectories = 0;
+    int changedDirectories = 0;
+    const auto checkDirectory = [&](const QString &relativeDir) {
+        if (++scannedDirectories > maxScannedDirectoriesC || timer.elapsed() > maxVerificationMsecC)
+            return false;
+        if (FileSystem::getModTime(basePath + relativeDir) < shutdownTime)
+            return true;
+        if (++changedDirectories > maxChangedDirectoriesC)
+            return false;
+
+        QHash<QString, SyncJournalFileRecord> dbEntries;
+        if (!journal->listFilesInPath(relativeDir.toUtf8(), [&dbEntries](const SyncJournalFileRecord &rec) {
+                dbEntries.insert(rec.path(), rec);
+            })) {
+            return false;
+        }
+
+        const auto prefix = relativeDir.isEmpty() ? QString() : relativeDir + QLatin1Char('/');
+        const auto entries = QDir(basePath + relativeDir).entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System);
+        for (const auto &entry : entries) {
+            const auto path = prefix + entry.fileName();
+            const auto it = dbEntries.constFind(path);
+            if (it == dbEntries.constEnd()) {
+                // new or renamed
+                _localDiscoveryPaths.insert(path);
+                continue;
+            }
+            if (entry.isDir() != it->isDirectory()
+                || (!entry.isDir() && FileSystem::fileChanged(entry.absoluteFilePath(), it->_fileSize, it->_modtime))) {
+                _localDiscoveryPaths.insert(path);
+            }
+            dbEntries.remove(path);
+        }
+
+        // What's left was removed or renamed away
+        for (auto it = dbEntries.cbegin(); it != dbEntries.cend(); ++it)
+            _localDiscoveryPaths.insert(it.key());
+        return true;
+    };
+
+    bool withinBounds = checkDirectory(QString());
+    QDirIterator it(basePath, QDir::Dirs | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System, QDirIterator::Subdirectories);
+    while (withinBounds && it.hasNext()) {
+        withinBounds = checkDirectory(it.next().mid(basePath.size()));
+    }
+
+    if (!withinBounds) {
+        qCInfo(lcLocalDiscoveryTracker) << "too many changes since the last shutdown or too large a tree to verify"
+                                        << changedDirectories << scannedDirectories << timer.elapsed()
+                                        << "full local discovery needed";
+        return false;
+    }
+    qCInfo(lcLocalDiscoveryTracker) << "verification scan found" << changedDirectories << "changed of"
+                                    << scannedDirectories << "directories";
+    return true;
+}
+
 void LocalDiscoveryTracker::slotItemCompleted(const SyncFileItemPtr &item)
 {
     // For successes, we want to wipe the file from the list to ensure we don't
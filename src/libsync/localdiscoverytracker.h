@@ -20,10 +20,13 @@
 #include <QObject>
 #include <QByteArray>
 #include <QSharedPointer>
+#include <chrono>
+#include <ctime>
 
 namespace OCC {
 
 class SyncFileItem;
+class SyncJournalDb;
 using SyncFileItemPtr = QSharedPointer<SyncFileItem>;
 
 /**
@@ -38,6 +41,10 @@ using SyncFileItemPtr = QSharedPointer<SyncFileItem>;
  * Then localDiscoveryPaths() can be used to determine paths to rediscover
  * and send to SyncEngine::setLocalDiscoveryOptions().
  *
+ * The state can be saved in the journal on shutdown (persistToJournal()) and
+ * loaded again on startup (restoreFromJournal()) to avoid a full local
+ * discovery after every restart.
+ *
  * This class is primarily used from Folder and separate primarily for
  * readability and testing purposes.
  *
@@ -68,6 +75,36 @@ public:
     /** Access list of files that shall be locally rediscovered. */
     const std::set<QString> &localDiscoveryPaths() const;
 
+    /**
+     * Saves the paths that still need local rediscovery in the journal.
+     *
+     * Should be called on clean shutdown. If watcherReliable is true, the file
+     * watcher saw every change since the last full local discovery and a
+     * marker is stored that allows restoreFromJournal() to skip the full
+     * local discovery after the restart.
+     *
+     * timeSinceLastFullDiscovery is stored as well, so the periodic full
+     * local discovery stays due at the same time across restarts.
+     */
+    void persistToJournal(SyncJournalDb *journal, bool watcherReliable,
+        std::chrono::milliseconds timeSinceLastFullDiscovery) const;
+
+    /**
+     * Loads the state saved with persistToJournal().
+     *
+     * The saved state is consumed, so a crash after this call leads to a
+     * full local discovery as before.
+     *
+     * Returns true if the state was saved with a reliable watcher and a
+     * verification scan of localPath could find all changes done while the
+     * client was not running. In that case localDiscoveryPaths() may be used
+     * for the next sync instead of a full local discovery, and
+     * timeSinceLastFullDiscovery is set to the time since the full local
+     * discovery that preceded the shutdown.
+     */
+    bool restoreFromJournal(SyncJournalDb *journal, const QString &localPath,
+        std::chrono::milliseconds *timeSinceLastFullDiscovery = nullptr);
+
 public slots:
     /**
      * Success and failure of sync items adjust what the next sync is
@@ -81,6 +118,20 @@ public slots:
     void slotSyncFinished(bool success);
 
 private:
+    /**
+     * Adds paths of entries that changed since shutdownTime.
+     *
+     * Only directories whose mtime is not older than shutdownTime are listed
+     * and compared against the journal: created, deleted or renamed entries
+     * always touch the parent directory's mtime. Content changes of
+     * existing files in place are left to the periodic full discovery.
+     *
+     * Returns false if too many directories changed for the scan to be
+     * worthwhile, or if the tree is too large to be scanned quickly: this
+     * runs on the GUI thread.
+     */
+    bool addPathsChangedSince(SyncJournalDb *journal, const QString &localPath, time_t shutdownTime);
+
     /**
      * The paths that should be checked by the next local discovery.
      *
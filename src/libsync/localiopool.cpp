@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) by Nextcloud GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "localiopool.h"
+
+#include <QLoggingCategory>
+
+namespace OCC {
+
+Q_LOGGING_CATEGORY(lcLocalIoPool, "nextcloud.sync.propagator.localio", QtInfoMsg)
+
+namespace {
+    // Local file systems gain little from more concurrent mutations, slow ones
+    // only need enough threads to keep the event loop free
+    constexpr int maxThreadCount = 4;
+}
+
+LocalIoPool::LocalIoPool(QObject *parent)
+    : QObject(parent)
+    , _threadPool(new QThreadPool)
+{
+    _threadPool->setMaxThreadCount(maxThreadCount);
+}
+
+LocalIoPool::~LocalIoPool()
+{
+    _cancelled->store(true);
+    _threadPool->clear();
+    if (_threadPool->activeThreadCount() == 0) {
+        delete _threadPool;
+        return;
+    }
+
+    // A long recursive removal can't be interrupted, and waiting for it here
+    // would block the thread the propagator is torn down in
+    qCInfo(lcLocalIoPool) << "Leaving" << _threadPool->activeThreadCount() << "running operations behind";
+    auto threadPool = _threadPool;
+    QThreadPool::globalInstance()->start([threadPool] {
+        threadPool->waitForDone();
+        threadPool->deleteLater();
+    });
+}
+
+QString LocalIoPool::orderKeyForPath(const QString &path)
+{
+    const auto slashPosition = path.lastIndexOf(QLatin1Char('/'));
+    return slashPosition >= 0 ? path.left(slashPosition) : QString();
+}
+
+void LocalIoPool::enqueue(const QString &orderKey, Task task)
+{
+    const auto waiting = _waiting.find(orderKey);
+    if (waiting != _waiting.end()) {
+        qCDebug(lcLocalIoPool) << "Queueing an operation behind the running one in" << orderKey;
+        waiting->push_back(std::move(task));
+        return;
+    }
+    _waiting.insert(orderKey, {});
+    start(orderKey, std::move(task));
+}
+
+void LocalIoPool::start(const QString &orderKey, Task task)
+{
+    _threadPool->start([this, cancelled = _cancelled, threadPool = _threadPool, orderKey, task = std::move(task)] {
+        if (cancelled->load()) {
+            return;
+        }
+        task.operation();
+        // This pool may be gone by now, but the thread pool outlives its operations
+        // and lives in the same thread. The flag is checked there, so it can't change
+        // between the check and the call.
+        QMetaObject::invokeMethod(threadPool, [this, cancelled, orderKey, task] {
+            if (!cancelled->load()) {
+                finished(orderKey, task);
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void LocalIoPool::finished(const QString &orderKey, const Task &task)
+{
+    // Start the next operation first, the completion may post new ones
+    auto &waiting = _waiting[orderKey];
+    if (waiting.empty()) {
+        _waiting.remove(orderKey);
+    } else {
+        auto next = std::move(waiting.front());
+        waiting.pop_front();
+        start(orderKey, std::move(next));
+    }
+
+    if (task.context) {
+        task.done();
+    }
+}
+
+}
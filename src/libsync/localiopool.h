@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) by Nextcloud GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#ifndef LOCALIOPOOL_H
+#define LOCALIOPOOL_H
+
+#include "owncloudlib.h"
+
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QThreadPool>
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <type_traits>
+
+namespace OCC {
+
+/**
+ * @brief Runs the local file system operations of the propagator jobs on worker threads
+ *
+ * Deleting a large tree or renaming on a network mounted or encrypted home
+ * directory can take a long time and must not block the event loop.
+ *
+ * Operations with the same order key, usually the directory they change,
+ * run one after the other in the order they were posted. The operation
+ * itself must not touch the propagator, the journal or the item: it gets
+ * what it needs by value and hands its result to the completion, which runs
+ * on the thread the pool lives in.
+ *
+ * @ingroup libsync
+ */
+class OWNCLOUDSYNC_EXPORT LocalIoPool : public QObject
+{
+    Q_OBJECT
+public:
+    explicit LocalIoPool(QObject *parent = nullptr);
+
+    /** Drops the operations that did not start yet and the completions of
+     * the running ones, without waiting for those to finish.
+     */
+    ~LocalIoPool() override;
+
+    /** Runs \a operation on a worker thread and then \a done with its result,
+     * unless \a context was destroyed meanwhile.
+     */
+    template <typename Operation, typename Done>
+    void run(const QString &orderKey, QObject *context, Operation operation, Done done)
+    {
+        using Result = std::invoke_result_t<Operation>;
+        auto result = std::make_shared<Result>();
+        enqueue(orderKey, { [operation, result] { *result = operation(); }, context, [done, result] { done(*result); } });
+    }
+
+    /// The order key for an operation changing \a path: its parent directory
+    static QString orderKeyForPath(const QString &path);
+
+private:
+    struct Task
+    {
+        std::function<void()> operation;
+        QPointer<QObject> context;
+        std::function<void()> done;
+    };
+
+    void enqueue(const QString &orderKey, Task task);
+    void start(const QString &orderKey, Task task);
+    void finished(const QString &orderKey, const Task &task);
+
+    // Not owned by this object: it lives on until the running operations are through
+    QThreadPool *_threadPool;
+    // Shared with the running operations, set once this pool is destroyed
+    std::shared_ptr<std::atomic<bool>> _cancelled = std::make_shared<std::atomic<bool>>(false);
+
+    // There is an entry for each order key with a running operation,
+    // holding the operations waiting for it
+    QHash<QString, std::deque<Task>> _waiting;
+};
+
+}
+
+#endif // LOCALIOPOOL_H
@@ -62,6 +62,9 @@ Logger::~Logger()
 #ifndef NO_MSG_HANDLER
     qInstallMessageHandler(nullptr);
 #endif
+    stopWriter();
+    QMutexLocker lock(&_mutex);
+    writePendingLines();
 }
 
 
@@ -118,9 +121,12 @@ void Logger::doLog(QtMsgType type, const QMessageLogContext &ctx, const QString
         _crashLogIndex = (_crashLogIndex + 1) % CrashLogSize;
         _crashLog[_crashLogIndex] = msg;
         if (_logstream) {
-            (*_logstream) << msg << Qt::endl;
-            if (_doFileFlush)
-                _logstream->flush();
+            _pendingLines.append(msg);
+            if (_doFileFlush || !_writerThread.joinable()) {
+                writePendingLines();
+            } else {
+                _pendingLinesAdded.wakeOne();
+            }
         }
         if (type == QtFatalMsg) {
             close();
@@ -136,6 +142,8 @@ void Logger::doLog(QtMsgType type, const QMessageLogContext &ctx, const QString
 void Logger::close()
 {
     dumpCrashLog();
+    writePendingLines();
+    QMutexLocker writeLock(&_writeMutex);
     if (_logstream)
     {
         _logstream->flush();
@@ -144,6 +152,65 @@ void Logger::close()
     }
 }
 
+void Logger::writePendingLines()
+{
+    if (_pendingLines.isEmpty())
+        return;
+
+    const auto lines = std::move(_pendingLines);
+    _pendingLines.clear();
+
+    QMutexLocker writeLock(&_writeMutex);
+    if (!_logstream)
+        return;
+    for (const auto &line : lines) {
+        (*_logstream) << line << QLatin1Char('\n');
+    }
+    _logstream->flush();
+}
+
+void Logger::writerLoop()
+{
+    QMutexLocker lock(&_mutex);
+    forever {
+        while (_pendingLines.isEmpty() && !_stopWriter) {
+            _pendingLinesAdded.wait(&_mutex);
+        }
+        if (_pendingLines.isEmpty())
+            return;
+
+        // Take the batch and the write lock before letting other threads
+        // log again, that keeps the lines in order
+        const auto lines = std::move(_pendingLines);
+        _pendingLines.clear();
+        QMutexLocker writeLock(&_writeMutex);
+        lock.unlock();
+
+        if (_logstream) {
+            for (const auto &line : lines) {
+                (*_logstream) << line << QLatin1Char('\n');
+            }
+            _logstream->flush();
+        }
+
+        writeLock.unlock();
+        lock.relock();
+    }
+}
+
+void Logger::stopWriter()
+{
+    if (!_writerThread.joinable())
+        return;
+    {
+        QMutexLocker lock(&_mutex);
+        _stopWriter = true;
+        _pendingLinesAdded.wakeAll();
+    }
+    _writerThread.join();
+    _stopWriter = false;
+}
+
 QString Logger::logFile() const
 {
     return _logFile.fileName();
@@ -152,6 +219,8 @@ QString Logger::logFile() const
 void Logger::setLogFile(const QString &name)
 {
     QMutexLocker locker(&_mutex);
+    writePendingLines();
+    QMutexLocker writeLocker(&_writeMutex);
     if (_logstream) {
         _logstream.reset(nullptr);
         _logFile.close();
@@ -170,6 +239,7 @@ void Logger::setLogFile(const QString &name)
     }
 
     if (!openSucceeded) {
+        writeLocker.unlock();
         locker.unlock(); // Just in case postGuiMessage has a qDebug()
         postGuiMessage(tr("Error"),
             QString(tr("<nobr>File \"%1\"<br/>cannot be opened for writing.<br/><br/>"
@@ -180,6 +250,10 @@ void Logger::setLogFile(const QString &name)
 
     _logstream.reset(new QTextStream(&_logFile));
     _logstream->setCodec(QTextCodec::codecForName("UTF-8"));
+
+    if (!_writerThread.joinable()) {
+        _writerThread = std::thread([this] { writerLoop(); });
+    }
 }
 
 void Logger::setLogExpire(int expire)
@@ -20,8 +20,11 @@
 #include <QDateTime>
 #include <QFile>
 #include <QTextStream>
+#include <QWaitCondition>
 #include <qmutex.h>
 
+#include <thread>
+
 #include "common/utility.h"
 #include "owncloudlib.h"
 
@@ -29,6 +32,11 @@ namespace OCC {
 
 /**
  * @brief The Logger class
+ *
+ * Messages meant for the log file are queued and written in batches by a
+ * background thread, so logging threads don't wait for the disk. With
+ * setLogFlush(true) every message is written and flushed right away.
+ *
  * @ingroup libsync
  */
 class OWNCLOUDSYNC_EXPORT Logger : public QObject
@@ -99,12 +107,25 @@ private:
     void close();
     void dumpCrashLog();
 
+    // Runs on _writerThread until _stopWriter is set
+    void writerLoop();
+    // Writes out _pendingLines, the caller must hold _mutex
+    void writePendingLines();
+    void stopWriter();
+
+    // _logFile and _logstream are written to with _writeMutex held and
+    // only replaced while holding both _mutex and _writeMutex
     QFile _logFile;
     bool _doFileFlush = false;
     int _logExpire = 0;
     bool _logDebug = false;
     QScopedPointer<QTextStream> _logstream;
     mutable QMutex _mutex;
+    QMutex _writeMutex;
+    QStringList _pendingLines;
+    QWaitCondition _pendingLinesAdded;
+    std::thread _writerThread;
+    bool _stopWriter = false;
     QString _logDirectory;
     bool _temporaryFolderLogDir = false;
     QSet<QString> _logRules;
@@ -428,6 +428,80 @@ bool LsColJob::finished()
 
 /*********************************************************************************************/
 
+SearchModifiedItemsJob::SearchModifiedItemsJob(AccountPtr account, const QString &path, qint64 modifiedAfter, QObject *parent)
+    : AbstractNetworkJob(account, path, parent)
+    , _modifiedAfter(modifiedAfter)
+{
+}
+
+void SearchModifiedItemsJob::start()
+{
+    // The scope is relative to the dav root, like "/files/user/folder"
+    auto scope = QStringLiteral("/files/") + account()->davUser() + QLatin1Char('/') + path();
+    scope.replace(QStringLiteral("//"), QStringLiteral("/"));
+    if (scope.endsWith(QLatin1Char('/'))) {
+        scope.chop(1);
+    }
+    const QByteArray limit = _maxResults > 0
+        ? "    <d:limit><d:nresults>" + QByteArray::number(_maxResults) + "</d:nresults></d:limit>\n"
+        : QByteArray();
+    const QByteArray xml("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                         "<d:searchrequest xmlns:d=\"DAV:\">\n"
+                         "  <d:basicsearch>\n"
+                         "    <d:select><d:prop><d:resourcetype/><d:getlastmodified/></d:prop></d:select>\n"
+                         "    <d:from><d:scope><d:href>" + scope.toHtmlEscaped().toUtf8() + "</d:href><d:depth>infinity</d:depth></d:scope></d:from>\n"
+                         "    <d:where><d:gt><d:prop><d:getlastmodified/></d:prop><d:literal>" + QByteArray::number(_modifiedAfter) + "</d:literal></d:gt></d:where>\n"
+                         "    <d:orderby/>\n"
+        + limit
+        + "  </d:basicsearch>\n"
+          "</d:searchrequest>\n");
+
+    QNetworkRequest req;
+    req.setHeader(QNetworkRequest::ContentTypeHeader, QByteArrayLiteral("text/xml"));
+    auto *buf = new QBuffer(this);
+    buf->setData(xml);
+    buf->open(QIODevice::ReadOnly);
+    sendRequest("SEARCH", Utility::concatUrlPath(account()->url(), QStringLiteral("/remote.php/dav/")), req, buf);
+    AbstractNetworkJob::start();
+}
+
+bool SearchModifiedItemsJob::finished()
+{
+    qCInfo(lcLsColJob) << "SEARCH of" << path() << "FINISHED WITH STATUS" << replyStatusString();
+
+    const auto contentType = reply()->header(QNetworkRequest::ContentTypeHeader).toString();
+    const auto httpCode = reply()->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (httpCode != 207 || !contentType.contains("xml")) {
+        emit finishedWithError(reply());
+        return true;
+    }
+
+    const auto davPrefix = Utility::concatUrlPath(account()->url(), account()->davPath()).path();
+    QStringList directories;
+    QStringList files;
+    LsColXMLParser parser;
+    connect(&parser, &LsColXMLParser::directoryListingIterated, this, [&](const QString &href, const QMap<QString, QString> &properties) {
+        if (!href.startsWith(davPrefix)) {
+            return;
+        }
+        const auto relativePath = href.mid(davPrefix.size());
+        if (properties.value(QStringLiteral("resourcetype")).contains(QStringLiteral("collection"))) {
+            directories.append(relativePath);
+        } else {
+            files.append(relativePath);
+        }
+    });
+    QHash<QString, ExtraFolderInfo> folderInfos;
+    if (!parser.parse(reply()->readAll(), &folderInfos, reply()->request().url().path())) {
+        emit finishedWithError(reply());
+        return true;
+    }
+    emit finishedWithoutError(directories, files);
+    return true;
+}
+
+/*********************************************************************************************/
+
 namespace {
     const char statusphpC[] = "status.php";
     const char nextcloudDirC[] = "nextcloud/";
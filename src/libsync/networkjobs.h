@@ -166,6 +166,39 @@ private:
     QUrl _url; // Used instead of path() if the url is specified in the constructor
 };
 
+/**
+ * @brief Finds the items below a folder modified after a given time
+ *
+ * Sends a WebDAV SEARCH (DASL basicsearch) on getlastmodified. Servers
+ * without search support answer with an error and finishedWithError()
+ * is emitted.
+ *
+ * @ingroup libsync
+ */
+class OWNCLOUDSYNC_EXPORT SearchModifiedItemsJob : public AbstractNetworkJob
+{
+    Q_OBJECT
+public:
+    // path is relative to the user's dav root, like for LsColJob
+    explicit SearchModifiedItemsJob(AccountPtr account, const QString &path, qint64 modifiedAfter, QObject *parent = nullptr);
+    void start() override;
+
+    /** The server returns at most this many items, 0 for no limit */
+    void setMaxResults(int maxResults) { _maxResults = maxResults; }
+
+signals:
+    /** The paths are relative to the user's dav root, without trailing slash */
+    void finishedWithoutError(const QStringList &directories, const QStringList &files);
+    void finishedWithError(QNetworkReply *reply);
+
+private slots:
+    bool finished() override;
+
+private:
+    qint64 _modifiedAfter;
+    int _maxResults = 0;
+};
+
 /**
  * @brief The PropfindJob class
  *
@@ -22,6 +22,7 @@
 #include "propagateremotemove.h"
 #include "propagateremotemkdir.h"
 #include "bulkpropagatorjob.h"
+#include "encryptedfoldersession.h"
 #include "propagatorjobs.h"
 #include "filesystem.h"
 #include "common/utility.h"
@@ -282,6 +283,13 @@ void PropagateItemJob::done(SyncFileItem::Status statusArg, const QString &error
         qCWarning(lcPropagator) << "Could not complete propagation of" << _item->destination() << "by" << this << "with status" << _item->_status << "and error:" << _item->_errorString;
     else
         qCInfo(lcPropagator) << "Completed propagation of" << _item->destination() << "by" << this << "with status" << _item->_status;
+    if (_traceStart >= 0) {
+        Tracer::instance()->asyncSpan("propagator", QString::fromLatin1(metaObject()->className()), reinterpret_cast<quintptr>(this), _traceStart,
+            { { QStringLiteral("file"), _item->destination() },
+                { QStringLiteral("size"), _item->_size },
+                { QStringLiteral("status"), static_cast<int>(_item->_status) } });
+    }
+    ++propagator()->_completedItemJobCount;
     emit propagator()->itemCompleted(_item);
     emit finished(_item->_status);
 
@@ -516,8 +524,13 @@ void OwncloudPropagator::start(SyncFileItemVector &&items)
 
     QStringList files;
 
+    _renamedPaths.clear();
     for (const auto &item : items) {
         files.push_back(item->_file);
+        if (item->_instruction == CSYNC_INSTRUCTION_RENAME) {
+            _renamedPaths.insert(item->_originalFile);
+            _renamedPaths.insert(item->_renameTarget);
+        }
     }
 
     // process each item that is new and is a directory and make sure every parent in its tree has the instruction NEW instead of REMOVE
@@ -662,7 +675,11 @@ void OwncloudPropagator::startFilePropagation(const SyncFileItemPtr &item,
         }
         removedDirectory = item->_file + "/";
     } else {
-        directories.top().second->appendTask(item);
+        const auto priority = itemPriority(*item);
+        if (priority == PropagatorJob::InteractivePriority) {
+            promoteDirectories(directories);
+        }
+        directories.top().second->appendTask(item, priority);
     }
 
     if (item->_instruction == CSYNC_INSTRUCTION_CONFLICT) {
@@ -672,6 +689,65 @@ void OwncloudPropagator::startFilePropagation(const SyncFileItemPtr &item,
     }
 }
 
+void OwncloudPropagator::promoteDirectories(const QStack<QPair<QString, PropagateDirectory *>> &directories)
+{
+    // Directories involved in a rename, and everything below them, keep their position
+    const auto &innermost = directories.top().second->_item;
+    if (directories.size() > 1 && (isBelowRenamedPath(innermost->_file) || isBelowRenamedPath(innermost->destination()))) {
+        return;
+    }
+
+    for (int i = directories.size() - 1; i > 0; --i) {
+        const auto directory = directories.at(i).second;
+        if (directory->_hasInteractiveItems) {
+            // Its parents were promoted along with it
+            break;
+        }
+        directory->_hasInteractiveItems = true;
+        directories.at(i - 1).second->_subJobs.promoteJob(directory);
+    }
+}
+
+bool OwncloudPropagator::isBelowRenamedPath(QString path) const
+{
+    while (!path.isEmpty()) {
+        if (_renamedPaths.contains(path)) {
+            return true;
+        }
+        path.truncate(qMax(0, path.lastIndexOf(QLatin1Char('/'))));
+    }
+    return false;
+}
+
+void OwncloudPropagator::setPriorityPaths(std::set<QString> paths)
+{
+    _priorityPaths = std::move(paths);
+}
+
+PropagatorJob::Priority OwncloudPropagator::itemPriority(const SyncFileItem &item) const
+{
+    if (item.isDirectory() || _renamedPaths.contains(item.destination())
+        || (item._instruction != CSYNC_INSTRUCTION_NEW && item._instruction != CSYNC_INSTRUCTION_SYNC)) {
+        return PropagatorJob::NormalPriority;
+    }
+
+    if (!_priorityPaths.empty()) {
+        auto path = item.destination();
+        while (!path.isEmpty()) {
+            if (_priorityPaths.find(path) != _priorityPaths.end()) {
+                return PropagatorJob::InteractivePriority;
+            }
+            path.truncate(qMax(0, path.lastIndexOf(QLatin1Char('/'))));
+        }
+    }
+
+    // Anything that needs more than one chunk is a bulk transfer
+    if (item._size > _syncOptions._initialChunkSize) {
+        return PropagatorJob::BulkPriority;
+    }
+    return PropagatorJob::NormalPriority;
+}
+
 const SyncOptions &OwncloudPropagator::syncOptions() const
 {
     return _syncOptions;
@@ -780,18 +856,34 @@ void OwncloudPropagator::scheduleNextJob()
 }
 
 void OwncloudPropagator::scheduleNextJobImpl()
+{
+    _jobScheduled = false;
+
+    // Jobs that complete synchronously, like local renames or ignored items, never
+    // occupy a slot. Keep scheduling in this pass instead of paying a timer round
+    // trip per job, which dominates for directories with many such items.
+    constexpr int maximumSynchronousJobsPerPass = 100;
+    for (int i = 0; i < maximumSynchronousJobsPerPass && !_abortRequested; ++i) {
+        const auto completedBefore = _completedItemJobCount;
+        if (!scheduleOneJob()) {
+            return;
+        }
+        if (_completedItemJobCount == completedBefore) {
+            break;
+        }
+    }
+    scheduleNextJob();
+}
+
+bool OwncloudPropagator::scheduleOneJob()
 {
     // TODO: If we see that the automatic up-scaling has a bad impact we
     // need to check how to avoid this.
     // Down-scaling on slow networks? https://github.com/owncloud/client/issues/3382
     // Making sure we do up/down at same time? https://github.com/owncloud/client/issues/1633
 
-    _jobScheduled = false;
-
     if (_activeJobList.count() < maximumActiveTransferJob()) {
-        if (_rootJob->scheduleSelfOrChild()) {
-            scheduleNextJob();
-        }
+        return _rootJob->scheduleSelfOrChild();
     } else if (_activeJobList.count() < hardMaximumActiveJob()) {
         int likelyFinishedQuicklyCount = 0;
         // NOTE: Only counts the first 3 jobs! Then for each
@@ -805,11 +897,28 @@ void OwncloudPropagator::scheduleNextJobImpl()
         }
         if (_activeJobList.count() < maximumActiveTransferJob() + likelyFinishedQuicklyCount) {
             qCDebug(lcPropagator) << "Can pump in another request! activeJobs =" << _activeJobList.count();
-            if (_rootJob->scheduleSelfOrChild()) {
-                scheduleNextJob();
-            }
+            return _rootJob->scheduleSelfOrChild();
         }
     }
+    return scheduleInteractiveJob();
+}
+
+bool OwncloudPropagator::scheduleInteractiveJob()
+{
+    // A few slots are reserved for items the user is waiting for, so they
+    // start quickly even while every regular slot is busy with large transfers.
+    constexpr int reservedInteractiveJobs = 2;
+    if (_priorityPaths.empty() || _activeJobList.count() >= hardMaximumActiveJob() + reservedInteractiveJobs) {
+        return false;
+    }
+
+    _schedulingInteractiveOnly = true;
+    const auto started = _rootJob->scheduleSelfOrChild();
+    _schedulingInteractiveOnly = false;
+    if (started) {
+        qCInfo(lcPropagator) << "Started an interactive job in a reserved slot, activeJobs =" << _activeJobList.count();
+    }
+    return started;
 }
 
 void OwncloudPropagator::reportProgress(const SyncFileItem &item, qint64 bytes)
@@ -918,6 +1027,53 @@ QString OwncloudPropagator::adjustRenamedPath(const QString &original) const
     return OCC::adjustRenamedPath(_renamedDirectories, original);
 }
 
+bool OwncloudPropagator::moveRecordsBelowRenamedDirectory(const SyncFileItem &item, const QString &recordPath)
+{
+    // The mangled names of encrypted files depend on their path, they are updated per file
+    if (!item.isDirectory() || item._isEncrypted) {
+        return true;
+    }
+    return _journal->moveFileRecordsBelowPath(recordPath.toUtf8(), item._renameTarget.toUtf8());
+}
+
+bool OwncloudPropagator::getRenamedItemRecord(const SyncFileItem &item, SyncJournalFileRecord *record, QString *recordPath)
+{
+    *recordPath = item._originalFile;
+    if (!_journal->getFileRecord(item._originalFile, record)) {
+        return false;
+    }
+    if (record->isValid()) {
+        return true;
+    }
+    const auto movedPath = adjustRenamedPath(item._originalFile);
+    if (movedPath == item._originalFile) {
+        return true;
+    }
+    if (!_journal->getFileRecord(movedPath, record)) {
+        return false;
+    }
+    if (record->isValid()) {
+        *recordPath = movedPath;
+    }
+    return true;
+}
+
+bool OwncloudPropagator::isRecordMovedWithParent(const SyncFileItem &item, const SyncJournalFileRecord &record, const QString &recordPath)
+{
+    // Placeholders still need to be updated by updateMetadata()
+    if (syncOptions()._vfs->mode() != Vfs::Off) {
+        return false;
+    }
+    return record.isValid()
+        && recordPath != item._originalFile
+        && recordPath == item._renameTarget
+        && record._type == item._type
+        && record._etag == item._etag
+        && record._fileId == item._fileId
+        && record._modtime == item._modtime
+        && record._fileSize == item._size;
+}
+
 Result<Vfs::ConvertToPlaceholderResult, QString> OwncloudPropagator::updateMetadata(const SyncFileItem &item)
 {
     return OwncloudPropagator::staticUpdateMetadata(item, _localDir, syncOptions()._vfs.data(), _journal);
@@ -943,7 +1099,8 @@ Result<Vfs::ConvertToPlaceholderResult, QString> OwncloudPropagator::staticUpdat
 
 bool OwncloudPropagator::isDelayedUploadItem(const SyncFileItemPtr &item) const
 {
-    return account()->capabilities().bulkUpload() && !_scheduleDelayedTasks && !item->_isEncrypted && _syncOptions._minChunkSize > item->_size && !isInBulkUploadBlackList(item->_file);
+    return account()->capabilities().bulkUpload() && _syncOptions._bulkUploadBatchSize > 0 && !_scheduleDelayedTasks && !item->_isEncrypted && _syncOptions._minChunkSize > item->_size && !isInBulkUploadBlackList(item->_file)
+        && itemPriority(*item) != PropagatorJob::InteractivePriority;
 }
 
 void OwncloudPropagator::setScheduleDelayedTasks(bool active)
@@ -973,6 +1130,24 @@ bool OwncloudPropagator::isInBulkUploadBlackList(const QString &file) const
     return _bulkUploadBlackList.contains(file);
 }
 
+EncryptedFolderSession *OwncloudPropagator::encryptedFolderSession(const QByteArray &folderId)
+{
+    auto &session = _encryptedFolderSessions[folderId];
+    if (!session) {
+        session = new EncryptedFolderSession(_account, folderId, this);
+    }
+    return session;
+}
+
+void OwncloudPropagator::whenEncryptedFolderUnlocked(const QByteArray &folderId, QObject *context, const std::function<void()> &callback)
+{
+    if (const auto session = _encryptedFolderSessions.value(folderId)) {
+        session->whenUnlocked(context, callback);
+    } else {
+        callback();
+    }
+}
+
 // ================================================================================
 
 PropagatorJob::PropagatorJob(OwncloudPropagator *propagator)
@@ -990,13 +1165,29 @@ OwncloudPropagator *PropagatorJob::propagator() const
 
 PropagatorJob::JobParallelism PropagatorCompositeJob::parallelism()
 {
+    if (_cachedParallelismValid) {
+        return _cachedParallelism;
+    }
+
     // If any of the running sub jobs is not parallel, we have to wait
+    _cachedParallelism = FullParallelism;
     for (int i = 0; i < _runningJobs.count(); ++i) {
         if (_runningJobs.at(i)->parallelism() != FullParallelism) {
-            return _runningJobs.at(i)->parallelism();
+            _cachedParallelism = _runningJobs.at(i)->parallelism();
+            break;
         }
     }
-    return FullParallelism;
+    _cachedParallelismValid = true;
+    return _cachedParallelism;
+}
+
+void PropagatorCompositeJob::invalidateParallelism()
+{
+    // Not stopping at a composite that is already invalid: a parent may have
+    // returned early without asking it and still hold a valid value.
+    for (auto composite = this; composite; composite = composite->_owner ? composite->_owner->associatedComposite() : nullptr) {
+        composite->_cachedParallelismValid = false;
+    }
 }
 
 void PropagatorCompositeJob::slotSubJobAbortFinished()
@@ -1013,7 +1204,75 @@ void PropagatorCompositeJob::slotSubJobAbortFinished()
 void PropagatorCompositeJob::appendJob(PropagatorJob *job)
 {
     job->setAssociatedComposite(this);
-    _jobsToDo.append(job);
+    _jobsToDo.push_back(job);
+}
+
+void PropagatorCompositeJob::appendTask(const SyncFileItemPtr &item, Priority priority)
+{
+    switch (priority) {
+    case InteractivePriority:
+        _interactiveTasksToDo.push_back(item);
+        break;
+    case NormalPriority:
+        _tasksToDo.push_back(item);
+        break;
+    case BulkPriority:
+        _bulkTasksToDo.push_back(item);
+        break;
+    }
+}
+
+bool PropagatorCompositeJob::promoteJob(PropagatorJob *job)
+{
+    // The job is usually the last one that was appended
+    const auto it = std::find(_jobsToDo.rbegin(), _jobsToDo.rend(), job);
+    if (it == _jobsToDo.rend()) {
+        return false;
+    }
+    _jobsToDo.erase(std::next(it).base());
+    _interactiveJobsToDo.push_back(job);
+    return true;
+}
+
+PropagatorJob *PropagatorCompositeJob::takeNextJob()
+{
+    if (!_interactiveJobsToDo.empty()) {
+        auto job = _interactiveJobsToDo.front();
+        _interactiveJobsToDo.pop_front();
+        return job;
+    }
+
+    const auto createJobForTask = [this](std::deque<SyncFileItemPtr> &tasks) -> PropagatorJob * {
+        while (!tasks.empty()) {
+            SyncFileItemPtr nextTask = std::move(tasks.front());
+            tasks.pop_front();
+            PropagatorJob *job = propagator()->createJob(nextTask);
+            if (!job) {
+                qCWarning(lcDirectory) << "Useless task found for file" << nextTask->destination() << "instruction" << nextTask->_instruction;
+                continue;
+            }
+            job->setAssociatedComposite(this);
+            return job;
+        }
+        return nullptr;
+    };
+
+    if (auto job = createJobForTask(_interactiveTasksToDo)) {
+        return job;
+    }
+    if (propagator()->isSchedulingInteractiveOnly()) {
+        return nullptr;
+    }
+
+    if (!_jobsToDo.empty()) {
+        auto job = _jobsToDo.front();
+        _jobsToDo.pop_front();
+        return job;
+    }
+    if (auto job = createJobForTask(_tasksToDo)) {
+        return job;
+    }
+    return createJobForTask(_bulkTasksToDo);
 }
 
 bool PropagatorCompositeJob::scheduleSelfOrChild()
@@ -1044,29 +1303,15 @@ bool PropagatorCompositeJob::scheduleSelfOrChild()
     }
 
     // Now it's our turn, check if we have something left to do.
-    // First, convert a task to a job if necessary
-    while (_jobsToDo.isEmpty() && !_tasksToDo.isEmpty()) {
-        SyncFileItemPtr nextTask = _tasksToDo.first();
-        _tasksToDo.remove(0);
-        PropagatorJob *job = propagator()->createJob(nextTask);
-        if (!job) {
-            qCWarning(lcDirectory) << "Useless task found for file" << nextTask->destination() << "instruction" << nextTask->_instruction;
-            continue;
-        }
-        appendJob(job);
-        break;
-    }
-    // Then run the next job
-    if (!_jobsToDo.isEmpty()) {
-        PropagatorJob *nextJob = _jobsToDo.first();
-        _jobsToDo.remove(0);
+    if (auto nextJob = takeNextJob()) {
         _runningJobs.append(nextJob);
+        invalidateParallelism();
         return possiblyRunNextJob(nextJob);
     }
 
     // If neither us or our children had stuff left to do we could hang. Make sure
     // we mark this job as finished so that the propagator can schedule a new one.
-    if (_jobsToDo.isEmpty() && _tasksToDo.isEmpty() && _runningJobs.isEmpty()) {
+    if (!hasWorkToDo() && _runningJobs.isEmpty()) {
         // Our parent jobs are already iterating over their running jobs, post to the event loop
         // to avoid removing ourself from that list while they iterate.
         QMetaObject::invokeMethod(this, "finalize", Qt::QueuedConnection);
@@ -1084,6 +1329,7 @@ void PropagatorCompositeJob::slotSubJobFinished(SyncFileItem::Status status)
     int i = _runningJobs.indexOf(subJob);
     ENFORCE(i >= 0); // should only happen if this function is called more than once
     _runningJobs.remove(i);
+    invalidateParallelism();
 
     // Any sub job error will cause the whole composite to fail. This is important
     // for knowing whether to update the etag in PropagateDirectory, for example.
@@ -1095,7 +1341,7 @@ void PropagatorCompositeJob::slotSubJobFinished(SyncFileItem::Status status)
         _hasError = status;
     }
 
-    if (_jobsToDo.isEmpty() && _tasksToDo.isEmpty() && _runningJobs.isEmpty()) {
+    if (!hasWorkToDo() && _runningJobs.isEmpty()) {
         finalize();
     } else {
         propagator()->scheduleNextJob();
@@ -1128,7 +1374,7 @@ PropagateDirectory::PropagateDirectory(OwncloudPropagator *propagator, const Syn
     : PropagatorJob(propagator)
     , _item(item)
     , _firstJob(propagator->createJob(item))
-    , _subJobs(propagator)
+    , _subJobs(propagator, this)
 {
     if (_firstJob) {
         connect(_firstJob.data(), &PropagatorJob::finished, this, &PropagateDirectory::slotFirstJobFinished);
@@ -1175,6 +1421,8 @@ bool PropagateDirectory::scheduleSelfOrChild()
 void PropagateDirectory::slotFirstJobFinished(SyncFileItem::Status status)
 {
     _firstJob.take()->deleteLater();
+    // Our parallelism no longer depends on the first job
+    _subJobs.invalidateParallelism();
 
     if (status != SyncFileItem::Success
         && status != SyncFileItem::Restoration
@@ -1247,7 +1495,7 @@ void PropagateDirectory::slotSubJobsFinished(SyncFileItem::Status status)
 
 PropagateRootDirectory::PropagateRootDirectory(OwncloudPropagator *propagator)
     : PropagateDirectory(propagator, SyncFileItemPtr(new SyncFileItem))
-    , _dirDeletionJobs(propagator)
+    , _dirDeletionJobs(propagator, this)
 {
     connect(&_dirDeletionJobs, &PropagatorJob::finished, this, &PropagateRootDirectory::slotDirDeletionJobsFinished);
 }
@@ -1300,6 +1548,11 @@ bool PropagateRootDirectory::scheduleSelfOrChild()
         return false;
     }
 
+    // Delayed uploads and directory deletions are never interactive
+    if (propagator()->isSchedulingInteractiveOnly()) {
+        return PropagateDirectory::scheduleSelfOrChild();
+    }
+
     if (PropagateDirectory::scheduleSelfOrChild() && propagator()->delayedTasks().empty()) {
         return true;
     }
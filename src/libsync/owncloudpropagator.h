@@ -27,11 +27,15 @@
 #include "csync.h"
 #include "syncfileitem.h"
 #include "common/syncjournaldb.h"
+#include "common/tracer.h"
 #include "bandwidthmanager.h"
+#include "localiopool.h"
 #include "accountfwd.h"
 #include "syncoptions.h"
 
 #include <deque>
+#include <functional>
+#include <set>
 
 namespace OCC {
 
@@ -98,6 +102,19 @@ public:
 
     Q_ENUM(JobParallelism)
 
+    /** Order in which the pending items of a directory are started */
+    enum Priority {
+        /** Items the user is waiting for, like a file that was just saved */
+        InteractivePriority,
+
+        NormalPriority,
+
+        /** Large transfers, started after everything else of the directory */
+        BulkPriority,
+    };
+
+    Q_ENUM(Priority)
+
     virtual JobParallelism parallelism() { return FullParallelism; }
 
     /**
@@ -119,6 +136,7 @@ public:
      * job.
      */
     void setAssociatedComposite(PropagatorCompositeJob *job) { _associatedComposite = job; }
+    [[nodiscard]] PropagatorCompositeJob *associatedComposite() const { return _associatedComposite; }
 
 public slots:
     /*
@@ -189,6 +207,7 @@ protected slots:
 private:
     QScopedPointer<PropagateItemJob> _restoreJob;
     JobParallelism _parallelism;
+    qint64 _traceStart = -1; // see Tracer
 
 public:
     PropagateItemJob(OwncloudPropagator *propagator, const SyncFileItemPtr &item)
@@ -196,10 +215,9 @@ public:
         , _parallelism(FullParallelism)
         , _item(item)
     {
-        // we should always execute jobs that process the E2EE API calls as sequential jobs
-        // TODO: In fact, we must make sure Lock/Unlock are not colliding and always wait for each other to complete. So, we could refactor this "_parallelism" later
-        // so every "PropagateItemJob" that will potentially execute Lock job on E2EE folder will get executed sequentially.
-        // As an alternative, we could optimize Lock/Unlock calls, so we do a batch-write on one folder and only lock and unlock a folder once per batch.
+        // Jobs that process the E2EE API calls on their own run sequentially, so their Lock/Unlock
+        // calls don't collide. Uploads share the lock of their folder through an EncryptedFolderSession
+        // and run in parallel, see PropagateUploadFileCommon::parallelism().
         _parallelism = (_item->_isEncrypted || hasEncryptedAncestor()) ? WaitForFinished : FullParallelism;
     }
     ~PropagateItemJob() override;
@@ -212,6 +230,8 @@ public:
         qCInfo(lcPropagator) << "Starting" << _item->_instruction << "propagation of" << _item->destination() << "by" << this;
 
         _state = Running;
+        if (Tracer::instance()->isEnabled())
+            _traceStart = Tracer::instance()->timestamp();
         QMetaObject::invokeMethod(this, "start"); // We could be in a different thread (neon jobs)
         return true;
     }
@@ -232,15 +252,23 @@ class PropagatorCompositeJob : public PropagatorJob
 {
     Q_OBJECT
 public:
-    QVector<PropagatorJob *> _jobsToDo;
-    SyncFileItemVector _tasksToDo;
+    // Jobs and tasks are taken from the front, a deque keeps that O(1) for large directories
+    std::deque<PropagatorJob *> _jobsToDo;
+    std::deque<SyncFileItemPtr> _tasksToDo;
+    // Taken before the regular jobs and tasks
+    std::deque<PropagatorJob *> _interactiveJobsToDo;
+    std::deque<SyncFileItemPtr> _interactiveTasksToDo;
+    // Taken after the regular jobs and tasks
+    std::deque<SyncFileItemPtr> _bulkTasksToDo;
     QVector<PropagatorJob *> _runningJobs;
     SyncFileItem::Status _hasError; // NoStatus,  or NormalError / SoftError if there was an error
     quint64 _abortsCount;
 
-    explicit PropagatorCompositeJob(OwncloudPropagator *propagator)
+    /** owner is the job this composite is part of, like the PropagateDirectory of its _subJobs */
+    explicit PropagatorCompositeJob(OwncloudPropagator *propagator, PropagatorJob *owner = nullptr)
         : PropagatorJob(propagator)
         , _hasError(SyncFileItem::NoStatus), _abortsCount(0)
+        , _owner(owner)
     {
     }
 
@@ -250,14 +278,27 @@ public:
     ~PropagatorCompositeJob() override = default;
 
     void appendJob(PropagatorJob *job);
-    void appendTask(const SyncFileItemPtr &item)
+    void appendTask(const SyncFileItemPtr &item, Priority priority = NormalPriority);
+
+    /** Moves a pending job in front of the regular ones, returns false if it is not pending */
+    bool promoteJob(PropagatorJob *job);
+
+    [[nodiscard]] bool hasWorkToDo() const
     {
-        _tasksToDo.append(item);
+        return !_jobsToDo.empty() || !_tasksToDo.empty() || !_interactiveJobsToDo.empty()
+            || !_interactiveTasksToDo.empty() || !_bulkTasksToDo.empty();
     }
 
     bool scheduleSelfOrChild() override;
     JobParallelism parallelism() override;
 
+    /** Drops the cached parallelism of this composite and of the composites running it.
+     *
+     * Must be called whenever the running jobs below this composite change. The
+     * parallelism of a single item job never changes once it was created.
+     */
+    void invalidateParallelism();
+
     /*
      * Abort synchronously or asynchronously - some jobs
      * require to be finished without immediete abort (abort on job might
@@ -281,6 +322,20 @@ public:
 
     qint64 committedDiskSpace() const override;
 
+private:
+    /** Takes the next job to start, honoring the priorities.
+     *
+     * When the propagator only schedules interactive items, regular jobs and tasks are skipped.
+     */
+    PropagatorJob *takeNextJob();
+
+    PropagatorJob *_owner;
+
+    // The scheduler asks every running composite for its parallelism on each
+    // pass, the cache keeps that from walking the whole running subtree.
+    JobParallelism _cachedParallelism = FullParallelism;
+    bool _cachedParallelismValid = false;
+
 private slots:
     void slotSubJobAbortFinished();
     bool possiblyRunNextJob(PropagatorJob *next)
@@ -309,6 +364,9 @@ public:
 
     PropagatorCompositeJob _subJobs;
 
+    // Set when an item below this directory has InteractivePriority
+    bool _hasInteractiveItems = false;
+
     explicit PropagateDirectory(OwncloudPropagator *propagator, const SyncFileItemPtr &item);
 
     void appendJob(PropagatorJob *job)
@@ -316,9 +374,9 @@ public:
         _subJobs.appendJob(job);
     }
 
-    void appendTask(const SyncFileItemPtr &item)
+    void appendTask(const SyncFileItemPtr &item, Priority priority = NormalPriority)
     {
-        _subJobs.appendTask(item);
+        _subJobs.appendTask(item, priority);
     }
 
     bool scheduleSelfOrChild() override;
@@ -412,6 +470,7 @@ public:
 };
 
 class PropagateUploadFileCommon;
+class EncryptedFolderSession;
 
 class OWNCLOUDSYNC_EXPORT OwncloudPropagator : public QObject
 {
@@ -456,6 +515,21 @@ public:
     const SyncOptions &syncOptions() const;
     void setSyncOptions(const SyncOptions &syncOptions);
 
+    /** Paths the user is waiting for, like files that were just saved or that
+     * were requested to be made available locally.
+     *
+     * Items at or below these paths are started before the other items of
+     * their directory and may use a few reserved slots while all regular
+     * slots are busy. Must be set before start().
+     */
+    void setPriorityPaths(std::set<QString> paths);
+
+    /** The priority class an item is scheduled with */
+    [[nodiscard]] PropagatorJob::Priority itemPriority(const SyncFileItem &item) const;
+
+    /** Whether the running scheduling pass may only start interactive items */
+    [[nodiscard]] bool isSchedulingInteractiveOnly() const { return _schedulingInteractiveOnly; }
+
     int _downloadLimit = 0;
     int _uploadLimit = 0;
     BandwidthManager _bandwidthManager;
@@ -470,6 +544,10 @@ public:
      */
     QList<PropagateItemJob *> _activeJobList;
 
+    /** Number of item jobs that completed so far, used by the scheduler to
+        notice jobs that completed synchronously */
+    quint64 _completedItemJobCount = 0;
+
     /** We detected that another sync is required after this one */
     bool _anotherSyncNeeded;
 
@@ -585,6 +663,28 @@ public:
     QMap<QString, QString> _renamedDirectories;
     QString adjustRenamedPath(const QString &original) const;
 
+    /** Move the journal records below a renamed directory in one go.
+     *
+     * \a recordPath is where the record of the directory itself was found,
+     * see getRenamedItemRecord().
+     */
+    [[nodiscard]] bool moveRecordsBelowRenamedDirectory(const SyncFileItem &item, const QString &recordPath);
+
+    /** Look up the journal record of a renamed item.
+     *
+     * Records below a renamed directory are moved along with it, so the record
+     * is searched at the original path and then at the path adjusted for renamed
+     * parent directories. \a recordPath is set to where it was found, or to the
+     * original path.
+     */
+    [[nodiscard]] bool getRenamedItemRecord(const SyncFileItem &item, SyncJournalFileRecord *record, QString *recordPath);
+
+    /** Whether the record of a renamed item was moved along with its parent
+     * directory to the target path and still matches the item, so the journal
+     * needs no update.
+     */
+    bool isRecordMovedWithParent(const SyncFileItem &item, const SyncJournalFileRecord &record, const QString &recordPath);
+
     /** Update the database for an item.
      *
      * Typically after a sync operation succeeded. Updates the inode from
@@ -621,6 +721,17 @@ public:
 
     bool isInBulkUploadBlackList(const QString &file) const;
 
+    /** The session sharing the lock and the metadata of the end-to-end encrypted
+     * folder \a folderId between the jobs working in it, created on first use.
+     */
+    EncryptedFolderSession *encryptedFolderSession(const QByteArray &folderId);
+
+    /** Calls \a callback once no encrypted folder session holds the lock of \a folderId */
+    void whenEncryptedFolderUnlocked(const QByteArray &folderId, QObject *context, const std::function<void()> &callback);
+
+    /** Runs the local file system operations of the jobs off the event loop */
+    LocalIoPool &localIoPool() { return _localIoPool; }
+
 private slots:
 
     void abortTimeout()
@@ -664,6 +775,20 @@ private:
     std::unique_ptr<PropagateUploadFileCommon> createUploadJob(SyncFileItemPtr item,
                                                                bool deleteExisting);
 
+    /** Starts the next job if a slot is free, returns whether a job was started */
+    bool scheduleOneJob();
+
+    /** Starts the next interactive job in one of the reserved slots */
+    bool scheduleInteractiveJob();
+
+    /** Marks the directories on the stack as containing interactive items
+     * and moves them before their regular siblings.
+     */
+    void promoteDirectories(const QStack<QPair<QString, PropagateDirectory *>> &directories);
+
+    /** Whether \a path or one of its parents is the source or target of a rename */
+    [[nodiscard]] bool isBelowRenamedPath(QString path) const;
+
     void pushDelayedUploadTask(SyncFileItemPtr item);
 
     void resetDelayedUploadTasks();
@@ -681,8 +806,17 @@ private:
     std::deque<SyncFileItemPtr> _delayedTasks;
     bool _scheduleDelayedTasks = false;
 
+    std::set<QString> _priorityPaths;
+    // Items involved in a rename keep their position, their order matters
+    QSet<QString> _renamedPaths;
+    bool _schedulingInteractiveOnly = false;
+
     QSet<QString> &_bulkUploadBlackList;
 
+    QHash<QByteArray, EncryptedFolderSession *> _encryptedFolderSessions;
+
+    LocalIoPool _localIoPool;
+
     static bool _allowDelayedUpload;
 };
 
@@ -32,6 +32,7 @@
 #include <QNetworkAccessManager>
 #include <QFileInfo>
 #include <QDir>
+#include <qtconcurrentrun.h>
 #include <cmath>
 
 #ifdef Q_OS_UNIX
@@ -43,6 +44,13 @@ namespace OCC {
 Q_LOGGING_CATEGORY(lcGetJob, "nextcloud.sync.networkjob.get", QtInfoMsg)
 Q_LOGGING_CATEGORY(lcPropagateDownload, "nextcloud.sync.propagator.download", QtInfoMsg)
 
+// If the hashes are collision safe and identical, we assume the content is too.
+static bool isCollisionSafeHash(const QByteArray &checksumHeader)
+{
+    return checksumHeader.startsWith("SHA")
+        || checksumHeader.startsWith("MD5:");
+}
+
 // Always coming in with forward slashes.
 // In csync_excluded_no_ctx we ignore all files with longer than 254 chars
 // This function also adds a dot at the beginning of the filename to hide the file on OS X and Linux
@@ -568,18 +576,13 @@ void PropagateDownloadFile::startAfterIsEncryptedIsChecked()
     // If the hashes are collision safe and identical, we assume the content is too.
     // For weak checksums, we only do that if the mtimes are also identical.
 
-    const auto csync_is_collision_safe_hash = [](const QByteArray &checksum_header)
-    {
-        return checksum_header.startsWith("SHA")
-            || checksum_header.startsWith("MD5:");
-    };
     if (_item->_modtime <= 0) {
         qCWarning(lcPropagateDownload()) << "invalid modified time" << _item->_file << _item->_modtime;
     }
     if (_item->_instruction == CSYNC_INSTRUCTION_CONFLICT
         && _item->_size == _item->_previousSize
         && !_item->_checksumHeader.isEmpty()
-        && (csync_is_collision_safe_hash(_item->_checksumHeader)
+        && (isCollisionSafeHash(_item->_checksumHeader)
             || _item->_modtime == _item->_previousModtime)) {
         qCDebug(lcPropagateDownload) << _item->_file << "may not need download, computing checksum";
         auto computeChecksum = new ComputeChecksum(this);
@@ -665,6 +668,10 @@ void PropagateDownloadFile::startDownload()
         return;
     }
 
+    if (_resumeStart == 0 && startLocalContentReuse()) {
+        return;
+    }
+
     // Can't open(Append) read-only files, make sure to make
     // file writable if it exists.
     if (_tmpFile.exists())
@@ -700,6 +707,18 @@ void PropagateDownloadFile::startDownload()
         return;
     }
 
+    // Reserve the blocks of the whole file now, so a full disk is noticed before the transfer
+    QString preallocateError;
+    if (!FileSystem::preallocate(_tmpFile, _item->_size, &preallocateError)) {
+        qCWarning(lcPropagateDownload) << "could not reserve" << _item->_size << "bytes for" << _tmpFile.fileName() << preallocateError;
+        done(SyncFileItem::DetailError, tr("Not enough free disk space to download the file: %1").arg(preallocateError));
+        emit propagator()->insufficientLocalStorage();
+        if (_resumeStart == 0) {
+            _tmpFile.remove();
+        }
+        return;
+    }
+
     {
         SyncJournalDb::DownloadInfo pi;
         pi._etag = _item->_etag;
@@ -711,20 +730,21 @@ void PropagateDownloadFile::startDownload()
 
     QMap<QByteArray, QByteArray> headers;
 
-    if (_item->_directDownloadUrl.isEmpty()) {
+    const auto &extra = _item->extra();
+    if (extra._directDownloadUrl.isEmpty()) {
         // Normal job, download from oC instance
         _job = new GETFileJob(propagator()->account(),
             propagator()->fullRemotePath(_isEncrypted ? _item->_encryptedFileName : _item->_file),
             &_tmpFile, headers, expectedEtagForResume, _resumeStart, this);
     } else {
         // We were provided a direct URL, use that one
-        qCInfo(lcPropagateDownload) << "directDownloadUrl given for " << _item->_file << _item->_directDownloadUrl;
+        qCInfo(lcPropagateDownload) << "directDownloadUrl given for " << _item->_file << extra._directDownloadUrl;
 
-        if (!_item->_directDownloadCookies.isEmpty()) {
-            headers["Cookie"] = _item->_directDownloadCookies.toUtf8();
+        if (!extra._directDownloadCookies.isEmpty()) {
+            headers["Cookie"] = extra._directDownloadCookies.toUtf8();
         }
 
-        QUrl url = QUrl::fromUserInput(_item->_directDownloadUrl);
+        QUrl url = QUrl::fromUserInput(extra._directDownloadUrl);
         _job = new GETFileJob(propagator()->account(),
             url,
             &_tmpFile, headers, expectedEtagForResume, _resumeStart, this);
@@ -736,6 +756,103 @@ void PropagateDownloadFile::startDownload()
     _job->start();
 }
 
+bool PropagateDownloadFile::startLocalContentReuse()
+{
+    if (_localContentReuseTried) {
+        return false;
+    }
+    _localContentReuseTried = true;
+
+    if (_isEncrypted
+        || !_item->extra()._directDownloadUrl.isEmpty()
+        || _item->_size <= 0
+        || _item->_checksumHeader.isEmpty()
+        || propagator()->diskSpaceCheck() != OwncloudPropagator::DiskSpaceOk) {
+        return false;
+    }
+
+    // Only consider local files that are unchanged since the journal recorded their checksum
+    QString sourcePath;
+    const auto ok = propagator()->_journal->getFileRecordsByContentChecksum(_item->_checksumHeader, _item->_size,
+        [this, &sourcePath](const SyncJournalFileRecord &rec) {
+            if (!sourcePath.isEmpty() || rec._type != ItemTypeFile || rec.path() == _item->_file) {
+                return;
+            }
+            const auto candidate = propagator()->fullLocalPath(rec.path());
+            if (FileSystem::fileChanged(candidate, rec._fileSize, rec._modtime)) {
+                return;
+            }
+            sourcePath = candidate;
+        });
+    if (!ok || sourcePath.isEmpty()) {
+        return false;
+    }
+
+    // Without clone support this copies the whole file, do it off the event loop
+    const auto tmpFileName = _tmpFile.fileName();
+    propagator()->_activeJobList.append(this);
+    propagator()->localIoPool().run(
+        LocalIoPool::orderKeyForPath(tmpFileName), this,
+        [sourcePath, tmpFileName] {
+            if (FileSystem::fileExists(tmpFileName)) {
+                FileSystem::setFileReadOnly(tmpFileName, false);
+            }
+            QString error;
+            if (!FileSystem::cloneFile(sourcePath, tmpFileName, &error)) {
+                FileSystem::remove(tmpFileName);
+                return error.isEmpty() ? tr("Could not copy %1").arg(sourcePath) : error;
+            }
+            FileSystem::setFileHidden(tmpFileName, true);
+            return QString();
+        },
+        [this, sourcePath](const QString &error) { localContentCopied(sourcePath, error); });
+    return true;
+}
+
+void PropagateDownloadFile::localContentCopied(const QString &sourcePath, const QString &error)
+{
+    propagator()->_activeJobList.removeOne(this);
+    if (propagator()->_abortRequested) {
+        return;
+    }
+    if (!error.isEmpty()) {
+        qCWarning(lcPropagateDownload) << "Could not reuse" << sourcePath << "for" << _item->_file << error;
+        startDownload();
+        return;
+    }
+    qCInfo(lcPropagateDownload) << "Reusing local content of" << sourcePath << "for" << _item->_file;
+
+    // Validate like a downloaded file, a mismatch falls back to the download
+    auto *validator = new ValidateChecksumHeader(this);
+    connect(validator, &ValidateChecksumHeader::validated,
+        this, &PropagateDownloadFile::localContentChecksumValidated);
+    connect(validator, &ValidateChecksumHeader::validationFailed,
+        this, &PropagateDownloadFile::localContentChecksumFail);
+    propagator()->_activeJobList.append(this);
+    validator->start(_tmpFile.fileName(), _item->_checksumHeader);
+}
+
+void PropagateDownloadFile::localContentChecksumValidated(const QByteArray &checksumType, const QByteArray &checksum)
+{
+    propagator()->_activeJobList.removeOne(this);
+    if (propagator()->_abortRequested) {
+        return;
+    }
+    propagator()->reportProgress(*_item, _item->_size);
+    transmissionChecksumValidated(checksumType, checksum);
+}
+
+void PropagateDownloadFile::localContentChecksumFail(const QString &errMsg)
+{
+    propagator()->_activeJobList.removeOne(this);
+    if (propagator()->_abortRequested) {
+        return;
+    }
+    qCInfo(lcPropagateDownload) << "Local content for" << _item->_file << "does not match, downloading it:" << errMsg;
+    FileSystem::remove(_tmpFile.fileName());
+    startDownload();
+}
+
 qint64 PropagateDownloadFile::committedDiskSpace() const
 {
     if (_state == Running) {
@@ -790,10 +907,10 @@ void PropagateDownloadFile::slotGetFinished()
             propagator()->_journal->setDownloadInfo(_item->_file, SyncJournalDb::DownloadInfo());
         }
 
-        if (!_item->_directDownloadUrl.isEmpty() && err != QNetworkReply::OperationCanceledError) {
+        if (!_item->extra()._directDownloadUrl.isEmpty() && err != QNetworkReply::OperationCanceledError) {
             // If this was with a direct download, retry without direct download
-            qCWarning(lcPropagateDownload) << "Direct download of" << _item->_directDownloadUrl << "failed. Retrying through owncloud.";
-            _item->_directDownloadUrl.clear();
+            qCWarning(lcPropagateDownload) << "Direct download of" << _item->extra()._directDownloadUrl << "failed. Retrying through owncloud.";
+            _item->extraForUpdate()._directDownloadUrl.clear();
             start();
             return;
         }
@@ -1139,10 +1256,30 @@ void PropagateDownloadFile::downloadFinished()
     if (_item->_modtime <= 0) {
         qCWarning(lcPropagateDownload()) << "invalid modified time" << _item->_file << _item->_modtime;
     }
-    FileSystem::setModTime(_tmpFile.fileName(), _item->_modtime);
-    // We need to fetch the time again because some file systems such as FAT have worse than a second
-    // Accuracy, and we really need the time from the file system. (#3103)
-    _item->_modtime = FileSystem::getModTime(_tmpFile.fileName());
+
+    const auto tmpFileName = _tmpFile.fileName();
+    const auto modtime = _item->_modtime;
+    propagator()->_activeJobList.append(this);
+    propagator()->localIoPool().run(
+        LocalIoPool::orderKeyForPath(fn), this,
+        [tmpFileName, modtime] {
+            FileSystem::setModTime(tmpFileName, modtime);
+            // We need to fetch the time again because some file systems such as FAT have worse than a second
+            // Accuracy, and we really need the time from the file system. (#3103)
+            return FileSystem::getModTime(tmpFileName);
+        },
+        [this](time_t modtime) { tmpFileModTimeSet(modtime); });
+}
+
+void PropagateDownloadFile::tmpFileModTimeSet(time_t modtime)
+{
+    propagator()->_activeJobList.removeOne(this);
+    if (propagator()->_abortRequested) {
+        return;
+    }
+    const QString fn = propagator()->fullLocalPath(_item->_file);
+
+    _item->_modtime = modtime;
     if (_item->_modtime <= 0) {
         FileSystem::remove(_tmpFile.fileName());
         done(SyncFileItem::NormalError, tr("File %1 has invalid modified time reported by server. Do not save it.").arg(QDir::toNativeSeparators(_item->_file)));
@@ -1173,8 +1310,55 @@ void PropagateDownloadFile::downloadFinished()
     // Apply the remote permissions
     FileSystem::setFileReadOnlyWeak(_tmpFile.fileName(), !_item->_remotePerm.isNull() && !_item->_remotePerm.hasPermission(RemotePermissions::CanWrite));
 
-    bool isConflict = _item->_instruction == CSYNC_INSTRUCTION_CONFLICT
-        && (QFileInfo(fn).isDir() || !FileSystem::fileEquals(fn, _tmpFile.fileName()));
+    if (_item->_instruction != CSYNC_INSTRUCTION_CONFLICT) {
+        moveTmpFileIntoPlace(/*isConflict=*/false);
+        return;
+    }
+    if (QFileInfo(fn).isDir() || FileSystem::getSize(fn) != FileSystem::getSize(_tmpFile.fileName())) {
+        moveTmpFileIntoPlace(/*isConflict=*/true);
+        return;
+    }
+
+    // The journal checksum still describes the local file if it is unchanged since it was recorded
+    SyncJournalFileRecord record;
+    if (propagator()->_journal->getFileRecord(_item->_file, &record) && record.isValid()
+        && !record._checksumHeader.isEmpty()
+        && parseChecksumHeaderType(record._checksumHeader) == parseChecksumHeaderType(_item->_checksumHeader)
+        && !FileSystem::fileChanged(fn, record._fileSize, record._modtime)) {
+        if (record._checksumHeader != _item->_checksumHeader) {
+            moveTmpFileIntoPlace(/*isConflict=*/true);
+            return;
+        }
+        if (isCollisionSafeHash(record._checksumHeader)) {
+            moveTmpFileIntoPlace(/*isConflict=*/false);
+            return;
+        }
+    }
+
+    // Compare the contents in a thread, the files may be large
+    connect(&_fileEqualsWatcher, &QFutureWatcherBase::finished,
+        this, &PropagateDownloadFile::localContentCompared,
+        Qt::UniqueConnection);
+    propagator()->_activeJobList.append(this);
+    const auto tmpFileName = _tmpFile.fileName();
+    _fileEqualsWatcher.setFuture(QtConcurrent::run([fn, tmpFileName]() {
+        return FileSystem::fileEquals(fn, tmpFileName);
+    }));
+}
+
+void PropagateDownloadFile::localContentCompared()
+{
+    propagator()->_activeJobList.removeOne(this);
+    if (propagator()->_abortRequested || _state != Running) {
+        return;
+    }
+    moveTmpFileIntoPlace(/*isConflict=*/!_fileEqualsWatcher.result());
+}
+
+void PropagateDownloadFile::moveTmpFileIntoPlace(bool isConflict)
+{
+    const QString fn = propagator()->fullLocalPath(_item->_file);
+    bool previousFileExists = FileSystem::fileExists(fn);
     if (isConflict) {
         QString error;
         if (!propagator()->createConflict(_item, _associatedComposite, &error)) {
@@ -1204,10 +1388,32 @@ void PropagateDownloadFile::downloadFinished()
         }
     }
 
-    QString error;
     emit propagator()->touchedFile(fn);
     // The fileChanged() check is done above to generate better error messages.
-    if (!FileSystem::uncheckedRenameReplace(_tmpFile.fileName(), fn, &error)) {
+    const auto tmpFileName = _tmpFile.fileName();
+    propagator()->_activeJobList.append(this);
+    propagator()->localIoPool().run(
+        LocalIoPool::orderKeyForPath(fn), this,
+        [tmpFileName, fn] {
+            QString error;
+            if (!FileSystem::uncheckedRenameReplace(tmpFileName, fn, &error) && error.isEmpty()) {
+                error = tr("Could not rename %1 to %2").arg(tmpFileName, fn);
+            }
+            return error;
+        },
+        [this, isConflict](const QString &error) { tmpFileMovedIntoPlace(isConflict, error); });
+}
+
+void PropagateDownloadFile::tmpFileMovedIntoPlace(bool isConflict, const QString &error)
+{
+    propagator()->_activeJobList.removeOne(this);
+    if (propagator()->_abortRequested) {
+        return;
+    }
+    const QString fn = propagator()->fullLocalPath(_item->_file);
+    const auto vfs = propagator()->syncOptions()._vfs;
+
+    if (!error.isEmpty()) {
         qCWarning(lcPropagateDownload) << QString("Rename failed: %1 => %2").arg(_tmpFile.fileName()).arg(fn);
         // If the file is locked, we want to retry this sync when it
         // becomes available again, otherwise try again directly
@@ -1222,7 +1428,8 @@ void PropagateDownloadFile::downloadFinished()
     }
 
     qCInfo(lcPropagateDownload()) << propagator()->account()->davUser() << propagator()->account()->davDisplayName() << propagator()->account()->displayName();
-    if (_item->_locked == SyncFileItem::LockStatus::LockedItem && (_item->_lockOwnerType != SyncFileItem::LockOwnerType::UserLock || _item->_lockOwnerId != propagator()->account()->davUser())) {
+    const auto &lock = _item->extra();
+    if (lock._locked == SyncFileItem::LockStatus::LockedItem && (lock._lockOwnerType != SyncFileItem::LockOwnerType::UserLock || lock._lockOwnerId != propagator()->account()->davUser())) {
         qCInfo(lcPropagateDownload()) << "file is locked: making it read only";
         FileSystem::setFileReadOnly(fn, true);
     }
@@ -1325,6 +1532,10 @@ void PropagateDownloadFile::abort(PropagatorJob::AbortType abortType)
     if (_job && _job->reply())
         _job->reply()->abort();
 
+    // The comparison can't be interrupted, but nothing continues after it
+    disconnect(&_fileEqualsWatcher, &QFutureWatcherBase::finished,
+        this, &PropagateDownloadFile::localContentCompared);
+
     if (abortType == AbortType::Asynchronous) {
         emit abortFinished();
     }
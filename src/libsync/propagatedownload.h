@@ -21,6 +21,7 @@
 
 #include <QBuffer>
 #include <QFile>
+#include <QFutureWatcher>
 
 namespace OCC {
 class PropagateDownloadEncrypted;
@@ -231,6 +232,10 @@ private slots:
     /// Called when the download's checksum computation is done
     void contentChecksumComputed(const QByteArray &checksumType, const QByteArray &checksum);
     void downloadFinished();
+    /// Called when the modification time of the temporary file was set to \a modtime
+    void tmpFileModTimeSet(time_t modtime);
+    /// Called when the comparison of a conflicting local file with the download is done
+    void localContentCompared();
     /// Called when it's time to update the db metadata
     void updateMetadata(bool isConflict);
 
@@ -240,17 +245,39 @@ private slots:
         const QByteArray &calculatedChecksum, const ValidateChecksumHeader::FailureReason reason);
     void processChecksumRecalculate(const QNetworkReply *reply, const QByteArray &originalChecksumHeader, const QString &errorMessage);
     void checksumValidateFailedAbortDownload(const QString &errMsg);
+    /// Called when copying a local file into the temporary file is done, unless there was an \a error
+    void localContentCopied(const QString &sourcePath, const QString &error);
+    /// Called when the checksum of content copied from a local file was validated
+    void localContentChecksumValidated(const QByteArray &checksumType, const QByteArray &checksum);
+    /// Called when content copied from a local file doesn't match, downloads instead
+    void localContentChecksumFail(const QString &errMsg);
 
 private:
     void startAfterIsEncryptedIsChecked();
     void deleteExistingFolder();
 
+    /**
+     * Fills the temporary file from a local file the journal knows to have
+     * the same content checksum, instead of downloading it. The copy runs
+     * in the LocalIoPool; if it fails the download is started.
+     *
+     * Returns false if no suitable local file was found.
+     */
+    bool startLocalContentReuse();
+
+    /// Replaces the local file with the download, creating a conflict file first if needed
+    void moveTmpFileIntoPlace(bool isConflict);
+    /// Finishes the download once the temporary file replaced the local one, unless there is an \a error
+    void tmpFileMovedIntoPlace(bool isConflict, const QString &error);
+
     qint64 _resumeStart;
     qint64 _downloadProgress;
     QPointer<GETFileJob> _job;
     QFile _tmpFile;
+    QFutureWatcher<bool> _fileEqualsWatcher;
     bool _deleteExisting;
     bool _isEncrypted = false;
+    bool _localContentReuseTried = false;
     EncryptedFile _encryptedInfo;
     ConflictRecord _conflictRecord;
 
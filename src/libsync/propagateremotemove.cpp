@@ -245,25 +245,31 @@ void PropagateRemoteMove::finalize()
     // The db is only queried to transfer the content checksum from the old
     // to the new record. It is not a problem to skip it here.
     SyncJournalFileRecord oldRecord;
-    if (!propagator()->_journal->getFileRecord(_item->_originalFile, &oldRecord)) {
+    QString recordPath;
+    if (!propagator()->getRenamedItemRecord(*_item, &oldRecord, &recordPath)) {
         qCWarning(lcPropagateRemoteMove) << "could not get file from local DB" << _item->_originalFile;
         done(SyncFileItem::NormalError, tr("could not get file %1 from local DB").arg(_item->_originalFile));
         return;
     }
+    if (propagator()->isRecordMovedWithParent(*_item, oldRecord, recordPath)) {
+        // The record was already moved along with the parent directory
+        done(SyncFileItem::Success);
+        return;
+    }
     auto &vfs = propagator()->syncOptions()._vfs;
-    auto pinState = vfs->pinState(_item->_originalFile);
+    auto pinState = vfs->pinState(recordPath);
 
     const auto targetFile = propagator()->fullLocalPath(_item->_renameTarget);
 
     if (QFileInfo::exists(targetFile)) {
         // Delete old db data.
-        if (!propagator()->_journal->deleteFileRecord(_item->_originalFile)) {
-            qCWarning(lcPropagateRemoteMove) << "could not delete file from local DB" << _item->_originalFile;
-            done(SyncFileItem::NormalError, tr("Could not delete file record %1 from local DB").arg(_item->_originalFile));
+        if (!propagator()->_journal->deleteFileRecord(recordPath)) {
+            qCWarning(lcPropagateRemoteMove) << "could not delete file from local DB" << recordPath;
+            done(SyncFileItem::NormalError, tr("Could not delete file record %1 from local DB").arg(recordPath));
             return;
         }
-        if (!vfs->setPinState(_item->_originalFile, PinState::Inherited)) {
-            qCWarning(lcPropagateRemoteMove) << "Could not set pin state of" << _item->_originalFile << "to inherited";
+        if (!vfs->setPinState(recordPath, PinState::Inherited)) {
+            qCWarning(lcPropagateRemoteMove) << "Could not set pin state of" << recordPath << "to inherited";
         }
     }
 
@@ -301,7 +307,8 @@ void PropagateRemoteMove::finalize()
 
     if (_item->isDirectory()) {
         propagator()->_renamedDirectories.insert(_item->_file, _item->_renameTarget);
-        if (!adjustSelectiveSync(propagator()->_journal, _item->_file, _item->_renameTarget)) {
+        if (!propagator()->moveRecordsBelowRenamedDirectory(*_item, recordPath)
+            || !adjustSelectiveSync(propagator()->_journal, _item->_file, _item->_renameTarget)) {
             done(SyncFileItem::FatalError, tr("Error writing metadata to the database"));
             return;
         }
@@ -45,6 +45,7 @@ namespace OCC {
 
 Q_LOGGING_CATEGORY(lcPutJob, "nextcloud.sync.networkjob.put", QtInfoMsg)
 Q_LOGGING_CATEGORY(lcPollJob, "nextcloud.sync.networkjob.poll", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcCopyJob, "nextcloud.sync.networkjob.copy", QtInfoMsg)
 Q_LOGGING_CATEGORY(lcPropagateUpload, "nextcloud.sync.propagator.upload", QtInfoMsg)
 Q_LOGGING_CATEGORY(lcPropagateUploadV1, "nextcloud.sync.propagator.upload.v1", QtInfoMsg)
 Q_LOGGING_CATEGORY(lcPropagateUploadNG, "nextcloud.sync.propagator.upload.ng", QtInfoMsg)
@@ -168,6 +169,38 @@ bool PollJob::finished()
     return true;
 }
 
+CopyJob::CopyJob(AccountPtr account, const QString &path, const QString &destination,
+    QMap<QByteArray, QByteArray> extraHeaders, QObject *parent)
+    : AbstractNetworkJob(account, path, parent)
+    , _destination(destination)
+    , _extraHeaders(extraHeaders)
+{
+}
+
+void CopyJob::start()
+{
+    QNetworkRequest req;
+    req.setRawHeader("Destination", QUrl::toPercentEncoding(_destination, "/"));
+    for (auto it = _extraHeaders.constBegin(); it != _extraHeaders.constEnd(); ++it) {
+        req.setRawHeader(it.key(), it.value());
+    }
+    sendRequest("COPY", makeDavUrl(path()), req);
+
+    if (reply()->error() != QNetworkReply::NoError) {
+        qCWarning(lcCopyJob) << " Network error: " << reply()->errorString();
+    }
+    AbstractNetworkJob::start();
+}
+
+bool CopyJob::finished()
+{
+    qCInfo(lcCopyJob) << "COPY of" << reply()->request().url() << "FINISHED WITH STATUS"
+                      << replyStatusString();
+
+    emit finishedSignal();
+    return true;
+}
+
 PropagateUploadFileCommon::PropagateUploadFileCommon(OwncloudPropagator *propagator, const SyncFileItemPtr &item)
     : PropagateItemJob(propagator, item)
     , _finished(false)
@@ -423,6 +456,159 @@ void PropagateUploadFileCommon::slotStartUpload(const QByteArray &transmissionCh
         return slotOnErrorStartFolderUnlock(SyncFileItem::SoftError, tr("Local file changed during sync."));
     }
 
+    if (startServerSideCopy()) {
+        return;
+    }
+
+    doStartUpload();
+}
+
+bool PropagateUploadFileCommon::startServerSideCopy()
+{
+    const auto minSize = propagator()->syncOptions()._minServerSideCopySize;
+    if (minSize < 0 || _item->_size < minSize
+        || _uploadingEncrypted
+        || _deleteExisting
+        || _item->_instruction != CSYNC_INSTRUCTION_NEW
+        || _item->_checksumHeader.isEmpty()
+        || _item->_file.contains(QLatin1String(".sys.admin#recall#"))) {
+        return false;
+    }
+
+    // Conflict files carry extra headers on upload that a copy can't set
+    if (propagator()->_journal->conflictRecord(_item->_file.toUtf8()).isValid()) {
+        return false;
+    }
+
+    SyncJournalFileRecord source;
+    const auto ok = propagator()->_journal->getFileRecordsByContentChecksum(_item->_checksumHeader, _item->_size,
+        [this, &source](const SyncJournalFileRecord &rec) {
+            if (source.isValid()
+                || rec.path() == _item->_file
+                || !(rec.isFile() || rec.isVirtualFile())
+                || rec._isE2eEncrypted
+                || !rec._e2eMangledName.isEmpty()
+                || rec._etag.isEmpty()) {
+                return;
+            }
+            source = rec;
+        });
+    if (!ok || !source.isValid()) {
+        return false;
+    }
+
+    qCInfo(lcPropagateUpload) << "Copying" << source.path() << "on the server to" << _item->_file << "instead of uploading it";
+
+    // Never overwrite, and only copy the exact version the journal knows the checksum of.
+    QMap<QByteArray, QByteArray> headers;
+    headers[QByteArrayLiteral("Overwrite")] = QByteArrayLiteral("F");
+    headers[QByteArrayLiteral("If-Match")] = '"' + source._etag + '"';
+    const auto destination = QDir::cleanPath(propagator()->account()->davUrl().path() + propagator()->fullRemotePath(_item->_file));
+    auto job = new CopyJob(propagator()->account(), propagator()->fullRemotePath(source.path()), destination, headers, this);
+    connect(job, &CopyJob::finishedSignal, this, &PropagateUploadFileCommon::slotCopyFinished);
+    startServerSideCopyJob(job);
+    return true;
+}
+
+void PropagateUploadFileCommon::startServerSideCopyJob(AbstractNetworkJob *job)
+{
+    _jobs.append(job);
+    connect(job, &QObject::destroyed, this, &PropagateUploadFileCommon::slotJobDestroyed);
+    propagator()->_activeJobList.append(this);
+    job->start();
+}
+
+void PropagateUploadFileCommon::slotCopyFinished()
+{
+    auto *job = qobject_cast<CopyJob *>(sender());
+    ASSERT(job);
+
+    slotJobDestroyed(job);
+    propagator()->_activeJobList.removeOne(this);
+
+    if (_finished || _aborting) {
+        return;
+    }
+
+    const auto httpStatus = job->reply()->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (job->reply()->error() != QNetworkReply::NoError || httpStatus != 201) {
+        qCInfo(lcPropagateUpload) << "Server side copy to" << _item->_file << "was refused" << httpStatus << job->errorString();
+        slotServerSideCopyFailed();
+        return;
+    }
+
+    _item->_responseTimeStamp = job->responseTimestamp();
+    _item->_requestId = job->requestId();
+
+    // The copy has the modification time of the source, set the local one
+    auto proppatchJob = new ProppatchJob(propagator()->account(), propagator()->fullRemotePath(_item->_file), this);
+    proppatchJob->setProperties({ { QByteArrayLiteral("DAV::lastmodified"), QByteArray::number(qint64(_item->_modtime)) } });
+    connect(proppatchJob, &ProppatchJob::success, this, &PropagateUploadFileCommon::slotCopyModTimeSet);
+    connect(proppatchJob, &ProppatchJob::finishedWithError, this, &PropagateUploadFileCommon::slotServerSideCopyFailed);
+    startServerSideCopyJob(proppatchJob);
+}
+
+void PropagateUploadFileCommon::slotCopyModTimeSet()
+{
+    auto *job = qobject_cast<ProppatchJob *>(sender());
+    ASSERT(job);
+
+    slotJobDestroyed(job);
+    propagator()->_activeJobList.removeOne(this);
+
+    if (_finished || _aborting) {
+        return;
+    }
+
+    // Fetch the etag, file id and permissions of the new file
+    auto propfindJob = new PropfindJob(propagator()->account(), propagator()->fullRemotePath(_item->_file), this);
+    propfindJob->setProperties({ QByteArrayLiteral("getetag"),
+        QByteArrayLiteral("http://owncloud.org/ns:id"),
+        QByteArrayLiteral("http://owncloud.org/ns:permissions") });
+    connect(propfindJob, &PropfindJob::result, this, &PropagateUploadFileCommon::slotCopyPropfindResult);
+    connect(propfindJob, &PropfindJob::finishedWithError, this, &PropagateUploadFileCommon::slotServerSideCopyFailed);
+    startServerSideCopyJob(propfindJob);
+}
+
+void PropagateUploadFileCommon::slotCopyPropfindResult(const QVariantMap &result)
+{
+    auto *job = qobject_cast<PropfindJob *>(sender());
+    ASSERT(job);
+
+    slotJobDestroyed(job);
+    propagator()->_activeJobList.removeOne(this);
+
+    if (_finished || _aborting) {
+        return;
+    }
+
+    const auto etag = parseEtag(result.value(QStringLiteral("getetag")).toByteArray().constData());
+    if (etag.isEmpty()) {
+        slotServerSideCopyFailed();
+        return;
+    }
+    _item->_etag = etag;
+    _item->_fileId = result.value(QStringLiteral("id")).toByteArray();
+    if (result.contains(QStringLiteral("permissions"))) {
+        _item->_remotePerm = RemotePermissions::fromServerString(result.value(QStringLiteral("permissions")).toString());
+    }
+
+    propagator()->reportProgress(*_item, _item->_size);
+    finalize();
+}
+
+void PropagateUploadFileCommon::slotServerSideCopyFailed()
+{
+    if (auto *job = qobject_cast<AbstractNetworkJob *>(sender())) {
+        slotJobDestroyed(job);
+    }
+    propagator()->_activeJobList.removeOne(this);
+
+    if (_finished || _aborting) {
+        return;
+    }
+
+    qCInfo(lcPropagateUpload) << "Server side copy to" << _item->_file << "failed, uploading it instead";
     doStartUpload();
 }
 
@@ -481,12 +667,14 @@ bool UploadDevice::open(QIODevice::OpenMode mode)
 
     _size = qBound(0ll, _size, fileDiskSize - _start);
     _read = 0;
+    FileSystem::adviseSequentialRead(_file, _start, _size);
 
     return QIODevice::open(mode);
 }
 
 void UploadDevice::close()
 {
+    FileSystem::releasePageCache(_file, _start, _size);
     _file.close();
     QIODevice::close();
 }
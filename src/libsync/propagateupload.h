@@ -179,6 +179,30 @@ signals:
     void finishedSignal();
 };
 
+/**
+ * @brief Server side COPY of an already uploaded file
+ *
+ * Used to create a new remote file from content the server already has
+ * instead of uploading it again.
+ * @ingroup libsync
+ */
+class CopyJob : public AbstractNetworkJob
+{
+    Q_OBJECT
+    const QString _destination;
+    QMap<QByteArray, QByteArray> _extraHeaders;
+
+public:
+    explicit CopyJob(AccountPtr account, const QString &path, const QString &destination,
+        QMap<QByteArray, QByteArray> extraHeaders, QObject *parent = nullptr);
+
+    void start() override;
+    bool finished() override;
+
+signals:
+    void finishedSignal();
+};
+
 class PropagateUploadEncrypted;
 
 /**
@@ -196,7 +220,10 @@ class PropagateUploadEncrypted;
  *         |
  *         v
  *    slotStartUpload()  -> doStartUpload()
- *                                  .
+ *         |                        .
+ *         v                        .
+ *    startServerSideCopy()         .
+ *    (falls back to doStartUpload) .
  *                                  .
  *                                  v
  *        finalize() or abortWithError()  or startPollJob()
@@ -255,6 +282,8 @@ public:
     void startUploadFile();
     void callUnlockFolder();
     bool isLikelyFinishedQuickly() override { return _item->_size < propagator()->smallFileSize(); }
+    // Uploads into an encrypted folder share its lock and metadata, see EncryptedFolderSession
+    JobParallelism parallelism() override { return FullParallelism; }
 
 private slots:
     void slotComputeContentChecksum();
@@ -266,6 +295,11 @@ private slots:
     void slotFolderUnlocked(const QByteArray &folderId, int httpReturnCode);
     // invoked on internal error to unlock a folder and faile
     void slotOnErrorStartFolderUnlock(SyncFileItem::Status status, const QString &errorString);
+    // server side copy steps, any failure falls back to a regular upload
+    void slotCopyFinished();
+    void slotCopyModTimeSet();
+    void slotCopyPropfindResult(const QVariantMap &result);
+    void slotServerSideCopyFailed();
 
 public:
     virtual void doStartUpload() = 0;
@@ -317,6 +351,15 @@ protected:
     /** Bases headers that need to be sent on the PUT, or in the MOVE for chunking-ng */
     QMap<QByteArray, QByteArray> headers();
 private:
+    /**
+     * Starts a server side COPY if the journal knows a remote file with
+     * the same content checksum and size.
+     *
+     * Returns false if no copy was started and the upload should proceed.
+     */
+    bool startServerSideCopy();
+    void startServerSideCopyJob(AbstractNetworkJob *job);
+
   PropagateUploadEncrypted *_uploadEncryptedHelper;
   bool _uploadingEncrypted;
   UploadStatus _uploadStatus;
@@ -3,6 +3,7 @@
 #include "networkjobs.h"
 #include "clientsideencryption.h"
 #include "account.h"
+#include "encryptedfoldersession.h"
 
 #include <QFileInfo>
 #include <QDir>
@@ -21,10 +22,17 @@ PropagateUploadEncrypted::PropagateUploadEncrypted(OwncloudPropagator *propagato
     , _propagator(propagator)
     , _remoteParentPath(remoteParentPath)
     , _item(item)
-    , _metadata(nullptr)
 {
 }
 
+PropagateUploadEncrypted::~PropagateUploadEncrypted()
+{
+    // Don't keep the folder locked for the other uploads when we are aborted
+    if (_session && _isFolderLocked && !_isUnlockRunning) {
+        _session->release(nullptr, [](int) {});
+    }
+}
+
 void PropagateUploadEncrypted::start()
 {
     const auto rootPath = [=]() {
@@ -62,13 +70,11 @@ void PropagateUploadEncrypted::start()
     job->start();
 }
 
-/* We try to lock a folder, if it's locked we try again in one second.
- * if it's still locked we try again in one second. looping untill one minute.
- *                                                                      -> fail.
- * the 'loop':                                                         /
- *    slotFolderEncryptedIdReceived -> slotTryLock -> lockError -> stillTime? -> slotTryLock
- *                                        \
- *                                         -> success.
+/* The folder is locked and its metadata fetched through the session it shares
+ * with the other jobs working in the same folder:
+ *
+ *    slotFolderEncryptedIdReceived -> acquire -> slotFolderLockedSuccessfully
+ *        -> commitMetadata -> slotUpdateMetadataSuccess -> finalized()
  */
 
 void PropagateUploadEncrypted::slotFolderEncryptedIdReceived(const QStringList &list)
@@ -76,53 +82,25 @@ void PropagateUploadEncrypted::slotFolderEncryptedIdReceived(const QStringList &
   qCDebug(lcPropagateUploadEncrypted) << "Received id of folder, trying to lock it so we can prepare the metadata";
   auto job = qobject_cast<LsColJob *>(sender());
   const auto& folderInfo = job->_folderInfos.value(list.first());
-  _folderLockFirstTry.start();
-  slotTryLock(folderInfo.fileId);
-}
-
-void PropagateUploadEncrypted::slotTryLock(const QByteArray& fileId)
-{
-  auto *lockJob = new LockEncryptFolderApiJob(_propagator->account(), fileId, this);
-  connect(lockJob, &LockEncryptFolderApiJob::success, this, &PropagateUploadEncrypted::slotFolderLockedSuccessfully);
-  connect(lockJob, &LockEncryptFolderApiJob::error, this, &PropagateUploadEncrypted::slotFolderLockedError);
-  lockJob->start();
+  _folderId = folderInfo.fileId;
+  _session = _propagator->encryptedFolderSession(_folderId);
+  _session->acquire(this, [this](bool ok) {
+      if (!ok) {
+          qCDebug(lcPropagateUploadEncrypted) << "Folder" << _folderId << "could not be locked.";
+          emit error();
+          return;
+      }
+      slotFolderLockedSuccessfully();
+  });
 }
 
-void PropagateUploadEncrypted::slotFolderLockedSuccessfully(const QByteArray& fileId, const QByteArray& token)
+void PropagateUploadEncrypted::slotFolderLockedSuccessfully()
 {
-  qCDebug(lcPropagateUploadEncrypted) << "Folder" << fileId << "Locked Successfully for Upload, Fetching Metadata";
-  // Should I use a mutex here?
-  _currentLockingInProgress = true;
-  _folderToken = token;
-  _folderId = fileId;
+  qCDebug(lcPropagateUploadEncrypted) << "Folder" << _folderId << "Locked Successfully for Upload, Preparing the metadata for the new file.";
+  _folderToken = _session->token();
   _isFolderLocked = true;
 
-  auto job = new GetMetadataApiJob(_propagator->account(), _folderId);
-  connect(job, &GetMetadataApiJob::jsonReceived,
-          this, &PropagateUploadEncrypted::slotFolderEncryptedMetadataReceived);
-  connect(job, &GetMetadataApiJob::error,
-          this, &PropagateUploadEncrypted::slotFolderEncryptedMetadataError);
-
-  job->start();
-}
-
-void PropagateUploadEncrypted::slotFolderEncryptedMetadataError(const QByteArray& fileId, int httpReturnCode)
-{
-    Q_UNUSED(fileId);
-    Q_UNUSED(httpReturnCode);
-    qCDebug(lcPropagateUploadEncrypted()) << "Error Getting the encrypted metadata. Pretend we got empty metadata.";
-    FolderMetadata emptyMetadata(_propagator->account());
-    emptyMetadata.encryptedMetadata();
-    auto json = QJsonDocument::fromJson(emptyMetadata.encryptedMetadata());
-    slotFolderEncryptedMetadataReceived(json, httpReturnCode);
-}
-
-void PropagateUploadEncrypted::slotFolderEncryptedMetadataReceived(const QJsonDocument &json, int statusCode)
-{
-  qCDebug(lcPropagateUploadEncrypted) << "Metadata Received, Preparing it for the new file." << json.toVariant();
-
-  // Encrypt File!
-  _metadata = new FolderMetadata(_propagator->account(), json.toJson(QJsonDocument::Compact), statusCode);
+  const auto metadata = _session->metadata();
 
   QFileInfo info(_propagator->fullLocalPath(_item->_file));
   const QString fileName = info.fileName();
@@ -130,7 +108,7 @@ void PropagateUploadEncrypted::slotFolderEncryptedMetadataReceived(const QJsonDo
   // Find existing metadata for this file
   bool found = false;
   EncryptedFile encryptedFile;
-  const QVector<EncryptedFile> files = _metadata->files();
+  const QVector<EncryptedFile> files = metadata->files();
 
   for(const EncryptedFile &file : files) {
     if (file.originalFilename == fileName) {
@@ -190,33 +168,22 @@ void PropagateUploadEncrypted::slotFolderEncryptedMetadataReceived(const QJsonDo
 
   qCDebug(lcPropagateUploadEncrypted) << "Creating the metadata for the encrypted file.";
 
-  _metadata->addEncryptedFile(encryptedFile);
+  metadata->addEncryptedFile(encryptedFile);
   _encryptedFile = encryptedFile;
 
   qCDebug(lcPropagateUploadEncrypted) << "Metadata created, sending to the server.";
 
-  if (statusCode == 404) {
-    auto job = new StoreMetaDataApiJob(_propagator->account(),
-                                       _folderId,
-                                       _metadata->encryptedMetadata());
-    connect(job, &StoreMetaDataApiJob::success, this, &PropagateUploadEncrypted::slotUpdateMetadataSuccess);
-    connect(job, &StoreMetaDataApiJob::error, this, &PropagateUploadEncrypted::slotUpdateMetadataError);
-    job->start();
-  } else {
-    auto job = new UpdateMetadataApiJob(_propagator->account(),
-                                      _folderId,
-                                      _metadata->encryptedMetadata(),
-                                      _folderToken);
-
-    connect(job, &UpdateMetadataApiJob::success, this, &PropagateUploadEncrypted::slotUpdateMetadataSuccess);
-    connect(job, &UpdateMetadataApiJob::error, this, &PropagateUploadEncrypted::slotUpdateMetadataError);
-    job->start();
-  }
+  _session->commitMetadata(this, [this](bool ok) {
+      if (ok) {
+          slotUpdateMetadataSuccess();
+      } else {
+          slotUpdateMetadataError();
+      }
+  });
 }
 
-void PropagateUploadEncrypted::slotUpdateMetadataSuccess(const QByteArray& fileId)
+void PropagateUploadEncrypted::slotUpdateMetadataSuccess()
 {
-    Q_UNUSED(fileId);
     qCDebug(lcPropagateUploadEncrypted) << "Uploading of the metadata success, Encrypting the file";
     QFileInfo outputInfo(_completeFileName);
 
@@ -227,38 +194,18 @@ void PropagateUploadEncrypted::slotUpdateMetadataSuccess(const QByteArray& fileI
                    outputInfo.size());
 }
 
-void PropagateUploadEncrypted::slotUpdateMetadataError(const QByteArray& fileId, int httpErrorResponse)
+void PropagateUploadEncrypted::slotUpdateMetadataError()
 {
-  qCDebug(lcPropagateUploadEncrypted) << "Update metadata error for folder" << fileId << "with error" << httpErrorResponse;
+  qCDebug(lcPropagateUploadEncrypted) << "Update metadata error for folder" << _folderId;
+  // Don't let the next metadata update of the folder announce our file
+  if (auto metadata = _session ? _session->metadata() : nullptr) {
+      metadata->removeEncryptedFile(_encryptedFile);
+  }
   qCDebug(lcPropagateUploadEncrypted()) << "Unlocking the folder.";
   connect(this, &PropagateUploadEncrypted::folderUnlocked, this, &PropagateUploadEncrypted::error);
   unlockFolder();
 }
 
-void PropagateUploadEncrypted::slotFolderLockedError(const QByteArray& fileId, int httpErrorCode)
-{
-    Q_UNUSED(httpErrorCode);
-    /* try to call the lock from 5 to 5 seconds
-     * and fail if it's more than 5 minutes. */
-    QTimer::singleShot(5000, this, [this, fileId]{
-        if (!_currentLockingInProgress) {
-            qCDebug(lcPropagateUploadEncrypted) << "Error locking the folder while no other update is locking it up.";
-            qCDebug(lcPropagateUploadEncrypted) << "Perhaps another client locked it.";
-            qCDebug(lcPropagateUploadEncrypted) << "Abort";
-        return;
-        }
-
-        // Perhaps I should remove the elapsed timer if the lock is from this client?
-        if (_folderLockFirstTry.elapsed() > /* five minutes */ 1000 * 60 * 5 ) {
-            qCDebug(lcPropagateUploadEncrypted) << "One minute passed, ignoring more attempts to lock the folder.";
-        return;
-        }
-        slotTryLock(fileId);
-    });
-
-    qCDebug(lcPropagateUploadEncrypted) << "Folder" << fileId << "Coundn't be locked.";
-}
-
 void PropagateUploadEncrypted::slotFolderEncryptedIdError(QNetworkReply *r)
 {
     Q_UNUSED(r);
@@ -270,32 +217,36 @@ void PropagateUploadEncrypted::unlockFolder()
     ASSERT(!_isUnlockRunning);
 
     if (_isUnlockRunning) {
-        qWarning() << "Double-call to unlockFolder.";
+        qCWarning(lcPropagateUploadEncrypted) << "Double-call to unlockFolder.";
         return;
     }
 
     _isUnlockRunning = true;
 
-    qDebug() << "Calling Unlock";
-    auto *unlockJob = new UnlockEncryptFolderApiJob(_propagator->account(),
-        _folderId, _folderToken, this);
-
-    connect(unlockJob, &UnlockEncryptFolderApiJob::success, [this](const QByteArray &folderId) {
-        qDebug() << "Successfully Unlocked";
+    const auto unlocked = [this](int httpStatus) {
+        if (httpStatus == 200) {
+            qCDebug(lcPropagateUploadEncrypted) << "Successfully unlocked folder" << _folderId;
+        } else {
+            qCWarning(lcPropagateUploadEncrypted) << "Unlocking folder" << _folderId << "failed with HTTP status" << httpStatus;
+        }
+        const auto folderId = _folderId;
         _folderToken = "";
         _folderId = "";
         _isFolderLocked = false;
 
-        emit folderUnlocked(folderId, 200);
-        _isUnlockRunning = false;
-    });
-    connect(unlockJob, &UnlockEncryptFolderApiJob::error, [this](const QByteArray &folderId, int httpStatus) {
-        qDebug() << "Unlock Error";
-
         emit folderUnlocked(folderId, httpStatus);
         _isUnlockRunning = false;
-    });
-    unlockJob->start();
+    };
+
+    if (!_session) {
+        // The session went away with the propagator and unlocked the folder itself
+        qCWarning(lcPropagateUploadEncrypted) << "No session left to release folder" << _folderId;
+        unlocked(200);
+        return;
+    }
+
+    qCDebug(lcPropagateUploadEncrypted) << "Releasing the lock of folder" << _folderId;
+    _session->release(this, unlocked);
 }
 
 } // namespace OCC
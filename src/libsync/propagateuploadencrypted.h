@@ -9,18 +9,22 @@
 #include <QNetworkReply>
 #include <QFile>
 #include <QTemporaryFile>
+#include <QPointer>
 
 #include "owncloudpropagator.h"
 #include "clientsideencryption.h"
 
 namespace OCC {
-class FolderMetadata;
+class EncryptedFolderSession;
 
   /* This class is used if the server supports end to end encryption.
  * It will fire for *any* folder, encrypted or not, because when the
  * client starts the upload request we don't know if the folder is
  * encrypted on the server.
  *
+ * The lock and the metadata of the folder are shared with the other jobs
+ * uploading into it at the same time, see EncryptedFolderSession.
+ *
  * emits:
  * finalized() if the encrypted file is ready to be uploaded
  * error() if there was an error with the encryption
@@ -33,7 +37,7 @@ class PropagateUploadEncrypted : public QObject
   Q_OBJECT
 public:
     PropagateUploadEncrypted(OwncloudPropagator *propagator, const QString &remoteParentPath, SyncFileItemPtr item, QObject *parent = nullptr);
-    ~PropagateUploadEncrypted() override = default;
+    ~PropagateUploadEncrypted() override;
 
     void start();
 
@@ -46,13 +50,9 @@ public:
 private slots:
     void slotFolderEncryptedIdReceived(const QStringList &list);
     void slotFolderEncryptedIdError(QNetworkReply *r);
-    void slotFolderLockedSuccessfully(const QByteArray& fileId, const QByteArray& token);
-    void slotFolderLockedError(const QByteArray& fileId, int httpErrorCode);
-    void slotTryLock(const QByteArray& fileId);
-    void slotFolderEncryptedMetadataReceived(const QJsonDocument &json, int statusCode);
-    void slotFolderEncryptedMetadataError(const QByteArray& fileId, int httpReturnCode);
-    void slotUpdateMetadataSuccess(const QByteArray& fileId);
-    void slotUpdateMetadataError(const QByteArray& fileId, int httpReturnCode);
+    void slotFolderLockedSuccessfully();
+    void slotUpdateMetadataSuccess();
+    void slotUpdateMetadataError();
 
 signals:
     // Emmited after the file is encrypted and everythign is setup.
@@ -67,16 +67,11 @@ private:
 
   QByteArray _folderToken;
   QByteArray _folderId;
-
-  QElapsedTimer _folderLockFirstTry;
-  bool _currentLockingInProgress = false;
+  QPointer<EncryptedFolderSession> _session;
 
   bool _isUnlockRunning = false;
   bool _isFolderLocked = false;
 
-  QByteArray _generatedKey;
-  QByteArray _generatedIv;
-  FolderMetadata *_metadata;
   EncryptedFile _encryptedFile;
   QString _completeFileName;
 };
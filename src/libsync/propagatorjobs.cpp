@@ -47,46 +47,35 @@ QByteArray localFileIdFromFullId(const QByteArray &id)
 }
 
 /**
- * The code will update the database in case of error.
- * If everything goes well (no error, returns true), the caller is responsible for removing the entries
- * in the database.  But in case of error, we need to remove the entries from the database of the files
- * that were deleted.
+ * Runs on a worker thread of the LocalIoPool, so it only gets to see values.
  *
- * \a path is relative to propagator()->_localDir + _item->_file and should start with a slash
+ * If a recursive removal fails, the result lists what was deleted nonetheless:
+ * the caller needs to remove those entries from the database. If everything
+ * goes well the caller removes the entries of the whole tree.
  */
-bool PropagateLocalRemove::removeRecursively(const QString &path)
+PropagateLocalRemove::RemoveResult PropagateLocalRemove::removeLocally(const QString &filename, bool isDirectory, bool moveToTrash)
 {
-    QString absolute = propagator()->fullLocalPath(_item->_file + path);
-    QStringList errors;
-    QList<QPair<QString, bool>> deleted;
-    bool success = FileSystem::removeRecursively(
-        absolute,
-        [&deleted](const QString &path, bool isDir) {
-            // by prepending, a folder deletion may be followed by content deletions
-            deleted.prepend(qMakePair(path, isDir));
-        },
-        &errors);
-
-    if (!success) {
-        // We need to delete the entries from the database now from the deleted vector.
-        // Do it while avoiding redundant delete calls to the journal.
-        QString deletedDir;
-        foreach (const auto &it, deleted) {
-            if (!it.first.startsWith(propagator()->localPath()))
-                continue;
-            if (!deletedDir.isEmpty() && it.first.startsWith(deletedDir))
-                continue;
-            if (it.second) {
-                deletedDir = it.first;
-            }
-            if (!propagator()->_journal->deleteFileRecord(it.first.mid(propagator()->localPath().size()), it.second)) {
-                qCWarning(lcPropagateLocalRemove) << "Failed to delete file record from local DB" << it.first.mid(propagator()->localPath().size());
-            }
+    RemoveResult result;
+    if (moveToTrash) {
+        if (QDir(filename).exists() || FileSystem::fileExists(filename)) {
+            result.success = FileSystem::moveToTrash(filename, &result.error);
         }
-
-        _error = errors.join(", ");
+    } else if (isDirectory) {
+        if (QDir(filename).exists()) {
+            QStringList errors;
+            result.success = FileSystem::removeRecursively(
+                filename,
+                [&result](const QString &path, bool isDir) {
+                    // by prepending, a folder deletion may be followed by content deletions
+                    result.deleted.prepend(qMakePair(path, isDir));
+                },
+                &errors);
+            result.error = errors.join(", ");
+        }
+    } else if (FileSystem::fileExists(filename)) {
+        result.success = FileSystem::remove(filename, &result.error);
     }
-    return success;
+    return result;
 }
 
 void PropagateLocalRemove::start()
@@ -106,27 +95,43 @@ void PropagateLocalRemove::start()
         return;
     }
 
-    QString removeError;
-    if (_moveToTrash) {
-        if ((QDir(filename).exists() || FileSystem::fileExists(filename))
-            && !FileSystem::moveToTrash(filename, &removeError)) {
-            done(SyncFileItem::NormalError, removeError);
-            return;
-        }
-    } else {
-        if (_item->isDirectory()) {
-            if (QDir(filename).exists() && !removeRecursively(QString())) {
-                done(SyncFileItem::NormalError, _error);
-                return;
+    const auto isDirectory = _item->isDirectory();
+    const auto moveToTrash = _moveToTrash;
+    propagator()->_activeJobList.append(this);
+    propagator()->localIoPool().run(
+        LocalIoPool::orderKeyForPath(filename), this,
+        [filename, isDirectory, moveToTrash] { return removeLocally(filename, isDirectory, moveToTrash); },
+        [this](const RemoveResult &result) { slotRemoved(result); });
+}
+
+void PropagateLocalRemove::slotRemoved(const RemoveResult &result)
+{
+    propagator()->_activeJobList.removeOne(this);
+    // The sync is being torn down, the next one picks up what was removed
+    if (propagator()->_abortRequested) {
+        return;
+    }
+
+    if (!result.success) {
+        // We need to delete the entries from the database now from the deleted vector.
+        // Do it while avoiding redundant delete calls to the journal.
+        QString deletedDir;
+        for (const auto &it : result.deleted) {
+            if (!it.first.startsWith(propagator()->localPath()))
+                continue;
+            if (!deletedDir.isEmpty() && it.first.startsWith(deletedDir))
+                continue;
+            if (it.second) {
+                deletedDir = it.first;
             }
-        } else {
-            if (FileSystem::fileExists(filename)
-                && !FileSystem::remove(filename, &removeError)) {
-                done(SyncFileItem::NormalError, removeError);
-                return;
+            if (!propagator()->_journal->deleteFileRecord(it.first.mid(propagator()->localPath().size()), it.second)) {
+                qCWarning(lcPropagateLocalRemove) << "Failed to delete file record from local DB" << it.first.mid(propagator()->localPath().size());
             }
         }
+        done(SyncFileItem::NormalError, result.error);
+        return;
     }
+
     propagator()->reportProgress(*_item, 0);
     if (!propagator()->_journal->deleteFileRecord(_item->_originalFile, _item->isDirectory())) {
         qCWarning(lcPropagateLocalRename) << "could not delete file from local DB" << _item->_originalFile;
@@ -158,21 +163,12 @@ void PropagateLocalMkdir::startLocalMkdir()
     // When turning something that used to be a file into a directory
     // we need to delete the file first.
     QFileInfo fi(newDirStr);
-    if (fi.exists() && fi.isFile()) {
-        if (_deleteExistingFile) {
-            QString removeError;
-            if (!FileSystem::remove(newDirStr, &removeError)) {
-                done(SyncFileItem::NormalError,
-                    tr("could not delete file %1, error: %2")
-                        .arg(newDirStr, removeError));
-                return;
-            }
-        } else if (_item->_instruction == CSYNC_INSTRUCTION_CONFLICT) {
-            QString error;
-            if (!propagator()->createConflict(_item, _associatedComposite, &error)) {
-                done(SyncFileItem::SoftError, error);
-                return;
-            }
+    const auto removeExistingFile = fi.exists() && fi.isFile() && _deleteExistingFile;
+    if (fi.exists() && fi.isFile() && !_deleteExistingFile && _item->_instruction == CSYNC_INSTRUCTION_CONFLICT) {
+        QString error;
+        if (!propagator()->createConflict(_item, _associatedComposite, &error)) {
+            done(SyncFileItem::SoftError, error);
+            return;
         }
     }
 
@@ -182,9 +178,35 @@ void PropagateLocalMkdir::startLocalMkdir()
         return;
     }
     emit propagator()->touchedFile(newDirStr);
-    QDir localDir(propagator()->localPath());
-    if (!localDir.mkpath(_item->_file)) {
-        done(SyncFileItem::NormalError, tr("Could not create folder %1").arg(newDirStr));
+
+    const auto localPath = propagator()->localPath();
+    const auto file = _item->_file;
+    propagator()->_activeJobList.append(this);
+    propagator()->localIoPool().run(
+        LocalIoPool::orderKeyForPath(newDir.path()), this,
+        [newDirStr, removeExistingFile, localPath, file] {
+            if (removeExistingFile) {
+                QString removeError;
+                if (!FileSystem::remove(newDirStr, &removeError)) {
+                    return tr("could not delete file %1, error: %2").arg(newDirStr, removeError);
+                }
+            }
+            if (!QDir(localPath).mkpath(file)) {
+                return tr("Could not create folder %1").arg(newDirStr);
+            }
+            return QString();
+        },
+        [this](const QString &error) { slotLocalDirCreated(error); });
+}
+
+void PropagateLocalMkdir::slotLocalDirCreated(const QString &error)
+{
+    propagator()->_activeJobList.removeOne(this);
+    if (propagator()->_abortRequested) {
+        return;
+    }
+    if (!error.isEmpty()) {
+        done(SyncFileItem::NormalError, error);
         return;
     }
 
@@ -241,29 +263,57 @@ void PropagateLocalRename::start()
 
         emit propagator()->touchedFile(existingFile);
         emit propagator()->touchedFile(targetFile);
-        QString renameError;
-        if (!FileSystem::rename(existingFile, targetFile, &renameError)) {
-            done(SyncFileItem::NormalError, renameError);
-            return;
-        }
+        propagator()->_activeJobList.append(this);
+        propagator()->localIoPool().run(
+            LocalIoPool::orderKeyForPath(targetFile), this,
+            [existingFile, targetFile] {
+                QString renameError;
+                if (!FileSystem::rename(existingFile, targetFile, &renameError) && renameError.isEmpty()) {
+                    renameError = tr("Failed to rename file");
+                }
+                return renameError;
+            },
+            [this](const QString &renameError) {
+                propagator()->_activeJobList.removeOne(this);
+                if (propagator()->_abortRequested) {
+                    return;
+                }
+                if (!renameError.isEmpty()) {
+                    done(SyncFileItem::NormalError, renameError);
+                    return;
+                }
+                slotRenamed();
+            });
+        return;
     }
 
+    slotRenamed();
+}
+
+void PropagateLocalRename::slotRenamed()
+{
     SyncJournalFileRecord oldRecord;
-    if (!propagator()->_journal->getFileRecord(_item->_originalFile, &oldRecord)) {
+    QString recordPath;
+    if (!propagator()->getRenamedItemRecord(*_item, &oldRecord, &recordPath)) {
         qCWarning(lcPropagateLocalRename) << "could not get file from local DB" << _item->_originalFile;
         done(SyncFileItem::NormalError, tr("could not get file %1 from local DB").arg(_item->_originalFile));
         return;
     }
-    if (!propagator()->_journal->deleteFileRecord(_item->_originalFile)) {
-        qCWarning(lcPropagateLocalRename) << "could not delete file from local DB" << _item->_originalFile;
-        done(SyncFileItem::NormalError, tr("Could not delete file record %1 from local DB").arg(_item->_originalFile));
+    if (propagator()->isRecordMovedWithParent(*_item, oldRecord, recordPath)) {
+        // The record was already moved along with the parent directory
+        done(SyncFileItem::Success);
+        return;
+    }
+    if (!propagator()->_journal->deleteFileRecord(recordPath)) {
+        qCWarning(lcPropagateLocalRename) << "could not delete file from local DB" << recordPath;
+        done(SyncFileItem::NormalError, tr("Could not delete file record %1 from local DB").arg(recordPath));
         return;
     }
 
     auto &vfs = propagator()->syncOptions()._vfs;
-    auto pinState = vfs->pinState(_item->_originalFile);
-    if (!vfs->setPinState(_item->_originalFile, PinState::Inherited)) {
-        qCWarning(lcPropagateLocalRename) << "Could not set pin state of" << _item->_originalFile << "to inherited";
+    auto pinState = vfs->pinState(recordPath);
+    if (!vfs->setPinState(recordPath, PinState::Inherited)) {
+        qCWarning(lcPropagateLocalRename) << "Could not set pin state of" << recordPath << "to inherited";
     }
 
     const auto oldFile = _item->_file;
@@ -283,7 +333,8 @@ void PropagateLocalRename::start()
         }
     } else {
         propagator()->_renamedDirectories.insert(oldFile, _item->_renameTarget);
-        if (!PropagateRemoteMove::adjustSelectiveSync(propagator()->_journal, oldFile, _item->_renameTarget)) {
+        if (!propagator()->moveRecordsBelowRenamedDirectory(*_item, recordPath)
+            || !PropagateRemoteMove::adjustSelectiveSync(propagator()->_journal, oldFile, _item->_renameTarget)) {
             done(SyncFileItem::FatalError, tr("Failed to rename file"));
             return;
         }
@@ -41,10 +41,19 @@ public:
     {
     }
     void start() override;
+    bool isLikelyFinishedQuickly() override { return !_item->isDirectory(); }
 
 private:
-    bool removeRecursively(const QString &path);
-    QString _error;
+    struct RemoveResult
+    {
+        bool success = true;
+        QString error;
+        // The entries a failed recursive removal deleted nonetheless, see removeLocally()
+        QList<QPair<QString, bool>> deleted;
+    };
+
+    static RemoveResult removeLocally(const QString &filename, bool isDirectory, bool moveToTrash);
+    void slotRemoved(const RemoveResult &result);
     bool _moveToTrash;
 };
 
@@ -71,8 +80,11 @@ public:
      */
     void setDeleteExistingFile(bool enabled);
 
+    bool isLikelyFinishedQuickly() override { return true; }
+
 private:
     void startLocalMkdir();
+    void slotLocalDirCreated(const QString &error);
     void startDemanglingName(const QString &parentPath);
 
     bool _deleteExistingFile;
@@ -92,5 +104,9 @@ public:
     }
     void start() override;
     JobParallelism parallelism() override { return _item->isDirectory() ? WaitForFinished : FullParallelism; }
+    bool isLikelyFinishedQuickly() override { return true; }
+
+private:
+    void slotRenamed();
 };
 }
@@ -30,6 +30,7 @@
 #include "configfile.h"
 #include "discovery.h"
 #include "common/vfs.h"
+#include "common/tracer.h"
 
 #ifdef Q_OS_WIN
 #include <windows.h>
@@ -117,6 +118,8 @@ SyncEngine::SyncEngine(AccountPtr account,
     _clearTouchedFilesTimer.setSingleShot(true);
     _clearTouchedFilesTimer.setInterval(30 * 1000);
     connect(&_clearTouchedFilesTimer, &QTimer::timeout, this, &SyncEngine::slotClearTouchedFiles);
+    _progressUpdateTimer.setSingleShot(true);
+    connect(&_progressUpdateTimer, &QTimer::timeout, this, &SyncEngine::slotPublishProgress);
     connect(this, &SyncEngine::finished, [this](bool /* finished */) {
         _journal->keyValueStoreSet("last_sync", QDateTime::currentSecsSinceEpoch());
     });
@@ -551,14 +554,16 @@ void SyncEngine::startSync()
     }
 
     _stopWatch.start();
+    _traceSyncStart = Tracer::instance()->isEnabled() ? Tracer::instance()->timestamp() : -1;
+    _tracePhaseStart = _traceSyncStart;
     _progressInfo->_status = ProgressInfo::Starting;
-    emit transmissionProgress(*_progressInfo);
+    slotPublishProgress();
 
     qCInfo(lcEngine) << "#### Discovery start ####################################################";
     qCInfo(lcEngine) << "Server" << account()->serverVersion()
                      << (account()->isHttp2Supported() ? "Using HTTP/2" : "");
     _progressInfo->_status = ProgressInfo::Discovery;
-    emit transmissionProgress(*_progressInfo);
+    slotPublishProgress();
 
     _discoveryPhase.reset(new DiscoveryPhase);
     _discoveryPhase->_leadingAndTrailingSpacesFilesAllowed = _leadingAndTrailingSpacesFilesAllowed;
@@ -613,9 +618,14 @@ void SyncEngine::startSync()
     connect(_discoveryPhase.data(), &DiscoveryPhase::silentlyExcluded,
         _syncFileStatusTracker.data(), &SyncFileStatusTracker::slotAddSilentlyExcluded);
 
+    const auto lastSyncTimestamp = _journal->keyValueStoreGetInt("last_sync", 0);
     auto discoveryJob = new ProcessDirectoryJob(
-        _discoveryPhase.data(), PinState::AlwaysLocal, _journal->keyValueStoreGetInt("last_sync", 0), _discoveryPhase.data());
+        _discoveryPhase.data(), PinState::AlwaysLocal, lastSyncTimestamp, _discoveryPhase.data());
     _discoveryPhase->startJob(discoveryJob);
+    // Without a previous sync every directory is new, the walk lists them anyway
+    if (_syncOptions._remoteChangeSearch && lastSyncTimestamp > 0) {
+        _discoveryPhase->startRemoteChangeSearch(lastSyncTimestamp);
+    }
     connect(discoveryJob, &ProcessDirectoryJob::etag, this, &SyncEngine::slotRootEtagReceived);
     connect(_discoveryPhase.data(), &DiscoveryPhase::addErrorToGui, this, &SyncEngine::addErrorToGui);
 }
@@ -636,7 +646,7 @@ void SyncEngine::slotFolderDiscovered(bool local, const QString &folder)
         _progressInfo->_currentDiscoveredRemoteFolder = folder;
         _progressInfo->_currentDiscoveredLocalFolder.clear();
     }
-    emit transmissionProgress(*_progressInfo);
+    slotPublishProgress();
 }
 
 void SyncEngine::slotRootEtagReceived(const QByteArray &e, const QDateTime &time)
@@ -661,6 +671,14 @@ void SyncEngine::slotDiscoveryFinished()
     }
 
     qCInfo(lcEngine) << "#### Discovery end #################################################### " << _stopWatch.addLapTime(QLatin1String("Discovery Finished")) << "ms";
+    traceSyncPhase(QStringLiteral("discovery"));
+    if (_discoveryPhase->_localPlaceholderCount > 0 || _discoveryPhase->_skippedPlaceholderProbeCount > 0) {
+        qCInfo(lcEngine) << "Local placeholders:" << _discoveryPhase->_localPlaceholderCount
+                         << "placeholder probes skipped for unchanged files:" << _discoveryPhase->_skippedPlaceholderProbeCount;
+    }
+    if (_discoveryPhase->_usedPrefetchedListingCount > 0) {
+        qCInfo(lcEngine) << "Directory listings prefetched by the remote change search:" << _discoveryPhase->_usedPrefetchedListingCount;
+    }
 
     // Sanity check
     if (!_journal->open()) {
@@ -676,7 +694,7 @@ void SyncEngine::slotDiscoveryFinished()
     _progressInfo->_currentDiscoveredRemoteFolder.clear();
     _progressInfo->_currentDiscoveredLocalFolder.clear();
     _progressInfo->_status = ProgressInfo::Reconcile;
-    emit transmissionProgress(*_progressInfo);
+    slotPublishProgress();
 
     //    qCInfo(lcEngine) << "Permissions of the root folder: " << _csync_ctx->remote.root_perms.toString();
     auto finish = [this]{
@@ -706,7 +724,7 @@ void SyncEngine::slotDiscoveryFinished()
 
         // it's important to do this before ProgressInfo::start(), to announce start of new sync
         _progressInfo->_status = ProgressInfo::Propagation;
-        emit transmissionProgress(*_progressInfo);
+        slotPublishProgress();
         _progressInfo->startEstimateUpdates();
 
         // post update phase script: allow to tweak stuff by a custom script in debug mode.
@@ -731,6 +749,7 @@ void SyncEngine::slotDiscoveryFinished()
         _propagator = QSharedPointer<OwncloudPropagator>(
             new OwncloudPropagator(_account, _localPath, _remotePath, _journal, _bulkUploadBlackList));
         _propagator->setSyncOptions(_syncOptions);
+        _propagator->setPriorityPaths(std::move(_priorityPaths));
         connect(_propagator.data(), &OwncloudPropagator::itemCompleted,
             this, &SyncEngine::slotItemCompleted);
         connect(_propagator.data(), &OwncloudPropagator::progress,
@@ -757,6 +776,7 @@ void SyncEngine::slotDiscoveryFinished()
         _propagator->start(std::move(_syncItems));
 
         qCInfo(lcEngine) << "#### Post-Reconcile end #################################################### " << _stopWatch.addLapTime(QStringLiteral("Post-Reconcile Finished")) << "ms";
+        traceSyncPhase(QStringLiteral("reconcile"));
     };
 
     if (!_hasNoneFiles && _hasRemoveFile) {
@@ -817,12 +837,14 @@ void SyncEngine::slotItemCompleted(const SyncFileItemPtr &item)
 {
     _progressInfo->setProgressComplete(*item);
 
-    emit transmissionProgress(*_progressInfo);
+    slotPublishProgress();
     emit itemCompleted(item);
 }
 
 void SyncEngine::slotPropagationFinished(bool success)
 {
+    traceSyncPhase(QStringLiteral("propagation"));
+
     if (_propagator->_anotherSyncNeeded && _anotherSyncNeeded == NoFollowUpSync) {
         _anotherSyncNeeded = ImmediateFollowUp;
     }
@@ -841,16 +863,32 @@ void SyncEngine::slotPropagationFinished(bool success)
     // so we don't count this twice (like Recent Files)
     _progressInfo->_lastCompletedItem = SyncFileItem();
     _progressInfo->_status = ProgressInfo::Done;
-    emit transmissionProgress(*_progressInfo);
+    slotPublishProgress();
 
     finalize(success);
 }
 
+void SyncEngine::traceSyncPhase(const QString &name)
+{
+    if (_tracePhaseStart < 0)
+        return;
+    const auto tracer = Tracer::instance();
+    tracer->asyncSpan("sync", name, reinterpret_cast<quintptr>(this), _tracePhaseStart);
+    _tracePhaseStart = tracer->timestamp();
+}
+
 void SyncEngine::finalize(bool success)
 {
     qCInfo(lcEngine) << "Sync run took " << _stopWatch.addLapTime(QLatin1String("Sync Finished")) << "ms";
     _stopWatch.stop();
 
+    if (_traceSyncStart >= 0) {
+        Tracer::instance()->asyncSpan("sync", QStringLiteral("sync"), reinterpret_cast<quintptr>(this), _traceSyncStart,
+            { { QStringLiteral("success"), success } });
+        Tracer::instance()->flush();
+        _traceSyncStart = _tracePhaseStart = -1;
+    }
+
     if (_discoveryPhase) {
         _discoveryPhase.take()->deleteLater();
     }
@@ -863,6 +901,7 @@ void SyncEngine::finalize(bool success)
     _seenConflictFiles.clear();
     _uniqueErrors.clear();
     _localDiscoveryPaths.clear();
+    _priorityPaths.clear();
     _localDiscoveryStyle = LocalDiscoveryStyle::FilesystemOnly;
 
     _clearTouchedFilesTimer.start();
@@ -872,6 +911,22 @@ void SyncEngine::finalize(bool success)
 void SyncEngine::slotProgress(const SyncFileItem &item, qint64 current)
 {
     _progressInfo->setProgressItem(item, current);
+
+    // Transfers report progress for every block, only publish it at the configured rate
+    const auto interval = _syncOptions._progressUpdateInterval;
+    if (interval.count() <= 0) {
+        slotPublishProgress();
+        return;
+    }
+    if (!_progressUpdateTimer.isActive()) {
+        _progressUpdateTimer.start(interval);
+    }
+}
+
+void SyncEngine::slotPublishProgress()
+{
+    // Any pending coalesced update is part of this one
+    _progressUpdateTimer.stop();
     emit transmissionProgress(*_progressInfo);
 }
 
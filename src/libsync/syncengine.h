@@ -118,6 +118,15 @@ public:
      */
     void setLocalDiscoveryOptions(LocalDiscoveryStyle style, std::set<QString> paths = {});
 
+    /**
+     * Paths the user is waiting for, relative to the synced folder.
+     *
+     * Items at or below these paths are propagated before other items, see
+     * OwncloudPropagator::setPriorityPaths(). Like the local discovery
+     * options, they are only retained for the next sync.
+     */
+    void setPriorityPaths(std::set<QString> paths) { _priorityPaths = std::move(paths); }
+
     /**
      * Returns whether the given folder-relative path should be locally discovered
      * given the local discovery options.
@@ -199,6 +208,8 @@ private slots:
     void slotDiscoveryFinished();
     void slotPropagationFinished(bool success);
     void slotProgress(const SyncFileItem &item, qint64 curent);
+    /** Emits transmissionProgress() with the current state */
+    void slotPublishProgress();
     void slotCleanPollsJobAborted(const QString &error);
 
     /** Records that a file was touched by a job. */
@@ -258,6 +269,11 @@ private:
     QScopedPointer<SyncFileStatusTracker> _syncFileStatusTracker;
     Utility::StopWatch _stopWatch;
 
+    // Tracer timestamps of the sync run and the current phase, -1 when not tracing
+    qint64 _traceSyncStart = -1;
+    qint64 _tracePhaseStart = -1;
+    void traceSyncPhase(const QString &name);
+
     /**
      * check if we are allowed to propagate everything, and if we are not, adjust the instructions
      * to recover
@@ -294,6 +310,9 @@ private:
     /** For clearing the _touchedFiles variable after sync finished */
     QTimer _clearTouchedFilesTimer;
 
+    /** Coalesces transfer progress updates, see SyncOptions::_progressUpdateInterval */
+    QTimer _progressUpdateTimer;
+
     /** List of unique errors that occurred in a sync run. */
     QSet<QString> _uniqueErrors;
 
@@ -301,6 +320,7 @@ private:
     LocalDiscoveryStyle _lastLocalDiscoveryStyle = LocalDiscoveryStyle::FilesystemOnly;
     LocalDiscoveryStyle _localDiscoveryStyle = LocalDiscoveryStyle::FilesystemOnly;
     std::set<QString> _localDiscoveryPaths;
+    std::set<QString> _priorityPaths;
 
     QStringList _leadingAndTrailingSpacesFilesAllowed;
 };
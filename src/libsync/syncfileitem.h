@@ -20,6 +20,7 @@
 #include <QDateTime>
 #include <QMetaType>
 #include <QSharedPointer>
+#include <QSharedDataPointer>
 
 #include <csync.h>
 
@@ -298,16 +299,31 @@ public:
     qint64 _previousSize = 0;
     time_t _previousModtime = 0;
 
-    QString _directDownloadUrl;
-    QString _directDownloadCookies;
+    /** Details only few items carry: a direct download url or a server side lock
+     *
+     * They live out of line so that the items of a large sync don't each pay for
+     * seven empty members. Read them with extra() and change them with extraForUpdate(),
+     * which allocates them on first use.
+     */
+    struct ExtraFields : public QSharedData
+    {
+        QString _directDownloadUrl;
+        QString _directDownloadCookies;
+
+        LockStatus _locked = LockStatus::UnlockedItem;
+        QString _lockOwnerId;
+        QString _lockOwnerDisplayName;
+        LockOwnerType _lockOwnerType = LockOwnerType::UserLock;
+        QString _lockEditorApp;
+        qint64 _lockTime = 0;
+        qint64 _lockTimeout = 0;
+    };
+
+    const ExtraFields &extra() const;
+    ExtraFields &extraForUpdate();
 
-    LockStatus _locked = LockStatus::UnlockedItem;
-    QString _lockOwnerId;
-    QString _lockOwnerDisplayName;
-    LockOwnerType _lockOwnerType = LockOwnerType::UserLock;
-    QString _lockEditorApp;
-    qint64 _lockTime = 0;
-    qint64 _lockTimeout = 0;
+private:
+    QSharedDataPointer<ExtraFields> _extra;
 };
 
 inline bool operator<(const SyncFileItemPtr &item1, const SyncFileItemPtr &item2)
@@ -47,6 +47,22 @@ void SyncOptions::fillFromEnvironmentVariables()
     int maxParallel = qgetenv("OWNCLOUD_MAX_PARALLEL").toInt();
     if (maxParallel > 0)
         _parallelNetworkJobs = maxParallel;
+
+    QByteArray minServerSideCopySizeEnv = qgetenv("OWNCLOUD_MIN_SERVER_SIDE_COPY_SIZE");
+    if (!minServerSideCopySizeEnv.isEmpty())
+        _minServerSideCopySize = minServerSideCopySizeEnv.toLongLong();
+
+    QByteArray progressUpdateIntervalEnv = qgetenv("OWNCLOUD_PROGRESS_UPDATE_INTERVAL");
+    if (!progressUpdateIntervalEnv.isEmpty())
+        _progressUpdateInterval = std::chrono::milliseconds(progressUpdateIntervalEnv.toUInt());
+
+    QByteArray bulkUploadBatchSizeEnv = qgetenv("OWNCLOUD_BULK_UPLOAD_BATCH_SIZE");
+    if (!bulkUploadBatchSizeEnv.isEmpty())
+        _bulkUploadBatchSize = bulkUploadBatchSizeEnv.toInt();
+
+    QByteArray remoteChangeSearchEnv = qgetenv("OWNCLOUD_REMOTE_CHANGE_SEARCH");
+    if (!remoteChangeSearchEnv.isEmpty())
+        _remoteChangeSearch = remoteChangeSearchEnv != "0";
 }
 
 void SyncOptions::verifyChunkSizes()
@@ -72,10 +72,42 @@ public:
     /** The maximum number of active jobs in parallel  */
     int _parallelNetworkJobs = 6;
 
+    /** The minimum time between two transmissionProgress() signals caused by
+     * transfer progress.
+     *
+     * Status changes and completed items are always published right away and
+     * include any pending transfer progress. Set to 0 to publish every update.
+     */
+    std::chrono::milliseconds _progressUpdateInterval = std::chrono::milliseconds(0);
+
+    /** The minimum size in bytes of a new file for which a server side copy
+     * of an already synced file with the same content is attempted instead
+     * of an upload.
+     *
+     * -1 disables server side copies.
+     */
+    qint64 _minServerSideCopySize = -1;
+
+    /** The maximum number of files sent in one bulk upload request.
+     *
+     * Set to 0 it will disable bulk upload even if the server supports it.
+     */
+    int _bulkUploadBatchSize = 100;
+
+    /** Whether remote discovery first asks the server, with a WebDAV SEARCH,
+     * for the items modified since the last sync.
+     *
+     * The listings of the directories found are then requested up front
+     * instead of one directory level at a time. Servers without SEARCH
+     * support fall back to the plain etag walk.
+     */
+    bool _remoteChangeSearch = false;
+
     /** Reads settings from env vars where available.
      *
      * Currently reads _initialChunkSize, _minChunkSize, _maxChunkSize,
-     * _targetChunkUploadDuration, _parallelNetworkJobs.
+     * _targetChunkUploadDuration, _parallelNetworkJobs, _minServerSideCopySize,
+     * _progressUpdateInterval, _bulkUploadBatchSize, _remoteChangeSearch.
      */
     void fillFromEnvironmentVariables();
 
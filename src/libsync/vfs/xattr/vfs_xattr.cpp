@@ -19,6 +19,7 @@
 #include "syncfileitem.h"
 #include "filesystem.h"
 #include "common/syncjournaldb.h"
+#include "csync/vio/csync_vio_local.h"
 
 #include "xattrwrapper.h"
 
@@ -144,19 +145,23 @@ bool VfsXAttr::statTypeVirtualFile(csync_file_stat_t *stat, void *statData)
         return false;
     }
 
-    const auto parentPath = static_cast<QByteArray *>(statData);
-    Q_ASSERT(!parentPath->endsWith('/'));
+    const auto data = static_cast<csync_vio_local_unix_stat_data_t *>(statData);
+    Q_ASSERT(!data->parentPath->endsWith('/'));
     Q_ASSERT(!stat->path.startsWith('/'));
 
-    const auto path = QByteArray(*parentPath + '/' + stat->path);
     const auto pin = [=] {
-        const auto absolutePath = QString::fromUtf8(path);
+        const auto absolutePath = QString::fromUtf8(*data->fullPath);
         Q_ASSERT(absolutePath.startsWith(params().filesystemPath.toUtf8()));
         const auto folderPath = absolutePath.mid(params().filesystemPath.length());
         return pinState(folderPath);
     }();
 
-    if (xattr::hasNextcloudPlaceholderAttributes(path)) {
+    // A file that is unchanged since it was synced hydrated can't have
+    // become a placeholder, no need to ask the filesystem
+    const auto isPlaceholder = !data->matchesKnownFile
+        && xattr::hasNextcloudPlaceholderAttributes(*data->fullPath);
+
+    if (isPlaceholder) {
         const auto shouldDownload = pin && (*pin == PinState::AlwaysLocal);
         stat->type = shouldDownload ? ItemTypeVirtualFileDownload : ItemTypeVirtualFile;
         return true;
@@ -26,6 +26,8 @@ namespace XAttrWrapper
 {
 
 OWNCLOUDSYNC_EXPORT bool hasNextcloudPlaceholderAttributes(const QString &path);
+/// Same as above for an already encoded path, doesn't follow symlinks
+OWNCLOUDSYNC_EXPORT bool hasNextcloudPlaceholderAttributes(const QByteArray &encodedPath);
 OWNCLOUDSYNC_EXPORT Result<void, QString> addNextcloudPlaceholderAttributes(const QString &path);
 
 }
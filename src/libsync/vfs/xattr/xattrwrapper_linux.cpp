@@ -25,12 +25,16 @@ Q_LOGGING_CATEGORY(lcXAttrWrapper, "nextcloud.sync.vfs.xattr.wrapper", QtInfoMsg
 namespace {
 constexpr auto hydrateExecAttributeName = "user.nextcloud.hydrate_exec";
 
-OCC::Optional<QByteArray> xattrGet(const QByteArray &path, const QByteArray &name)
+enum class FollowSymlinks { Yes, No };
+
+OCC::Optional<QByteArray> xattrGet(const QByteArray &path, const QByteArray &name, FollowSymlinks follow = FollowSymlinks::Yes)
 {
     constexpr auto bufferSize = 256;
     QByteArray result;
     result.resize(bufferSize);
-    const auto count = getxattr(path.constData(), name.constData(), result.data(), bufferSize);
+    const auto count = follow == FollowSymlinks::Yes
+        ? getxattr(path.constData(), name.constData(), result.data(), bufferSize)
+        : lgetxattr(path.constData(), name.constData(), result.data(), bufferSize);
     if (count >= 0) {
         result.resize(static_cast<int>(count) - 1);
         return result;
@@ -58,6 +62,12 @@ bool OCC::XAttrWrapper::hasNextcloudPlaceholderAttributes(const QString &path)
     }
 }
 
+bool OCC::XAttrWrapper::hasNextcloudPlaceholderAttributes(const QByteArray &encodedPath)
+{
+    const auto value = xattrGet(encodedPath, hydrateExecAttributeName, FollowSymlinks::No);
+    return value && *value == QByteArrayLiteral(APPLICATION_EXECUTABLE);
+}
+
 OCC::Result<void, QString> OCC::XAttrWrapper::addNextcloudPlaceholderAttributes(const QString &path)
 {
     const auto success = xattrSet(path.toUtf8(), hydrateExecAttributeName, APPLICATION_EXECUTABLE);
@@ -0,0 +1,102 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+/*
+ * Compares moving the journal records below a renamed directory one by one,
+ * as the propagator used to do, with SyncJournalDb::moveFileRecordsBelowPath().
+ *
+ * Usage: JournalRenameBench [number of records]
+ */
+
+#include "common/ownsql.h"
+#include "common/syncjournaldb.h"
+#include "common/syncjournalfilerecord.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QDebug>
+
+using namespace OCC;
+
+namespace {
+
+void fillJournal(SyncJournalDb &journal, const QByteArray &root, int records)
+{
+    SyncJournalFileRecord dir;
+    dir._path = root;
+    dir._type = ItemTypeDirectory;
+    dir._remotePerm = RemotePermissions::fromDbValue("RW");
+    (void)journal.setFileRecord(dir);
+
+    constexpr int filesPerDir = 100;
+    for (int i = 0; i < records; ++i) {
+        SyncJournalFileRecord record;
+        const auto subDir = root + "/dir" + QByteArray::number(i / filesPerDir);
+        if (i % filesPerDir == 0) {
+            record._path = subDir;
+            record._type = ItemTypeDirectory;
+        } else {
+            record._path = subDir + "/file" + QByteArray::number(i);
+            record._type = ItemTypeFile;
+            record._fileSize = i;
+        }
+        record._fileId = QByteArray::number(i);
+        record._etag = "etag";
+        record._remotePerm = RemotePermissions::fromDbValue("RW");
+        (void)journal.setFileRecord(record);
+    }
+    journal.commit(QStringLiteral("fill"));
+}
+
+void report(const char *name, qint64 elapsed, quint64 statements)
+{
+    qInfo() << name << "ms:" << elapsed << "statements:" << statements;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    const auto records = argc > 1 ? QByteArray(argv[1]).toInt() : 100000;
+
+    QTemporaryDir tmp;
+    SyncJournalDb journal(tmp.filePath(QStringLiteral("sync.db")));
+    qInfo() << "RECORDS" << records;
+
+    fillJournal(journal, "perRecord", records);
+    {
+        QElapsedTimer timer;
+        timer.start();
+        const auto statementsBefore = SqlQuery::executedCount();
+        QVector<SyncJournalFileRecord> below;
+        (void)journal.getFilesBelowPath("perRecord", [&](const SyncJournalFileRecord &record) { below.append(record); });
+        for (auto record : qAsConst(below)) {
+            (void)journal.deleteFileRecord(QString::fromUtf8(record._path));
+            record._path.replace(0, qstrlen("perRecord"), "perRecordRenamed");
+            (void)journal.setFileRecord(record);
+        }
+        journal.commit(QStringLiteral("perRecord"));
+        report("PER_RECORD", timer.elapsed(), SqlQuery::executedCount() - statementsBefore);
+    }
+
+    fillJournal(journal, "setBased", records);
+    {
+        QElapsedTimer timer;
+        timer.start();
+        const auto statementsBefore = SqlQuery::executedCount();
+        if (!journal.moveFileRecordsBelowPath("setBased", "setBasedRenamed")) {
+            qWarning() << "moveFileRecordsBelowPath failed";
+            return -1;
+        }
+        journal.commit(QStringLiteral("setBased"));
+        report("SET_BASED", timer.elapsed(), SqlQuery::executedCount() - statementsBefore);
+    }
+
+    return 0;
+}
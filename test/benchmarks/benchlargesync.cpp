@@ -5,45 +5,41 @@
  *
  */
 
+/*
+ * Syncs a large generated tree twice and reports the time of both syncs and
+ * how far the resident set size grew during each.
+ *
+ * Usage: LargeSyncBench [files per dir] [dirs per dir] [depth]
+ */
+
+#include "benchmarkutils.h"
 #include "syncenginetestutils.h"
 #include <syncengine.h>
 
-using namespace OCC;
+#include <memory>
 
-int numDirs = 0;
-int numFiles = 0;
-
-template<int filesPerDir, int dirPerDir, int maxDepth>
-void addBunchOfFiles(int depth, const QString &path, FileModifier &fi) {
-    for (int fileNum = 1; fileNum <= filesPerDir; ++fileNum) {
-        QString name = QStringLiteral("file") + QString::number(fileNum);
-        fi.insert(path.isEmpty() ? name : path + "/" + name);
-        numFiles++;
-    }
-    if (depth >= maxDepth)
-        return;
-    for (int dirNum = 1; dirNum <= dirPerDir; ++dirNum) {
-        QString name = QStringLiteral("dir") + QString::number(dirNum);
-        QString subPath = path.isEmpty() ? name : path + "/" + name;
-        fi.mkdir(subPath);
-        numDirs++;
-        addBunchOfFiles<filesPerDir, dirPerDir, maxDepth>(depth + 1, subPath, fi);
-    }
-}
+using namespace OCC;
+using namespace OCC::BenchmarkUtils;
 
 int main(int argc, char *argv[])
 {
     QCoreApplication app(argc, argv);
+    const auto filesPerDir = argc > 1 ? QByteArray(argv[1]).toInt() : 10;
+    const auto dirPerDir = argc > 2 ? QByteArray(argv[2]).toInt() : 8;
+    const auto maxDepth = argc > 3 ? QByteArray(argv[3]).toInt() : 4;
+
     FakeFolder fakeFolder{FileInfo::A12_B12_C12_S12()};
-    addBunchOfFiles<10, 8, 4>(0, "", fakeFolder.localModifier());
+    const auto numFiles = addBunchOfFiles(fakeFolder.localModifier(), QString(), 0, filesPerDir, dirPerDir, maxDepth);
 
     qDebug() << "NUMFILES" << numFiles;
-    qDebug() << "NUMDIRS" << numDirs;
+    qDebug() << "SIZEOF SYNCFILEITEM" << sizeof(SyncFileItem);
     QElapsedTimer timer;
     timer.start();
+    auto rss = std::make_unique<RssGrowthTracker>();
     bool result1 = fakeFolder.syncOnce();
-    qDebug() << "FIRST SYNC: " << result1 << timer.restart();
+    qDebug() << "FIRST SYNC: " << result1 << timer.restart() << "RSS GROWTH KB:" << rss->peakGrowthKb();
+    rss = std::make_unique<RssGrowthTracker>();
     bool result2 = fakeFolder.syncOnce();
-    qDebug() << "SECOND SYNC: " << result2 << timer.restart();
+    qDebug() << "SECOND SYNC: " << result2 << timer.restart() << "RSS GROWTH KB:" << rss->peakGrowthKb();
     return (result1 && result2) ? 0 : -1;
 }
@@ -0,0 +1,102 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#pragma once
+
+#include "syncenginetestutils.h"
+
+#include <QFile>
+#include <QTimer>
+
+#include <algorithm>
+
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
+
+namespace OCC {
+namespace BenchmarkUtils {
+
+    /// The current resident set size of the process in KiB, -1 where unknown
+    inline qint64 currentRssKb()
+    {
+#ifdef Q_OS_LINUX
+        QFile statm(QStringLiteral("/proc/self/statm"));
+        if (!statm.open(QIODevice::ReadOnly)) {
+            return -1;
+        }
+        // Total program size, then the resident pages
+        const auto fields = statm.readAll().split(' ');
+        if (fields.size() < 2) {
+            return -1;
+        }
+        return fields.at(1).toLongLong() * sysconf(_SC_PAGESIZE) / 1024;
+#else
+        return -1;
+#endif
+    }
+
+    /** Tracks how far the resident set size grows above what it was when the
+     * tracker was created.
+     *
+     * The process wide peak never goes down, so it can't tell scenarios that
+     * run one after the other apart. This samples the current size instead,
+     * on the event loop, which the syncs spend most of their time in.
+     */
+    class RssGrowthTracker
+    {
+    public:
+        RssGrowthTracker()
+            : _baselineKb(currentRssKb())
+            , _peakKb(_baselineKb)
+        {
+            QObject::connect(&_timer, &QTimer::timeout, [this] { sample(); });
+            _timer.start(10);
+        }
+
+        /// The largest growth seen so far in KiB, -1 where unknown
+        qint64 peakGrowthKb()
+        {
+            sample();
+            return _baselineKb < 0 ? -1 : _peakKb - _baselineKb;
+        }
+
+    private:
+        void sample() { _peakKb = std::max(_peakKb, currentRssKb()); }
+
+        qint64 _baselineKb;
+        qint64 _peakKb;
+        QTimer _timer;
+    };
+
+    /** Adds filesPerDir files of size bytes to path and, up to maxDepth
+     * levels below it, dirsPerDir directories filled the same way.
+     *
+     * Returns the number of files added.
+     */
+    inline int addBunchOfFiles(FileModifier &fi, const QString &path, int depth, int filesPerDir, int dirsPerDir, int maxDepth, qint64 size = 64)
+    {
+        int count = 0;
+        for (int fileNum = 1; fileNum <= filesPerDir; ++fileNum) {
+            const auto name = QStringLiteral("file") + QString::number(fileNum);
+            fi.insert(path.isEmpty() ? name : path + QLatin1Char('/') + name, size);
+            ++count;
+        }
+        if (depth >= maxDepth) {
+            return count;
+        }
+        for (int dirNum = 1; dirNum <= dirsPerDir; ++dirNum) {
+            const auto name = QStringLiteral("dir") + QString::number(dirNum);
+            const auto subPath = path.isEmpty() ? name : path + QLatin1Char('/') + name;
+            fi.mkdir(subPath);
+            count += addBunchOfFiles(fi, subPath, depth + 1, filesPerDir, dirsPerDir, maxDepth, size);
+        }
+        return count;
+    }
+
+}
+}
@@ -0,0 +1,60 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+/*
+ * Measures the scheduling overhead of OwncloudPropagator for one directory
+ * holding many items. The items are ignored, so their jobs complete without
+ * touching the network or the file system and only the scheduler is measured.
+ *
+ * Usage: PropagatorSchedulerBench [number of items]
+ */
+
+#include "syncenginetestutils.h"
+#include <owncloudpropagator.h>
+
+using namespace OCC;
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    const auto itemCount = argc > 1 ? QByteArray(argv[1]).toInt() : 200000;
+
+    FakeFolder fakeFolder{ FileInfo{} };
+    QSet<QString> bulkUploadBlackList;
+    OwncloudPropagator propagator(fakeFolder.account(), fakeFolder.localPath(), QStringLiteral("/"),
+        &fakeFolder.syncJournal(), bulkUploadBlackList);
+    propagator.setSyncOptions(fakeFolder.syncEngine().syncOptions());
+
+    SyncFileItemVector items;
+    items.reserve(itemCount + 1);
+    auto dir = SyncFileItemPtr::create();
+    dir->_file = QStringLiteral("big");
+    dir->_type = ItemTypeDirectory;
+    dir->_instruction = CSYNC_INSTRUCTION_NONE;
+    items.append(dir);
+    for (int i = 0; i < itemCount; ++i) {
+        auto item = SyncFileItemPtr::create();
+        item->_file = QStringLiteral("big/file%1").arg(i, 6, 10, QLatin1Char('0'));
+        item->_type = ItemTypeFile;
+        item->_instruction = CSYNC_INSTRUCTION_IGNORE;
+        items.append(item);
+    }
+
+    int completed = 0;
+    QObject::connect(&propagator, &OwncloudPropagator::itemCompleted, [&] { ++completed; });
+    QObject::connect(&propagator, &OwncloudPropagator::finished, &app, &QCoreApplication::quit, Qt::QueuedConnection);
+
+    QElapsedTimer timer;
+    timer.start();
+    propagator.start(std::move(items));
+    app.exec();
+    const auto elapsed = timer.elapsed();
+
+    qInfo() << "ITEMS" << completed << "ms:" << elapsed
+            << "us per item:" << (completed ? elapsed * 1000.0 / completed : 0.0);
+    return completed == itemCount ? 0 : -1;
+}
@@ -0,0 +1,138 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+/*
+ * Measures how many RETRIEVE_FILE_STATUS round-trips the socket API answers
+ * per second over its local socket, once waiting for every reply and once
+ * with the requests pipelined the way file manager extensions send them.
+ *
+ * Usage: SocketApiBench [number of requests]
+ */
+
+#include "account.h"
+#include "accountstate.h"
+#include "configfile.h"
+#include "folderman.h"
+#include "theme.h"
+#include "testhelper.h"
+
+#include <QApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QLocalSocket>
+#include <QTemporaryDir>
+#include <QDebug>
+
+using namespace OCC;
+
+namespace {
+
+int readStatusReplies(QLocalSocket &socket)
+{
+    int replies = 0;
+    while (socket.canReadLine()) {
+        if (socket.readLine().startsWith("STATUS:")) {
+            ++replies;
+        }
+    }
+    return replies;
+}
+
+bool waitForReplies(QLocalSocket &socket, int expected)
+{
+    QElapsedTimer timeout;
+    timeout.start();
+    int replies = 0;
+    while (replies < expected) {
+        if (timeout.elapsed() > 60000) {
+            return false;
+        }
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents, 100);
+        replies += readStatusReplies(socket);
+    }
+    return true;
+}
+
+void report(const char *name, int requests, qint64 elapsed)
+{
+    qInfo() << name << "requests:" << requests << "ms:" << elapsed
+            << "round-trips per second:" << (elapsed ? requests * 1000.0 / elapsed : 0.0);
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+    const auto requests = argc > 1 ? QByteArray(argv[1]).toInt() : 20000;
+
+    QTemporaryDir dir;
+    ConfigFile::setConfDir(dir.path()); // we don't want to pollute the user's config file
+    // Nor take over the socket of a client that is running for the user
+    QTemporaryDir runtimeDir;
+    qputenv("XDG_RUNTIME_DIR", QFile::encodeName(runtimeDir.path()));
+    const auto socketPath = runtimeDir.path() + QLatin1Char('/') + Theme::instance()->appName() + QStringLiteral("/socket");
+    QDir(dir.path()).mkpath(QStringLiteral("sync"));
+    const auto syncPath = QDir(dir.path()).canonicalPath() + QStringLiteral("/sync");
+    constexpr int fileCount = 100;
+    for (int i = 0; i < fileCount; ++i) {
+        QFile f(syncPath + QStringLiteral("/file%1.txt").arg(i));
+        f.open(QFile::WriteOnly);
+        f.write("hello");
+    }
+
+    FolderMan folderman;
+    auto account = Account::create();
+    account->setCredentials(new HttpCredentialsTest(QStringLiteral("testuser"), QStringLiteral("secret")));
+    account->setUrl(QUrl(QStringLiteral("http://example.de")));
+    AccountStatePtr accountState(new AccountState(account));
+    if (!folderman.addFolder(accountState.data(), folderDefinition(syncPath))) {
+        qWarning() << "could not add the sync folder";
+        return -1;
+    }
+
+    QLocalSocket socket;
+    socket.connectToServer(socketPath);
+    if (!socket.waitForConnected(5000)) {
+        qWarning() << "could not connect to the socket api" << socket.errorString();
+        return -1;
+    }
+
+    const auto request = [&](int i) {
+        return QByteArrayLiteral("RETRIEVE_FILE_STATUS:") + syncPath.toUtf8() + "/file" + QByteArray::number(i % fileCount) + ".txt\n";
+    };
+
+    {
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < requests; ++i) {
+            socket.write(request(i));
+            if (!waitForReplies(socket, 1)) {
+                qWarning() << "timed out waiting for a reply";
+                return -1;
+            }
+        }
+        report("SEQUENTIAL", requests, timer.elapsed());
+    }
+
+    {
+        QElapsedTimer timer;
+        timer.start();
+        QByteArray batch;
+        for (int i = 0; i < requests; ++i) {
+            batch += request(i);
+        }
+        socket.write(batch);
+        if (!waitForReplies(socket, requests)) {
+            qWarning() << "timed out waiting for the replies";
+            return -1;
+        }
+        report("PIPELINED", requests, timer.elapsed());
+    }
+
+    return 0;
+}
@@ -0,0 +1,271 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+/*
+ * Runs a set of typical sync scenarios against FakeFolder and writes one JSON
+ * object per scenario with wall time, requests issued, SQL statements executed
+ * and how far the resident set size grew during the run.
+ *
+ * Usage: SyncScenariosBench [--latency ms] [--bandwidth bytes/s] [--scenario name]... [--output file]
+ *
+ * Scenarios that build on the state another one leaves behind, like
+ * noopResync after firstSync, set it up unmeasured when run on their own.
+ */
+
+#include "benchmarkutils.h"
+#include "syncenginetestutils.h"
+#include "common/ownsql.h"
+#include "common/vfs.h"
+#include <syncengine.h>
+
+#include <QCommandLineParser>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <algorithm>
+#include <functional>
+
+using namespace OCC;
+using namespace OCC::BenchmarkUtils;
+
+namespace {
+
+struct NetworkModel
+{
+    quint64 latencyMs = 0;
+    quint64 bytesPerSecond = 0;
+};
+
+/// Whether the scenario with the given name was selected
+using ScenarioFilter = std::function<bool(const QString &)>;
+
+/// Measures a single sync run of a FakeFolder
+class Scenario
+{
+public:
+    Scenario(const QString &name, FakeFolder &fakeFolder, const NetworkModel &model)
+        : _name(name)
+        , _fakeFolder(fakeFolder)
+    {
+        _fakeFolder.setNetworkModel(model.latencyMs, model.bytesPerSecond);
+        _fakeFolder.setServerOverride([this](QNetworkAccessManager::Operation, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            ++_requests;
+            const auto verb = request.attribute(QNetworkRequest::CustomVerbAttribute).toString();
+            ++_requestsByVerb[verb.isEmpty() ? QStringLiteral("other") : verb];
+            return nullptr;
+        });
+    }
+
+    ~Scenario()
+    {
+        _fakeFolder.setServerOverride({});
+    }
+
+    QJsonObject run(int items)
+    {
+        _requests = 0;
+        _requestsByVerb.clear();
+        const auto sqlBefore = SqlQuery::executedCount();
+
+        RssGrowthTracker rss;
+        QElapsedTimer timer;
+        timer.start();
+        const auto ok = _fakeFolder.syncOnce();
+        const auto elapsed = timer.elapsed();
+
+        QJsonObject verbs;
+        for (auto it = _requestsByVerb.cbegin(); it != _requestsByVerb.cend(); ++it) {
+            verbs.insert(it.key(), it.value());
+        }
+
+        QJsonObject result;
+        result.insert(QStringLiteral("scenario"), _name);
+        result.insert(QStringLiteral("success"), ok);
+        result.insert(QStringLiteral("items"), items);
+        result.insert(QStringLiteral("wallTimeMs"), elapsed);
+        result.insert(QStringLiteral("requests"), _requests);
+        result.insert(QStringLiteral("requestsByVerb"), verbs);
+        result.insert(QStringLiteral("sqlStatements"), static_cast<qint64>(SqlQuery::executedCount() - sqlBefore));
+        result.insert(QStringLiteral("rssGrowthKb"), rss.peakGrowthKb());
+        qInfo() << "SCENARIO" << _name << "ok:" << ok << "ms:" << elapsed << "requests:" << _requests;
+        return result;
+    }
+
+private:
+    QString _name;
+    FakeFolder &_fakeFolder;
+    int _requests = 0;
+    QMap<QString, int> _requestsByVerb;
+};
+
+void setChunking(FakeFolder &fakeFolder, qint64 chunkSize)
+{
+    fakeFolder.syncEngine().account()->setCapabilities({ { "dav", QVariantMap{ { "chunking", "1.0" } } } });
+    auto options = fakeFolder.syncEngine().syncOptions();
+    options._maxChunkSize = chunkSize;
+    options._initialChunkSize = chunkSize;
+    options._minChunkSize = chunkSize;
+    fakeFolder.syncEngine().setSyncOptions(options);
+}
+
+QJsonArray firstSyncAndNoopResync(const NetworkModel &model, const ScenarioFilter &wanted)
+{
+    FakeFolder fakeFolder{ FileInfo{} };
+    const auto items = addBunchOfFiles(fakeFolder.remoteModifier(), QString(), 0, 10, 6, 3);
+
+    QJsonArray results;
+    if (wanted(QStringLiteral("firstSync"))) {
+        Scenario scenario(QStringLiteral("firstSync"), fakeFolder, model);
+        results.append(scenario.run(items));
+    } else if (!fakeFolder.syncOnce()) {
+        qWarning() << "Initial sync for noopResync failed";
+    }
+    if (wanted(QStringLiteral("noopResync"))) {
+        Scenario scenario(QStringLiteral("noopResync"), fakeFolder, model);
+        results.append(scenario.run(items));
+    }
+    return results;
+}
+
+QJsonArray smallUploads(const NetworkModel &model, bool bulk)
+{
+    FakeFolder fakeFolder{ FileInfo{} };
+    if (bulk) {
+        fakeFolder.syncEngine().account()->setCapabilities({ { "dav", QVariantMap{ { "bulkupload", "1.0" } } } });
+    }
+    fakeFolder.localModifier().mkdir(QStringLiteral("small"));
+    const auto items = addBunchOfFiles(fakeFolder.localModifier(), QStringLiteral("small"), 0, 1000, 0, 0, 128);
+
+    Scenario scenario(bulk ? QStringLiteral("smallUploadsBulk") : QStringLiteral("smallUploads"), fakeFolder, model);
+    return { scenario.run(items) };
+}
+
+QJsonArray largeTransfers(const NetworkModel &model, const ScenarioFilter &wanted)
+{
+    constexpr qint64 largeFileSize = 50 * 1000 * 1000;
+
+    FakeFolder fakeFolder{ FileInfo{} };
+    setChunking(fakeFolder, 5 * 1000 * 1000);
+
+    QJsonArray results;
+    if (wanted(QStringLiteral("chunkedUpload"))) {
+        fakeFolder.localModifier().insert(QStringLiteral("upload.bin"), largeFileSize);
+        Scenario scenario(QStringLiteral("chunkedUpload"), fakeFolder, model);
+        results.append(scenario.run(1));
+    }
+    if (wanted(QStringLiteral("largeDownload"))) {
+        fakeFolder.remoteModifier().insert(QStringLiteral("download.bin"), largeFileSize);
+        Scenario scenario(QStringLiteral("largeDownload"), fakeFolder, model);
+        results.append(scenario.run(1));
+    }
+    return results;
+}
+
+QJsonArray subtreeRename(const NetworkModel &model)
+{
+    FakeFolder fakeFolder{ FileInfo{} };
+    fakeFolder.remoteModifier().mkdir(QStringLiteral("tree"));
+    const auto items = addBunchOfFiles(fakeFolder.remoteModifier(), QStringLiteral("tree"), 0, 10, 6, 3);
+    if (!fakeFolder.syncOnce()) {
+        qWarning() << "Initial sync for subtreeRename failed";
+    }
+
+    fakeFolder.localModifier().rename(QStringLiteral("tree"), QStringLiteral("renamedTree"));
+    Scenario scenario(QStringLiteral("subtreeRename"), fakeFolder, model);
+    return { scenario.run(items) };
+}
+
+QJsonArray vfsPlaceholders(const NetworkModel &model)
+{
+    FakeFolder fakeFolder{ FileInfo{} };
+    auto vfs = QSharedPointer<Vfs>(createVfsFromPlugin(Vfs::WithSuffix).release());
+    if (!vfs) {
+        qWarning() << "Suffix vfs plugin is not available, skipping vfsPlaceholders";
+        return {};
+    }
+    fakeFolder.switchToVfs(vfs);
+    fakeFolder.syncJournal().internalPinStates().setForPath("", PinState::Unspecified);
+
+    const auto items = addBunchOfFiles(fakeFolder.remoteModifier(), QString(), 0, 10, 6, 3);
+    Scenario scenario(QStringLiteral("vfsPlaceholders"), fakeFolder, model);
+    return { scenario.run(items) };
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Sync engine benchmark scenarios"));
+    parser.addHelpOption();
+    const QCommandLineOption latencyOption(QStringLiteral("latency"), QStringLiteral("Simulated latency per request in milliseconds."), QStringLiteral("ms"), QStringLiteral("0"));
+    const QCommandLineOption bandwidthOption(QStringLiteral("bandwidth"), QStringLiteral("Simulated bandwidth in bytes per second, 0 for unlimited."), QStringLiteral("bytes"), QStringLiteral("0"));
+    const QCommandLineOption scenarioOption(QStringLiteral("scenario"), QStringLiteral("Only run the scenario with this name, may be given several times."), QStringLiteral("name"));
+    const QCommandLineOption outputOption(QStringLiteral("output"), QStringLiteral("File the JSON report is written to."), QStringLiteral("file"), QStringLiteral("syncscenarios.json"));
+    parser.addOptions({ latencyOption, bandwidthOption, scenarioOption, outputOption });
+    parser.process(app);
+
+    NetworkModel model;
+    model.latencyMs = parser.value(latencyOption).toULongLong();
+    model.bytesPerSecond = parser.value(bandwidthOption).toULongLong();
+    const auto selected = parser.values(scenarioOption);
+    const ScenarioFilter wanted = [&selected](const QString &name) {
+        return selected.isEmpty() || selected.contains(name);
+    };
+
+    // Scenarios that share a setup run in one group
+    const std::vector<std::pair<QStringList, std::function<QJsonArray()>>> groups = {
+        { { QStringLiteral("firstSync"), QStringLiteral("noopResync") }, [&] { return firstSyncAndNoopResync(model, wanted); } },
+        { { QStringLiteral("smallUploads") }, [&] { return smallUploads(model, false); } },
+        { { QStringLiteral("smallUploadsBulk") }, [&] { return smallUploads(model, true); } },
+        { { QStringLiteral("chunkedUpload"), QStringLiteral("largeDownload") }, [&] { return largeTransfers(model, wanted); } },
+        { { QStringLiteral("subtreeRename") }, [&] { return subtreeRename(model); } },
+        { { QStringLiteral("vfsPlaceholders") }, [&] { return vfsPlaceholders(model); } },
+    };
+
+    QStringList known;
+    for (const auto &group : groups) {
+        known += group.first;
+    }
+    for (const auto &name : selected) {
+        if (!known.contains(name)) {
+            qWarning() << "Unknown scenario" << name << "known are" << known;
+            return -1;
+        }
+    }
+
+    QJsonArray results;
+    for (const auto &group : groups) {
+        if (std::none_of(group.first.cbegin(), group.first.cend(), wanted)) {
+            continue;
+        }
+        const auto groupResults = group.second();
+        for (const auto &result : groupResults) {
+            results.append(result);
+        }
+    }
+
+    QJsonObject report;
+    report.insert(QStringLiteral("latencyMs"), static_cast<qint64>(model.latencyMs));
+    report.insert(QStringLiteral("bytesPerSecond"), static_cast<qint64>(model.bytesPerSecond));
+    report.insert(QStringLiteral("results"), results);
+
+    QFile output(parser.value(outputOption));
+    if (!output.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Could not write report to" << output.fileName();
+        return -1;
+    }
+    output.write(QJsonDocument(report).toJson());
+
+    const auto allSucceeded = std::all_of(results.cbegin(), results.cend(), [](const QJsonValue &result) {
+        return result.toObject().value(QStringLiteral("success")).toBool();
+    });
+    return allSucceeded ? 0 : -1;
+}
@@ -383,6 +383,84 @@ qint64 FakePropfindReply::readData(char *data, qint64 maxlen)
     return len;
 }
 
+FakeSearchReply::FakeSearchReply(FileInfo &remoteRootFileInfo, QNetworkAccessManager::Operation op, const QNetworkRequest &request, const QByteArray &body, QObject *parent)
+    : FakeReply { parent }
+{
+    setRequest(request);
+    setUrl(request.url());
+    setOperation(op);
+    open(QIODevice::ReadOnly);
+
+    const auto scopeMatch = QRegularExpression(QStringLiteral("<d:href>/files/([^/<]+)/?([^<]*)</d:href>")).match(QString::fromUtf8(body));
+    const auto literalMatch = QRegularExpression(QStringLiteral("<d:literal>(-?\\d+)</d:literal>")).match(QString::fromUtf8(body));
+    Q_ASSERT(scopeMatch.hasMatch() && literalMatch.hasMatch());
+    const auto modifiedAfter = OCC::Utility::qDateTimeFromTime_t(literalMatch.captured(1).toLongLong());
+    const auto hrefPrefix = request.url().path() + QStringLiteral("files/") + scopeMatch.captured(1);
+
+    const QString davUri { QStringLiteral("DAV:") };
+    QBuffer buffer { &payload };
+    buffer.open(QIODevice::WriteOnly);
+    QXmlStreamWriter xml(&buffer);
+    xml.writeNamespace(davUri, QStringLiteral("d"));
+    xml.writeStartDocument();
+    xml.writeStartElement(davUri, QStringLiteral("multistatus"));
+    std::function<bool(const FileInfo &)> writeModified = [&](const FileInfo &fileInfo) {
+        bool modified = fileInfo.lastModified > modifiedAfter;
+        for (const auto &child : fileInfo.children) {
+            modified = writeModified(child) || modified;
+        }
+        if (!modified) {
+            return false;
+        }
+        xml.writeStartElement(davUri, QStringLiteral("response"));
+        xml.writeTextElement(davUri, QStringLiteral("href"), hrefPrefix + QString::fromUtf8(QUrl::toPercentEncoding(fileInfo.absolutePath(), "/")));
+        xml.writeStartElement(davUri, QStringLiteral("propstat"));
+        xml.writeStartElement(davUri, QStringLiteral("prop"));
+        xml.writeStartElement(davUri, QStringLiteral("resourcetype"));
+        if (fileInfo.isDir) {
+            xml.writeEmptyElement(davUri, QStringLiteral("collection"));
+        }
+        xml.writeEndElement(); // resourcetype
+        xml.writeEndElement(); // prop
+        xml.writeTextElement(davUri, QStringLiteral("status"), QStringLiteral("HTTP/1.1 200 OK"));
+        xml.writeEndElement(); // propstat
+        xml.writeEndElement(); // response
+        return true;
+    };
+    if (const auto scope = remoteRootFileInfo.find(scopeMatch.captured(2))) {
+        writeModified(*scope);
+    }
+    xml.writeEndElement(); // multistatus
+    xml.writeEndDocument();
+
+    QMetaObject::invokeMethod(this, "respond", Qt::QueuedConnection);
+}
+
+void FakeSearchReply::respond()
+{
+    setHeader(QNetworkRequest::ContentLengthHeader, payload.size());
+    setHeader(QNetworkRequest::ContentTypeHeader, QByteArrayLiteral("application/xml; charset=utf-8"));
+    setAttribute(QNetworkRequest::HttpStatusCodeAttribute, 207);
+    setFinished(true);
+    emit metaDataChanged();
+    if (bytesAvailable())
+        emit readyRead();
+    emit finished();
+}
+
+qint64 FakeSearchReply::bytesAvailable() const
+{
+    return payload.size() + QIODevice::bytesAvailable();
+}
+
+qint64 FakeSearchReply::readData(char *data, qint64 maxlen)
+{
+    qint64 len = std::min(qint64 { payload.size() }, maxlen);
+    std::copy(payload.cbegin(), payload.cbegin() + len, data);
+    payload.remove(0, static_cast<int>(len));
+    return len;
+}
+
 FakePutReply::FakePutReply(FileInfo &remoteRootFileInfo, QNetworkAccessManager::Operation op, const QNetworkRequest &request, const QByteArray &putPayload, QObject *parent)
     : FakeReply { parent }
 {
@@ -599,6 +677,83 @@ void FakeMoveReply::respond()
     emit finished();
 }
 
+FakeCopyReply::FakeCopyReply(FileInfo &remoteRootFileInfo, QNetworkAccessManager::Operation op, const QNetworkRequest &request, QObject *parent)
+    : FakeReply { parent }
+{
+    setRequest(request);
+    setUrl(request.url());
+    setOperation(op);
+    open(QIODevice::ReadOnly);
+
+    QString fileName = getFilePathFromUrl(request.url());
+    Q_ASSERT(!fileName.isEmpty());
+    QString dest = getFilePathFromUrl(QUrl::fromEncoded(request.rawHeader("Destination")));
+    Q_ASSERT(!dest.isEmpty());
+
+    const FileInfo *source = remoteRootFileInfo.find(fileName);
+    if (!source || source->isDir) {
+        _httpStatus = 404;
+    } else if (request.hasRawHeader("If-Match") && request.rawHeader("If-Match") != '"' + source->etag + '"') {
+        _httpStatus = 412;
+    } else if (request.rawHeader("Overwrite") == "F" && remoteRootFileInfo.find(dest)) {
+        _httpStatus = 412;
+    } else {
+        const auto size = source->size;
+        const auto contentChar = source->contentChar;
+        const auto lastModified = source->lastModified;
+        const auto checksums = source->checksums;
+        FileInfo *copy = remoteRootFileInfo.create(dest, size, contentChar);
+        copy->lastModified = lastModified;
+        copy->checksums = checksums;
+    }
+    QMetaObject::invokeMethod(this, "respond", Qt::QueuedConnection);
+}
+
+void FakeCopyReply::respond()
+{
+    setAttribute(QNetworkRequest::HttpStatusCodeAttribute, _httpStatus);
+    if (_httpStatus >= 400) {
+        setError(InternalServerError, QStringLiteral("Copy failed"));
+    }
+    emit metaDataChanged();
+    emit finished();
+}
+
+FakeProppatchReply::FakeProppatchReply(FileInfo &remoteRootFileInfo, QNetworkAccessManager::Operation op, const QNetworkRequest &request, const QByteArray &body, QObject *parent)
+    : FakeReply { parent }
+{
+    setRequest(request);
+    setUrl(request.url());
+    setOperation(op);
+    open(QIODevice::ReadOnly);
+
+    QString fileName = getFilePathFromUrl(request.url());
+    Q_ASSERT(!fileName.isNull());
+    if (!remoteRootFileInfo.find(fileName)) {
+        _httpStatus = 404;
+    } else {
+        // Only the modification time is supported
+        QXmlStreamReader reader(body);
+        while (!reader.atEnd()) {
+            if (reader.readNext() == QXmlStreamReader::StartElement && reader.name() == QLatin1String("lastmodified")) {
+                const auto modTime = reader.readElementText().toLongLong();
+                remoteRootFileInfo.setModTime(fileName, QDateTime::fromSecsSinceEpoch(modTime));
+            }
+        }
+    }
+    QMetaObject::invokeMethod(this, "respond", Qt::QueuedConnection);
+}
+
+void FakeProppatchReply::respond()
+{
+    setAttribute(QNetworkRequest::HttpStatusCodeAttribute, _httpStatus);
+    if (_httpStatus >= 400) {
+        setError(ContentNotFoundError, QStringLiteral("Not found"));
+    }
+    emit metaDataChanged();
+    emit finished();
+}
+
 FakeGetReply::FakeGetReply(FileInfo &remoteRootFileInfo, QNetworkAccessManager::Operation op, const QNetworkRequest &request, QObject *parent)
     : FakeReply { parent }
 {
@@ -633,6 +788,7 @@ void FakeGetReply::respond()
     setRawHeader("ETag", fileInfo->etag);
     setRawHeader("OC-FileId", fileInfo->fileId);
     emit metaDataChanged();
+    emit downloadProgress(size, size);
     if (bytesAvailable())
         emit readyRead();
     emit finished();
@@ -981,30 +1137,39 @@ QNetworkReply *FakeQNAM::createRequest(QNetworkAccessManager::Operation op, cons
         auto verb = newRequest.attribute(QNetworkRequest::CustomVerbAttribute);
         if (verb == QLatin1String("PROPFIND")) {
             // Ignore outgoingData always returning somethign good enough, works for now.
-            reply = new FakePropfindReply { info, op, newRequest, this };
+            reply = newReply<FakePropfindReply>(0, info, op, newRequest, this);
         } else if (verb == QLatin1String("GET") || op == QNetworkAccessManager::GetOperation) {
-            reply = new FakeGetReply { info, op, newRequest, this };
+            const auto fileInfo = info.find(getFilePathFromUrl(newRequest.url()));
+            reply = newReply<FakeGetReply>(fileInfo ? fileInfo->size : 0, info, op, newRequest, this);
         } else if (verb == QLatin1String("PUT") || op == QNetworkAccessManager::PutOperation) {
             if (request.hasRawHeader(QByteArrayLiteral("X-OC-Mtime")) &&
                     request.rawHeader(QByteArrayLiteral("X-OC-Mtime")).toLongLong() <= 0) {
                 reply = new FakeErrorReply { op, request, this, 500 };
             } else {
-                reply = new FakePutReply { info, op, newRequest, outgoingData->readAll(), this };
+                const auto putPayload = outgoingData->readAll();
+                reply = newReply<FakePutReply>(putPayload.size(), info, op, newRequest, putPayload, this);
             }
         } else if (verb == QLatin1String("MKCOL")) {
-            reply = new FakeMkcolReply { info, op, newRequest, this };
+            reply = newReply<FakeMkcolReply>(0, info, op, newRequest, this);
         } else if (verb == QLatin1String("DELETE") || op == QNetworkAccessManager::DeleteOperation) {
-            reply = new FakeDeleteReply { info, op, newRequest, this };
+            reply = newReply<FakeDeleteReply>(0, info, op, newRequest, this);
         } else if (verb == QLatin1String("MOVE") && !isUpload) {
-            reply = new FakeMoveReply { info, op, newRequest, this };
+            reply = newReply<FakeMoveReply>(0, info, op, newRequest, this);
+        } else if (verb == QLatin1String("COPY") && !isUpload) {
+            reply = newReply<FakeCopyReply>(0, info, op, newRequest, this);
+        } else if (verb == QLatin1String("PROPPATCH") && !isUpload) {
+            reply = new FakeProppatchReply { info, op, newRequest, outgoingData ? outgoingData->readAll() : QByteArray(), this };
         } else if (verb == QLatin1String("MOVE") && isUpload) {
-            reply = new FakeChunkMoveReply { info, _remoteRootFileInfo, op, newRequest, this };
+            reply = newReply<FakeChunkMoveReply>(0, info, _remoteRootFileInfo, op, newRequest, this);
         } else if (verb == QLatin1String("POST") || op == QNetworkAccessManager::PostOperation) {
             if (contentType.startsWith(QStringLiteral("multipart/related; boundary="))) {
-                reply = new FakePutMultiFileReply { info, op, newRequest, contentType, outgoingData->readAll(), this };
+                const auto postPayload = outgoingData->readAll();
+                reply = newReply<FakePutMultiFileReply>(postPayload.size(), info, op, newRequest, contentType, postPayload, this);
             }
         } else if (verb == QLatin1String("LOCK") || verb == QLatin1String("UNLOCK")) {
             reply = new FakeFileLockReply{info, op, newRequest, this};
+        } else if (verb == QLatin1String("SEARCH")) {
+            reply = newReply<FakeSearchReply>(0, info, op, newRequest, outgoingData ? outgoingData->readAll() : QByteArray(), this);
         } else {
             qDebug() << verb << outgoingData;
             Q_UNREACHABLE();
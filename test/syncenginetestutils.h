@@ -194,7 +194,7 @@ public:
 
     FakePropfindReply(FileInfo &remoteRootFileInfo, QNetworkAccessManager::Operation op, const QNetworkRequest &request, QObject *parent);
 
-    Q_INVOKABLE void respond();
+    Q_INVOKABLE virtual void respond();
 
     Q_INVOKABLE void respond404();
 
@@ -204,6 +204,28 @@ public:
     qint64 readData(char *data, qint64 maxlen) override;
 };
 
+/**
+ * Answers a SEARCH for the items modified after a time, as sent by SearchModifiedItemsJob
+ *
+ * Directories are reported when anything below them was modified, like the
+ * server does by propagating modification times to the parents.
+ */
+class FakeSearchReply : public FakeReply
+{
+    Q_OBJECT
+public:
+    QByteArray payload;
+
+    FakeSearchReply(FileInfo &remoteRootFileInfo, QNetworkAccessManager::Operation op, const QNetworkRequest &request, const QByteArray &body, QObject *parent);
+
+    Q_INVOKABLE void respond();
+
+    void abort() override { }
+
+    qint64 bytesAvailable() const override;
+    qint64 readData(char *data, qint64 maxlen) override;
+};
+
 class FakePutReply : public FakeReply
 {
     Q_OBJECT
@@ -247,7 +269,7 @@ class FakeMkcolReply : public FakeReply
 public:
     FakeMkcolReply(FileInfo &remoteRootFileInfo, QNetworkAccessManager::Operation op, const QNetworkRequest &request, QObject *parent);
 
-    Q_INVOKABLE void respond();
+    Q_INVOKABLE virtual void respond();
 
     void abort() override { }
     qint64 readData(char *, qint64) override { return 0; }
@@ -259,7 +281,7 @@ class FakeDeleteReply : public FakeReply
 public:
     FakeDeleteReply(FileInfo &remoteRootFileInfo, QNetworkAccessManager::Operation op, const QNetworkRequest &request, QObject *parent);
 
-    Q_INVOKABLE void respond();
+    Q_INVOKABLE virtual void respond();
 
     void abort() override { }
     qint64 readData(char *, qint64) override { return 0; }
@@ -271,10 +293,38 @@ class FakeMoveReply : public FakeReply
 public:
     FakeMoveReply(FileInfo &remoteRootFileInfo, QNetworkAccessManager::Operation op, const QNetworkRequest &request, QObject *parent);
 
-    Q_INVOKABLE void respond();
+    Q_INVOKABLE virtual void respond();
+
+    void abort() override { }
+    qint64 readData(char *, qint64) override { return 0; }
+};
+
+class FakeCopyReply : public FakeReply
+{
+    Q_OBJECT
+public:
+    FakeCopyReply(FileInfo &remoteRootFileInfo, QNetworkAccessManager::Operation op, const QNetworkRequest &request, QObject *parent);
+
+    Q_INVOKABLE virtual void respond();
+
+    void abort() override { }
+    qint64 readData(char *, qint64) override { return 0; }
+
+    int _httpStatus = 201;
+};
+
+class FakeProppatchReply : public FakeReply
+{
+    Q_OBJECT
+public:
+    FakeProppatchReply(FileInfo &remoteRootFileInfo, QNetworkAccessManager::Operation op, const QNetworkRequest &request, const QByteArray &body, QObject *parent);
+
+    Q_INVOKABLE virtual void respond();
 
     void abort() override { }
     qint64 readData(char *, qint64) override { return 0; }
+
+    int _httpStatus = 207;
 };
 
 class FakeGetReply : public FakeReply
@@ -288,7 +338,7 @@ public:
 
     FakeGetReply(FileInfo &remoteRootFileInfo, QNetworkAccessManager::Operation op, const QNetworkRequest &request, QObject *parent);
 
-    Q_INVOKABLE void respond();
+    Q_INVOKABLE virtual void respond();
 
     void abort() override;
     qint64 bytesAvailable() const override;
@@ -448,6 +498,9 @@ private:
     QHash<QString, int> _errorPaths;
     // monitor requests and optionally provide custom replies
     Override _override;
+    // simulated network conditions, see setNetworkModel()
+    quint64 _latencyMs = 0;
+    quint64 _bytesPerSecond = 0;
 
 public:
     FakeQNAM(FileInfo initialRoot);
@@ -458,6 +511,17 @@ public:
 
     void setOverride(const Override &override) { _override = override; }
 
+    /**
+     * Delay every default reply by a fixed per-request latency plus the time needed
+     * to transfer its payload at the given bandwidth. A bandwidth of 0 means unlimited.
+     * Replies returned by an override are not affected.
+     */
+    void setNetworkModel(quint64 latencyMs, quint64 bytesPerSecond)
+    {
+        _latencyMs = latencyMs;
+        _bytesPerSecond = bytesPerSecond;
+    }
+
     QJsonObject forEachReplyPart(QIODevice *outgoingData,
                                  const QString &contentType,
                                  std::function<QJsonObject(const QMap<QString, QByteArray> &)> replyFunction);
@@ -465,6 +529,19 @@ public:
     QNetworkReply *overrideReplyWithError(QString fileName, Operation op, QNetworkRequest newRequest);
 
 protected:
+    template <class OriginalReply, typename... Args>
+    QNetworkReply *newReply(qint64 payloadSize, Args &&... args)
+    {
+        if (_latencyMs == 0 && _bytesPerSecond == 0) {
+            return new OriginalReply { std::forward<Args>(args)... };
+        }
+        quint64 delayMs = _latencyMs;
+        if (_bytesPerSecond > 0 && payloadSize > 0) {
+            delayMs += static_cast<quint64>(payloadSize) * 1000 / _bytesPerSecond;
+        }
+        return new DelayedReply<OriginalReply>(delayMs, std::forward<Args>(args)...);
+    }
+
     QNetworkReply *createRequest(Operation op, const QNetworkRequest &request,
         QIODevice *outgoingData = nullptr) override;
 };
@@ -522,6 +599,7 @@ public:
     };
     ErrorList serverErrorPaths() { return {_fakeQnam}; }
     void setServerOverride(const FakeQNAM::Override &override) { _fakeQnam->setOverride(override); }
+    void setNetworkModel(quint64 latencyMs, quint64 bytesPerSecond) { _fakeQnam->setNetworkModel(latencyMs, bytesPerSecond); }
     QJsonObject forEachReplyPart(QIODevice *outgoingData,
                                  const QString &contentType,
                                  std::function<QJsonObject(const QMap<QString, QByteArray>&)> replyFunction) {
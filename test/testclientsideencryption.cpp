@@ -247,6 +247,51 @@ private slots:
         QCOMPARE(generateHash(chunkedOutputDecrypted.readAll()), originalFileHash);
         chunkedOutputDecrypted.close();
     }
+
+    void testFolderMetadataCache()
+    {
+        FolderMetadataCache cache;
+        const FolderMetadataCache::FileNames names{ { QStringLiteral("0a1b2c"), QStringLiteral("report.odt") } };
+        cache.insert("42", "etag1", "metadata1", names);
+
+        // Unchanged folder: no request needed
+        QCOMPARE(*cache.fileNamesForEtag("42", "etag1"), names);
+        QVERIFY(!cache.fileNamesForEtag("42", "etag2"));
+        QVERIFY(!cache.fileNamesForEtag("43", "etag1"));
+
+        // The etag changed because of a change deeper in the tree, the metadata is the same
+        QVERIFY(!cache.fileNamesForMetadata("42", "etag2", "metadata2"));
+        QCOMPARE(*cache.fileNamesForMetadata("42", "etag2", "metadata1"), names);
+        QCOMPARE(*cache.fileNamesForEtag("42", "etag2"), names);
+
+        cache.clear();
+        QCOMPARE(cache.size(), 0);
+        QVERIFY(!cache.fileNamesForEtag("42", "etag2"));
+    }
+
+    void testFolderMetadataCacheLimit()
+    {
+        FolderMetadataCache cache(3);
+        const FolderMetadataCache::FileNames names{ { QStringLiteral("0a1b2c"), QStringLiteral("report.odt") } };
+        cache.insert("1", "etag", "metadata", names);
+        cache.insert("2", "etag", "metadata", names);
+        cache.insert("3", "etag", "metadata", names);
+        QCOMPARE(cache.size(), 3);
+
+        // The least recently used folder goes
+        QVERIFY(cache.fileNamesForEtag("1", "etag"));
+        cache.insert("4", "etag", "metadata", names);
+        QCOMPARE(cache.size(), 3);
+        QVERIFY(cache.fileNamesForEtag("1", "etag"));
+        QVERIFY(!cache.fileNamesForEtag("2", "etag"));
+
+        // Entries are weighed by their number of file names
+        const FolderMetadataCache::FileNames moreNames{ { QStringLiteral("a"), QStringLiteral("a.txt") },
+            { QStringLiteral("b"), QStringLiteral("b.txt") } };
+        cache.insert("5", "etag", "metadata", moreNames);
+        QCOMPARE(cache.size(), 2);
+        QVERIFY(cache.fileNamesForEtag("5", "etag"));
+    }
 };
 
 QTEST_APPLESS_MAIN(TestClientSideEncryption)
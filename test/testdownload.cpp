@@ -9,6 +9,7 @@
 #include "syncenginetestutils.h"
 #include <syncengine.h>
 #include <owncloudpropagator.h>
+#include "filesystem.h"
 
 using namespace OCC;
 
@@ -242,6 +243,64 @@ private slots:
         QCOMPARE(getItem(completeSpy, "A/resendme")->_status, SyncFileItem::NormalError);
         QVERIFY(getItem(completeSpy, "A/resendme")->_errorString.contains(serverMessage));
     }
+
+    void testPreallocationFallback()
+    {
+        // Preallocation failing for other reasons than missing space, like
+        // on filesystems without support, is not an error
+        QTemporaryFile file;
+        QVERIFY(file.open());
+        QFile readOnly(file.fileName());
+        QVERIFY(readOnly.open(QIODevice::ReadOnly));
+        QString error;
+        QVERIFY(FileSystem::preallocate(readOnly, 1000 * 1000, &error));
+        QVERIFY(error.isEmpty());
+        QCOMPARE(readOnly.size(), qint64(0));
+
+        // The reserved blocks don't change the size of the downloaded file
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        fakeFolder.remoteModifier().insert("A/large", 10 * 1000 * 1000);
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(QFileInfo(fakeFolder.localPath() + "A/large").size(), qint64(10 * 1000 * 1000));
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+    }
+
+    void testLocalContentReuse() {
+        FakeFolder fakeFolder{FileInfo::A12_B12_C12_S12()};
+
+        int nGET = 0;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &, QIODevice *) -> QNetworkReply * {
+            if (op == QNetworkAccessManager::GetOperation)
+                ++nGET;
+            return nullptr;
+        });
+
+        const qint64 size = 5000;
+        const auto checksumHeader = QByteArray("SHA1:") + QCryptographicHash::hash(QByteArray(size, 'X'), QCryptographicHash::Sha1).toHex();
+
+        // The upload records the content checksum in the journal
+        fakeFolder.localModifier().insert("A/big", size, 'X');
+        QVERIFY(fakeFolder.syncOnce());
+
+        // The same content appearing remotely is taken from the local file
+        fakeFolder.remoteModifier().insert("B/big", size, 'X');
+        fakeFolder.remoteModifier().find("B/big")->checksums = checksumHeader;
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(nGET, 0);
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+
+        // Local files that changed behind the journal's back fail validation, the content is downloaded
+        for (const auto &path : { QStringLiteral("A/big"), QStringLiteral("B/big") }) {
+            const auto mtime = QFileInfo(fakeFolder.localPath() + path).lastModified();
+            fakeFolder.localModifier().setContents(path, 'Y');
+            fakeFolder.localModifier().setModTime(path, mtime);
+        }
+        fakeFolder.remoteModifier().insert("C/big", size, 'X');
+        fakeFolder.remoteModifier().find("C/big")->checksums = checksumHeader;
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(nGET, 1);
+        QCOMPARE(fakeFolder.currentLocalState().find("C/big")->contentChar, 'X');
+    }
 };
 
 QTEST_GUILESS_MAIN(TestDownload)
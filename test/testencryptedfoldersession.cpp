@@ -0,0 +1,278 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtTest>
+#include "syncenginetestutils.h"
+#include "clientsideencryption.h"
+#include "encryptedfoldersession.h"
+
+using namespace OCC;
+
+namespace {
+
+const QByteArray folderId = QByteArrayLiteral("4711");
+const QByteArray lockToken = QByteArrayLiteral("the-token");
+
+// Only used to encrypt the metadata keys, the private key is never needed
+const QByteArray publicKeyPem = QByteArrayLiteral(
+    "-----BEGIN PUBLIC KEY-----\n"
+    "MIIBIjANBgkqhkiG9w0BAQEFAAOCAQ8AMIIBCgKCAQEA1ughVpmMMwjIZxO60O+9\n"
+    "QZVQV+sLBoOxYjARwn2XyrEqtgy9+rcB+9l8+uxieJv+TmB5u+3Iyq0l5nYJvIfV\n"
+    "OHPeV6ttXM+bUGMSlm9FXjnnP1m0UF8ngW9U8IpfPat3WZQMW95L0cV0QWgWFXxm\n"
+    "TnS+MVRUxoR+ZRihiO4cBak3r5kN4EjgW73A4dK0nyN3XhM01AYEdqm/KVGl0yit\n"
+    "rT0QmTfAHUbgVwWvpR+yPF8YZGHZRBSVa4WGJmuHrzSOSJ+eKVZFOkr5b/f7hvEk\n"
+    "THhod0QIPEh75buaRgoByjYC9DwXLFNei+HJjT78PumB6FR6AM2VNv7h9tF67Nq9\n"
+    "zwIDAQAB\n"
+    "-----END PUBLIC KEY-----\n");
+
+/**
+ * Answers the lock, meta-data and unlock endpoints of the end-to-end
+ * encryption API and records the requests in the order they arrive.
+ */
+class FakeE2eeServer
+{
+public:
+    explicit FakeE2eeServer(FakeFolder &fakeFolder)
+    {
+        fakeFolder.account()->e2e()->_publicKey = QSslKey(publicKeyPem, QSsl::Rsa, QSsl::Pem, QSsl::PublicKey);
+        fakeFolder.setServerOverride([this](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            return handle(op, request);
+        });
+    }
+
+    QStringList requests;
+    int commitsInFlight = 0;
+    int maxCommitsInFlight = 0;
+    bool failCommits = false;
+
+private:
+    QNetworkReply *handle(QNetworkAccessManager::Operation op, const QNetworkRequest &request)
+    {
+        const auto path = request.url().path();
+        const auto token = QUrlQuery(request.url()).queryItemValue(QStringLiteral("e2e-token")).toUtf8();
+
+        if (path.endsWith(QStringLiteral("/lock/") + folderId)) {
+            if (op == QNetworkAccessManager::PostOperation) {
+                requests.append(QStringLiteral("lock"));
+                return new FakePayloadReply(op, request, R"({"ocs":{"data":{"e2e-token":"the-token"}}})", nullptr);
+            }
+            if (op == QNetworkAccessManager::DeleteOperation) {
+                requests.append(request.rawHeader("e2e-token") == lockToken ? QStringLiteral("unlock") : QStringLiteral("unlock without token"));
+                return new FakePayloadReply(op, request, QByteArray(), nullptr);
+            }
+        } else if (path.endsWith(QStringLiteral("/meta-data/") + folderId)) {
+            if (op == QNetworkAccessManager::GetOperation) {
+                requests.append(QStringLiteral("get metadata"));
+                // An empty folder: the first commit creates the metadata
+                return new FakeErrorReply(op, request, nullptr, 404);
+            }
+            if (op == QNetworkAccessManager::PostOperation) {
+                requests.append(QStringLiteral("store metadata"));
+                return commitReply(op, request);
+            }
+            if (op == QNetworkAccessManager::PutOperation) {
+                requests.append(token == lockToken ? QStringLiteral("update metadata") : QStringLiteral("update metadata without token"));
+                return commitReply(op, request);
+            }
+        }
+        return nullptr;
+    }
+
+    QNetworkReply *commitReply(QNetworkAccessManager::Operation op, const QNetworkRequest &request)
+    {
+        maxCommitsInFlight = std::max(maxCommitsInFlight, ++commitsInFlight);
+        QNetworkReply *reply = nullptr;
+        if (failCommits) {
+            reply = new FakeErrorReply(op, request, nullptr, 500);
+        } else {
+            reply = new FakePayloadReply(op, request, QByteArray(), nullptr);
+        }
+        QObject::connect(reply, &QNetworkReply::finished, [this] { --commitsInFlight; });
+        return reply;
+    }
+};
+
+}
+
+class TestEncryptedFolderSession : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testParallelUsersShareOneLock()
+    {
+        FakeFolder fakeFolder{FileInfo{}};
+        FakeE2eeServer server(fakeFolder);
+        EncryptedFolderSession session(fakeFolder.account(), folderId);
+
+        QObject users[3];
+        int acquired = 0;
+        for (auto &user : users) {
+            session.acquire(&user, [&acquired](bool ok) {
+                QVERIFY(ok);
+                ++acquired;
+            });
+        }
+        QTRY_COMPARE(acquired, 3);
+        QCOMPARE(session.token(), lockToken);
+        QVERIFY(session.metadata());
+
+        // A user coming while the folder is locked is served right away
+        QObject lateUser;
+        bool lateAcquired = false;
+        session.acquire(&lateUser, [&lateAcquired](bool ok) { lateAcquired = ok; });
+        QVERIFY(lateAcquired);
+
+        QCOMPARE(server.requests, QStringList({ QStringLiteral("lock"), QStringLiteral("get metadata") }));
+    }
+
+    void testCommitsAreSerialized()
+    {
+        FakeFolder fakeFolder{FileInfo{}};
+        FakeE2eeServer server(fakeFolder);
+        EncryptedFolderSession session(fakeFolder.account(), folderId);
+
+        QObject users[3];
+        int acquired = 0;
+        for (auto &user : users) {
+            session.acquire(&user, [&acquired](bool) { ++acquired; });
+        }
+        QTRY_COMPARE(acquired, 3);
+
+        // Commits made in the same event loop iteration share one request
+        int committed = 0;
+        for (auto &user : users) {
+            session.commitMetadata(&user, [&committed](bool ok) {
+                QVERIFY(ok);
+                ++committed;
+            });
+        }
+        QTRY_VERIFY(server.requests.contains(QStringLiteral("store metadata")));
+
+        // Commits made while one is running wait for it and go out together
+        for (auto &user : users) {
+            session.commitMetadata(&user, [&committed](bool ok) {
+                QVERIFY(ok);
+                ++committed;
+            });
+        }
+        QTRY_COMPARE(committed, 6);
+        QCOMPARE(server.maxCommitsInFlight, 1);
+
+        // The first commit creates the metadata, the next one updates it
+        QCOMPARE(server.requests, QStringList({ QStringLiteral("lock"), QStringLiteral("get metadata"), QStringLiteral("store metadata"), QStringLiteral("update metadata") }));
+    }
+
+    void testUnlockAfterLastUser()
+    {
+        FakeFolder fakeFolder{FileInfo{}};
+        FakeE2eeServer server(fakeFolder);
+        EncryptedFolderSession session(fakeFolder.account(), folderId);
+
+        QObject users[3];
+        int acquired = 0;
+        for (auto &user : users) {
+            session.acquire(&user, [&acquired](bool) { ++acquired; });
+        }
+        QTRY_COMPARE(acquired, 3);
+
+        int released = 0;
+        const auto release = [&](QObject &user) {
+            session.release(&user, [&released](int httpStatus) {
+                QCOMPARE(httpStatus, 200);
+                ++released;
+            });
+        };
+        release(users[0]);
+        release(users[1]);
+        QCOMPARE(released, 2);
+        QVERIFY(session.isLocked());
+
+        // The last user commits and leaves right away: the unlock waits for the commit
+        bool committed = false;
+        session.commitMetadata(&users[2], [&committed](bool ok) { committed = ok; });
+        release(users[2]);
+        QTRY_COMPARE(released, 3);
+        QVERIFY(committed);
+        QVERIFY(!session.isLocked());
+        QVERIFY(session.token().isEmpty());
+
+        QCOMPARE(server.requests, QStringList({ QStringLiteral("lock"), QStringLiteral("get metadata"), QStringLiteral("store metadata"), QStringLiteral("unlock") }));
+
+        // The next user locks the folder again
+        QObject nextUser;
+        bool nextAcquired = false;
+        session.acquire(&nextUser, [&nextAcquired](bool ok) { nextAcquired = ok; });
+        QTRY_VERIFY(nextAcquired);
+        QCOMPARE(server.requests.count(QStringLiteral("lock")), 2);
+    }
+
+    void testUnlockAfterFailedCommit()
+    {
+        FakeFolder fakeFolder{FileInfo{}};
+        FakeE2eeServer server(fakeFolder);
+        server.failCommits = true;
+        EncryptedFolderSession session(fakeFolder.account(), folderId);
+
+        QObject user;
+        bool acquired = false;
+        session.acquire(&user, [&acquired](bool ok) { acquired = ok; });
+        QTRY_VERIFY(acquired);
+
+        bool commitFinished = false;
+        session.commitMetadata(&user, [&commitFinished](bool ok) {
+            QVERIFY(!ok);
+            commitFinished = true;
+        });
+        QTRY_VERIFY(commitFinished);
+
+        bool released = false;
+        session.release(&user, [&released](int) { released = true; });
+        QTRY_VERIFY(released);
+        QVERIFY(!session.isLocked());
+        QCOMPARE(server.requests.last(), QStringLiteral("unlock"));
+    }
+
+    void testUnlockWhenUsersGoAwayWhileLocking()
+    {
+        FakeFolder fakeFolder{FileInfo{}};
+        FakeE2eeServer server(fakeFolder);
+        EncryptedFolderSession session(fakeFolder.account(), folderId);
+
+        // An aborted job is destroyed before the lock arrives and never releases
+        auto user = new QObject;
+        bool acquireCalled = false;
+        session.acquire(user, [&acquireCalled](bool) { acquireCalled = true; });
+        delete user;
+
+        bool unlocked = false;
+        QObject observer;
+        session.whenUnlocked(&observer, [&unlocked] { unlocked = true; });
+        QTRY_VERIFY(unlocked);
+        QVERIFY(!acquireCalled);
+        QCOMPARE(server.requests, QStringList({ QStringLiteral("lock"), QStringLiteral("get metadata"), QStringLiteral("unlock") }));
+    }
+
+    void testUnlockWhenDestroyedWhileLocked()
+    {
+        FakeFolder fakeFolder{FileInfo{}};
+        FakeE2eeServer server(fakeFolder);
+        auto session = new EncryptedFolderSession(fakeFolder.account(), folderId);
+
+        QObject user;
+        bool acquired = false;
+        session->acquire(&user, [&acquired](bool ok) { acquired = ok; });
+        QTRY_VERIFY(acquired);
+
+        // The propagator is gone after an abort, the folder must not stay locked
+        delete session;
+        QTRY_COMPARE(server.requests.count(QStringLiteral("unlock")), 1);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestEncryptedFolderSession)
+#include "testencryptedfoldersession.moc"
@@ -164,6 +164,53 @@ private slots:
         QVERIFY(tracker.localDiscoveryPaths().empty());
     }
 
+    // Check that the tracker state survives a restart and that changes done
+    // while the client wasn't running are found
+    void testTrackerPersistence()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        auto &journal = fakeFolder.syncJournal();
+
+        {
+            LocalDiscoveryTracker tracker;
+            tracker.addTouchedPath("A/a1");
+            tracker.persistToJournal(&journal, true, std::chrono::hours(2));
+        }
+
+        // Changes while the client is not running
+        fakeFolder.localModifier().insert("B/b3");
+        fakeFolder.localModifier().remove("C/c1");
+
+        LocalDiscoveryTracker tracker;
+        auto trackerContains = [&](const char *path) {
+            return tracker.localDiscoveryPaths().find(path) != tracker.localDiscoveryPaths().end();
+        };
+        std::chrono::milliseconds timeSinceLastFullDiscovery{0};
+        QVERIFY(tracker.restoreFromJournal(&journal, fakeFolder.localPath(), &timeSinceLastFullDiscovery));
+        QVERIFY(trackerContains("A/a1"));
+        QVERIFY(trackerContains("B/b3"));
+        QVERIFY(trackerContains("C/c1"));
+        // The restart doesn't postpone the periodic full discovery
+        QVERIFY(timeSinceLastFullDiscovery >= std::chrono::hours(2));
+        QVERIFY(timeSinceLastFullDiscovery < std::chrono::hours(2) + std::chrono::minutes(1));
+
+        fakeFolder.syncEngine().setLocalDiscoveryOptions(LocalDiscoveryStyle::DatabaseAndFilesystem, tracker.localDiscoveryPaths());
+        tracker.startSyncPartialDiscovery();
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+
+        // The saved state is consumed
+        LocalDiscoveryTracker secondTracker;
+        QVERIFY(!secondTracker.restoreFromJournal(&journal, fakeFolder.localPath()));
+
+        // An unreliable watcher keeps the paths, but doesn't allow skipping the full discovery
+        tracker.addTouchedPath("A/a2");
+        tracker.persistToJournal(&journal, false, {});
+        LocalDiscoveryTracker thirdTracker;
+        QVERIFY(!thirdTracker.restoreFromJournal(&journal, fakeFolder.localPath()));
+        QVERIFY(thirdTracker.localDiscoveryPaths().find("A/a2") != thirdTracker.localDiscoveryPaths().end());
+    }
+
     void testDirectoryAndSubDirectory()
     {
         FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
@@ -0,0 +1,140 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtTest>
+#include "localiopool.h"
+
+#include <QSemaphore>
+#include <QThread>
+
+using namespace OCC;
+
+class TestLocalIoPool : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testOrderKeyForPath()
+    {
+        QCOMPARE(LocalIoPool::orderKeyForPath(QStringLiteral("/sync/A/a1")), QStringLiteral("/sync/A"));
+        QCOMPARE(LocalIoPool::orderKeyForPath(QStringLiteral("a1")), QString());
+    }
+
+    void testSameKeyRunsInOrder()
+    {
+        LocalIoPool pool;
+        QObject context;
+        QStringList completed;
+        QAtomicInt running = 0;
+        QAtomicInt overlapped = 0;
+
+        for (int i = 0; i < 10; ++i) {
+            pool.run(QStringLiteral("A"), &context,
+                [i, &running, &overlapped] {
+                    if (running.fetchAndAddOrdered(1) != 0) {
+                        overlapped.storeRelaxed(1);
+                    }
+                    // Later operations would overtake without the ordering
+                    QThread::msleep(10 - i);
+                    running.fetchAndAddOrdered(-1);
+                    return QString::number(i);
+                },
+                [&completed](const QString &result) { completed.append(result); });
+        }
+
+        QTRY_COMPARE(completed.size(), 10);
+        QCOMPARE(overlapped.loadRelaxed(), 0);
+        for (int i = 0; i < 10; ++i) {
+            QCOMPARE(completed.at(i), QString::number(i));
+        }
+    }
+
+    void testCompletionRunsOnPoolThread()
+    {
+        LocalIoPool pool;
+        QObject context;
+        QThread *operationThread = nullptr;
+        QThread *completionThread = nullptr;
+
+        pool.run(QStringLiteral("A"), &context,
+            [&operationThread] {
+                operationThread = QThread::currentThread();
+                return true;
+            },
+            [&completionThread](bool) { completionThread = QThread::currentThread(); });
+
+        QTRY_VERIFY(completionThread);
+        QCOMPARE(completionThread, pool.thread());
+        QVERIFY(operationThread != pool.thread());
+    }
+
+    void testCompletionDroppedForDestroyedContext()
+    {
+        LocalIoPool pool;
+        QObject keeper;
+        auto context = new QObject;
+        bool operationRan = false;
+        bool droppedCompletionRan = false;
+        bool laterCompletionRan = false;
+
+        pool.run(QStringLiteral("A"), context,
+            [&operationRan] {
+                operationRan = true;
+                return true;
+            },
+            [&droppedCompletionRan](bool) { droppedCompletionRan = true; });
+        delete context;
+        // Runs after the first one, so its completion shows that one is through
+        pool.run(QStringLiteral("A"), &keeper,
+            [] { return true; },
+            [&laterCompletionRan](bool) { laterCompletionRan = true; });
+
+        QTRY_VERIFY(laterCompletionRan);
+        QVERIFY(operationRan);
+        QVERIFY(!droppedCompletionRan);
+    }
+
+    void testDestructionDoesNotWaitForRunningOperations()
+    {
+        auto pool = new LocalIoPool;
+        QObject context;
+        QSemaphore unblock;
+        QAtomicInt started = 0;
+        QAtomicInt finished = 0;
+        QAtomicInt queuedOperationRan = 0;
+        bool completionRan = false;
+
+        pool->run(QStringLiteral("A"), &context,
+            [&] {
+                started.storeRelease(1);
+                unblock.acquire();
+                finished.storeRelease(1);
+                return true;
+            },
+            [&completionRan](bool) { completionRan = true; });
+        pool->run(QStringLiteral("A"), &context,
+            [&queuedOperationRan] {
+                queuedOperationRan.storeRelease(1);
+                return true;
+            },
+            [&completionRan](bool) { completionRan = true; });
+        QTRY_VERIFY(started.loadAcquire());
+
+        delete pool;
+        QVERIFY(!finished.loadAcquire());
+
+        unblock.release();
+        QTRY_VERIFY(finished.loadAcquire());
+        // Give a completion that was posted anyway the chance to run
+        QTest::qWait(100);
+        QVERIFY(!completionRan);
+        QVERIFY(!queuedOperationRan.loadAcquire());
+    }
+};
+
+QTEST_GUILESS_MAIN(TestLocalIoPool)
+#include "testlocaliopool.moc"
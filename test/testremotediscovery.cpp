@@ -171,6 +171,77 @@ private slots:
         QVERIFY(completeSpy.findItem("nofileid")->_errorString.contains("file id"));
         QVERIFY(completeSpy.findItem("nopermissions/A")->_errorString.contains("permission"));
     }
+
+    void testRemoteChangeSearch()
+    {
+        FakeFolder fakeFolder{ FileInfo() };
+        fakeFolder.remoteModifier().mkdir("A");
+        fakeFolder.remoteModifier().mkdir("A/B");
+        fakeFolder.remoteModifier().mkdir("A/B/C");
+        fakeFolder.remoteModifier().mkdir("A/B/C/D");
+        fakeFolder.remoteModifier().insert("A/B/C/D/old");
+        fakeFolder.remoteModifier().mkdir("X");
+        fakeFolder.remoteModifier().insert("X/x1");
+        QVERIFY(fakeFolder.syncOnce());
+
+        auto options = fakeFolder.syncEngine().syncOptions();
+        options._remoteChangeSearch = true;
+        fakeFolder.syncEngine().setSyncOptions(options);
+
+        QStringList requests;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &req, QIODevice *) -> QNetworkReply * {
+            const auto verb = req.attribute(QNetworkRequest::CustomVerbAttribute).toString();
+            if (verb != QLatin1String("PROPFIND")) {
+                requests.append(verb);
+                return nullptr;
+            }
+            const auto path = getFilePathFromUrl(req.url());
+            requests.append(QStringLiteral("PROPFIND ") + path);
+            auto reply = new FakePropfindReply(fakeFolder.remoteModifier(), op, req, this);
+            connect(reply, &QNetworkReply::finished, this, [&requests, path] { requests.append(QStringLiteral("DONE ") + path); });
+            return reply;
+        });
+
+        // A change deep in the tree
+        fakeFolder.remoteModifier().insert("A/B/C/D/new");
+        fakeFolder.remoteModifier().setModTime("A/B/C/D/new", QDateTime::currentDateTimeUtc());
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+
+        QCOMPARE(requests.count(QStringLiteral("SEARCH")), 1);
+        // The deepest directory was listed without waiting for the listings of its parents
+        QVERIFY(requests.contains(QStringLiteral("PROPFIND A/B/C/D")));
+        QVERIFY(requests.indexOf(QStringLiteral("PROPFIND A/B/C/D")) < requests.indexOf(QStringLiteral("DONE A/B/C")));
+        // Unchanged directories are not listed
+        QVERIFY(!requests.contains(QStringLiteral("PROPFIND X")));
+    }
+
+    void testRemoteChangeSearchUnsupported()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        QVERIFY(fakeFolder.syncOnce());
+
+        auto options = fakeFolder.syncEngine().syncOptions();
+        options._remoteChangeSearch = true;
+        fakeFolder.syncEngine().setSyncOptions(options);
+
+        int searchRequests = 0;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &req, QIODevice *) -> QNetworkReply * {
+            if (req.attribute(QNetworkRequest::CustomVerbAttribute) == QLatin1String("SEARCH")) {
+                ++searchRequests;
+                return new FakeErrorReply(op, req, this, 405);
+            }
+            return nullptr;
+        });
+
+        // Discovery falls back to the etag walk
+        fakeFolder.remoteModifier().insert("A/a3");
+        fakeFolder.remoteModifier().setModTime("A/a3", QDateTime::currentDateTimeUtc());
+        fakeFolder.remoteModifier().remove("B/b1");
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(searchRequests, 1);
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+    }
 };
 
 QTEST_GUILESS_MAIN(TestRemoteDiscovery)
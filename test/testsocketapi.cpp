@@ -0,0 +1,90 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include "socketapi/socketapi_p.h"
+
+#include <QBuffer>
+#include <QTest>
+
+using namespace OCC;
+
+namespace {
+
+/// Counts the writes that reach the device
+class CountingBuffer : public QBuffer
+{
+public:
+    int writes = 0;
+
+protected:
+    qint64 writeData(const char *data, qint64 len) override
+    {
+        ++writes;
+        return QBuffer::writeData(data, len);
+    }
+};
+
+}
+
+class TestSocketApi : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testMonitoredDirectoriesAging()
+    {
+        MonitoredDirectories directories(2);
+        directories.insert("/sync/a");
+        directories.insert("/sync/b");
+        QVERIFY(directories.contains("/sync/a"));
+        QVERIFY(directories.contains("/sync/b"));
+
+        // Touching a makes b the least recently used one
+        directories.insert("/sync/a");
+        directories.insert("/sync/c");
+        QCOMPARE(directories.size(), 2);
+        QVERIFY(directories.contains("/sync/a"));
+        QVERIFY(!directories.contains("/sync/b"));
+        QVERIFY(directories.contains("/sync/c"));
+
+        // Exact matches only
+        QVERIFY(!directories.contains("/sync"));
+        QVERIFY(!directories.contains("/sync/a/sub"));
+    }
+
+    void testStatusPushesAreCoalesced()
+    {
+        CountingBuffer buffer;
+        buffer.open(QIODevice::ReadWrite);
+        SocketListener listener(&buffer);
+
+        listener.registerMonitoredDirectory("/sync/dir");
+        listener.sendMessageIfDirectoryMonitored("STATUS:SYNC:/sync/dir/a", "/sync/dir");
+        listener.sendMessageIfDirectoryMonitored("STATUS:SYNC:/sync/other/b", "/sync/other");
+        listener.sendMessageIfDirectoryMonitored("STATUS:OK:/sync/dir/c", "/sync/dir");
+        listener.sendMessage("UPDATE_VIEW:/sync");
+        QCOMPARE(buffer.writes, 0);
+
+        QTRY_COMPARE(buffer.writes, 1);
+        QCOMPARE(buffer.data(), QByteArray("STATUS:SYNC:/sync/dir/a\nSTATUS:OK:/sync/dir/c\nUPDATE_VIEW:/sync\n"));
+    }
+
+    void testWaitingMessageFlushesQueue()
+    {
+        CountingBuffer buffer;
+        buffer.open(QIODevice::ReadWrite);
+        SocketListener listener(&buffer);
+
+        listener.sendMessage("STATUS:OK:/sync/a");
+        listener.sendMessage("UNREGISTER_PATH:/sync", true);
+        QCOMPARE(buffer.writes, 1);
+        QCOMPARE(buffer.data(), QByteArray("STATUS:OK:/sync/a\nUNREGISTER_PATH:/sync\n"));
+    }
+};
+
+QTEST_GUILESS_MAIN(TestSocketApi)
+#include "testsocketapi.moc"
@@ -621,6 +621,26 @@ private slots:
         QVERIFY(!dbRecord(fakeFolder, "A/a1").isValid());
         QVERIFY(!dbRecord(fakeFolder, "A").isValid());
     }
+
+    // Files created on both sides are only conflicts if their content differs
+    void testIdenticalContentConflict()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        const qint64 size = 3 * 1000 * 1000;
+        fakeFolder.localModifier().insert("A/same", size, 'X');
+        fakeFolder.remoteModifier().insert("A/same", size, 'X');
+        fakeFolder.localModifier().insert("A/different", size, 'X');
+        fakeFolder.remoteModifier().insert("A/different", size, 'Y');
+
+        ItemCompletedSpy completeSpy(fakeFolder);
+        QVERIFY(fakeFolder.syncOnce());
+
+        QVERIFY(itemSuccessful(completeSpy, "A/same", CSYNC_INSTRUCTION_CONFLICT));
+        QVERIFY(itemConflict(completeSpy, "A/different"));
+        QCOMPARE(findConflicts(fakeFolder.currentLocalState().children["A"]).size(), 1);
+        QVERIFY(expectAndWipeConflict(fakeFolder.localModifier(), fakeFolder.currentLocalState(), "A/different"));
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+    }
 };
 
 QTEST_GUILESS_MAIN(TestSyncConflict)
@@ -9,6 +9,8 @@
 #include "syncenginetestutils.h"
 #include <syncengine.h>
 #include <propagatorjobs.h>
+#include "common/tracer.h"
+#include "httplogger.h"
 
 using namespace OCC;
 
@@ -1243,6 +1245,239 @@ private slots:
         auto expectedState = fakeFolder.currentLocalState();
         QCOMPARE(fakeFolder.currentRemoteState(), expectedState);
     }
+
+    void testProgressCoalescing()
+    {
+        auto countProgressSignals = [](std::chrono::milliseconds interval) {
+            FakeFolder fakeFolder{FileInfo::A12_B12_C12_S12()};
+            auto options = fakeFolder.syncEngine().syncOptions();
+            options._progressUpdateInterval = interval;
+            fakeFolder.syncEngine().setSyncOptions(options);
+
+            int count = 0;
+            bool lastWasDone = false;
+            bool lastWasComplete = false;
+            QObject::connect(&fakeFolder.syncEngine(), &SyncEngine::transmissionProgress, [&](const ProgressInfo &progress) {
+                ++count;
+                lastWasDone = progress.status() == ProgressInfo::Done;
+                lastWasComplete = progress.completedSize() == progress.totalSize()
+                    && progress.completedFiles() == progress.totalFiles();
+            });
+            fakeFolder.localModifier().insert("A/upload1", 300);
+            fakeFolder.localModifier().insert("A/upload2", 300);
+            fakeFolder.remoteModifier().insert("B/download1", 300);
+            fakeFolder.remoteModifier().insert("B/download2", 300);
+            [&] {
+                QVERIFY(fakeFolder.syncOnce());
+                QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+                QVERIFY(lastWasDone);
+                QVERIFY(lastWasComplete);
+            }();
+            return count;
+        };
+
+        const auto everyUpdate = countProgressSignals(std::chrono::milliseconds(0));
+        const auto coalesced = countProgressSignals(std::chrono::hours(1));
+        QVERIFY(coalesced < everyUpdate);
+    }
+
+    void testSyncTrace()
+    {
+        QTemporaryDir dir;
+        const auto traceFile = dir.filePath(QStringLiteral("sync.trace.json"));
+        QVERIFY(Tracer::instance()->start(traceFile));
+
+        FakeFolder fakeFolder{FileInfo::A12_B12_C12_S12()};
+        fakeFolder.localModifier().insert("A/upload", 300);
+        fakeFolder.remoteModifier().insert("B/download", 300);
+        QVERIFY(fakeFolder.syncOnce());
+        Tracer::instance()->stop();
+
+        QFile file(traceFile);
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        QJsonParseError error;
+        const auto trace = QJsonDocument::fromJson(file.readAll(), &error);
+        QCOMPARE(error.error, QJsonParseError::NoError);
+        QVERIFY(trace.isArray());
+
+        QSet<QString> categories;
+        QSet<QString> names;
+        QSet<QString> tracedFiles;
+        for (const auto &value : trace.array()) {
+            const auto event = value.toObject();
+            categories.insert(event.value(QStringLiteral("cat")).toString());
+            names.insert(event.value(QStringLiteral("name")).toString());
+            tracedFiles.insert(event.value(QStringLiteral("args")).toObject().value(QStringLiteral("file")).toString());
+        }
+        for (const auto category : { "sync", "discovery", "propagator", "checksum", "journal" }) {
+            QVERIFY2(categories.contains(QString::fromLatin1(category)), category);
+        }
+        QVERIFY(tracedFiles.contains(QStringLiteral("A/upload")));
+        QVERIFY(tracedFiles.contains(QStringLiteral("B/download")));
+        QVERIFY(names.contains(QStringLiteral("process A")));
+        QVERIFY(names.contains(QStringLiteral("commit")));
+    }
+
+    void testNetworkEventRecorder()
+    {
+        FakeFolder fakeFolder{FileInfo::A12_B12_C12_S12()};
+        NetworkEventRecorder::instance()->clear();
+
+        fakeFolder.localModifier().insert("A/upload", 300);
+        fakeFolder.remoteModifier().insert("A/download", 200);
+        QVERIFY(fakeFolder.syncOnce());
+
+        const auto events = NetworkEventRecorder::instance()->events();
+        const auto put = std::find_if(events.cbegin(), events.cend(), [](const NetworkEventRecorder::Event &event) {
+            return qstrcmp(event.verb, "PUT") == 0;
+        });
+        QVERIFY(put != events.cend());
+        QCOMPARE(put->httpStatus, 200);
+        QCOMPARE(put->requestSize, qint64(300));
+        QVERIFY(qstrlen(put->requestId) > 0);
+        const auto get = std::find_if(events.cbegin(), events.cend(), [](const NetworkEventRecorder::Event &event) {
+            return qstrcmp(event.verb, "GET") == 0;
+        });
+        QVERIFY(get != events.cend());
+        QCOMPARE(get->responseSize, qint64(200));
+        QVERIFY(std::any_of(events.cbegin(), events.cend(), [](const NetworkEventRecorder::Event &event) {
+            return qstrcmp(event.verb, "PROPFIND") == 0;
+        }));
+
+        const auto text = NetworkEventRecorder::instance()->renderText();
+        QVERIFY(text.contains(QByteArray("PUT status=200 sent=300")));
+        QVERIFY(text.contains(QByteArray(put->requestId)));
+    }
+
+    void testPropagationPriorities()
+    {
+        FakeFolder fakeFolder{FileInfo{}};
+        fakeFolder.syncEngine().account()->setCapabilities({ { "dav", QVariantMap{ { "chunking", "1.0" } } } });
+        auto options = fakeFolder.syncEngine().syncOptions();
+        options._initialChunkSize = 1000;
+        fakeFolder.syncEngine().setSyncOptions(options);
+
+        fakeFolder.localModifier().mkdir("A");
+        fakeFolder.localModifier().insert("A/a-large", 2000);
+        fakeFolder.localModifier().insert("A/b-small", 100);
+        fakeFolder.localModifier().insert("A/c-saved", 100);
+        fakeFolder.localModifier().mkdir("B");
+        fakeFolder.localModifier().insert("B/d-small", 100);
+        fakeFolder.localModifier().mkdir("C");
+        fakeFolder.localModifier().insert("C/e-saved", 100);
+
+        // The item paths in the order their uploads started
+        QStringList uploads;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            const auto isChunkUpload = request.url().path().startsWith(sUploadUrl.path());
+            if (op == QNetworkAccessManager::PutOperation && !isChunkUpload) {
+                uploads.append(getFilePathFromUrl(request.url()));
+            } else if (request.attribute(QNetworkRequest::CustomVerbAttribute) == "MKCOL" && isChunkUpload) {
+                // A chunked upload starts by creating a directory named after its transfer id
+                const auto transferId = getFilePathFromUrl(request.url()).section(QLatin1Char('/'), 0, 0).toUInt();
+                for (const auto &file : { QStringLiteral("A/a-large"), QStringLiteral("A/b-small"), QStringLiteral("A/c-saved"), QStringLiteral("B/d-small"), QStringLiteral("C/e-saved") }) {
+                    if (fakeFolder.syncJournal().getUploadInfo(file)._transferid == transferId) {
+                        uploads.append(file);
+                    }
+                }
+            }
+            return nullptr;
+        });
+
+        fakeFolder.syncEngine().setPriorityPaths({ QStringLiteral("A/c-saved"), QStringLiteral("C") });
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QCOMPARE(uploads.size(), 5);
+
+        // Within a directory: interactive first, large transfers last
+        QVERIFY(uploads.indexOf("A/c-saved") < uploads.indexOf("A/b-small"));
+        QVERIFY(uploads.indexOf("A/b-small") < uploads.indexOf("A/a-large"));
+        // Directories with interactive items go before their siblings
+        QVERIFY(uploads.indexOf("C/e-saved") < uploads.indexOf("B/d-small"));
+    }
+
+    void testPropagationPrioritiesKeepRenamedDirectories()
+    {
+        FakeFolder fakeFolder{FileInfo{}};
+        fakeFolder.localModifier().mkdir("B");
+        fakeFolder.localModifier().insert("B/b1");
+        QVERIFY(fakeFolder.syncOnce());
+
+        fakeFolder.localModifier().mkdir("A");
+        fakeFolder.localModifier().insert("A/a1");
+        fakeFolder.localModifier().rename("B", "B2");
+        fakeFolder.localModifier().insert("B2/b-saved");
+
+        QStringList requests;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            const auto verb = request.attribute(QNetworkRequest::CustomVerbAttribute).toString();
+            if (verb == QLatin1String("MKCOL") || verb == QLatin1String("MOVE")) {
+                requests.append(verb + QLatin1Char(' ') + getFilePathFromUrl(request.url()));
+            }
+            return nullptr;
+        });
+
+        // The renamed directory holds an interactive item, but is not moved before its sibling
+        fakeFolder.syncEngine().setPriorityPaths({ QStringLiteral("B2/b-saved") });
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QCOMPARE(requests, QStringList({ QStringLiteral("MKCOL A"), QStringLiteral("MOVE B") }));
+    }
+
+    void testServerSideCopyOfDuplicateUpload()
+    {
+        FakeFolder fakeFolder{FileInfo::A12_B12_C12_S12()};
+        SyncOptions options;
+        options._minServerSideCopySize = 1000;
+        fakeFolder.syncEngine().setSyncOptions(options);
+
+        QObject parent;
+        int nPUT = 0;
+        int nGET = 0;
+        int nCOPY = 0;
+        bool refuseCopy = false;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            if (op == QNetworkAccessManager::PutOperation)
+                ++nPUT;
+            if (op == QNetworkAccessManager::GetOperation)
+                ++nGET;
+            if (request.attribute(QNetworkRequest::CustomVerbAttribute).toString() == QLatin1String("COPY")) {
+                ++nCOPY;
+                if (refuseCopy)
+                    return new FakeErrorReply(op, request, &parent, 412);
+            }
+            return nullptr;
+        });
+
+        fakeFolder.localModifier().insert("A/big", 5000, 'X');
+        fakeFolder.localModifier().insert("A/small", 500, 'Y');
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(nPUT, 2);
+        QCOMPARE(nCOPY, 0);
+
+        // The big duplicate is copied on the server, the small one is uploaded
+        fakeFolder.localModifier().insert("B/big", 5000, 'X');
+        fakeFolder.localModifier().insert("B/small", 500, 'Y');
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(nPUT, 3);
+        QCOMPARE(nCOPY, 1);
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QCOMPARE(fakeFolder.currentRemoteState().find("B/big")->lastModified.toSecsSinceEpoch(),
+            QFileInfo(fakeFolder.localPath() + "B/big").lastModified().toSecsSinceEpoch());
+
+        // The recorded etag matches the server: nothing to do
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(nPUT, 3);
+        QCOMPARE(nGET, 0);
+
+        // A refused copy falls back to a regular upload
+        refuseCopy = true;
+        fakeFolder.localModifier().insert("C/big", 5000, 'X');
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(nPUT, 4);
+        QCOMPARE(nCOPY, 2);
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+    }
 };
 
 QTEST_GUILESS_MAIN(TestSyncEngine)
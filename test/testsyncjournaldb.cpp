@@ -319,6 +319,80 @@ private slots:
         QVERIFY(checkElements());
     }
 
+    void testMoveFileRecordsBelowPath()
+    {
+        auto makeEntry = [&](const QByteArray &path, const QByteArray &fileId) {
+            SyncJournalFileRecord record;
+            record._path = path;
+            record._fileId = fileId;
+            record._remotePerm = RemotePermissions::fromDbValue("RW");
+            QVERIFY(_db.setFileRecord(record));
+        };
+        auto fileIdOf = [&](const QByteArray &path) -> QByteArray {
+            SyncJournalFileRecord record;
+            if (!_db.getFileRecord(path, &record) || !record.isValid()) {
+                return {};
+            }
+            return record._fileId;
+        };
+
+        makeEntry("mvsrc", "1");
+        makeEntry("mvsrc/file", "2");
+        makeEntry("mvsrc/sub", "3");
+        makeEntry("mvsrc/sub/file", "4");
+        makeEntry("mvsrc2/file", "5");
+        makeEntry("mvdst", "6");
+        _db.internalPinStates().setForPath("mvsrc/sub", PinState::OnlineOnly);
+
+        QVERIFY(_db.moveFileRecordsBelowPath("mvsrc", "mvdst"));
+
+        // The directories themselves and similarly named siblings are untouched
+        QCOMPARE(fileIdOf("mvsrc"), QByteArray("1"));
+        QCOMPARE(fileIdOf("mvdst"), QByteArray("6"));
+        QCOMPARE(fileIdOf("mvsrc2/file"), QByteArray("5"));
+
+        QVERIFY(fileIdOf("mvsrc/file").isEmpty());
+        QVERIFY(fileIdOf("mvsrc/sub/file").isEmpty());
+        QCOMPARE(fileIdOf("mvdst/file"), QByteArray("2"));
+        QCOMPARE(fileIdOf("mvdst/sub"), QByteArray("3"));
+        QCOMPARE(fileIdOf("mvdst/sub/file"), QByteArray("4"));
+
+        // The parent hashes were updated too
+        QByteArrayList children;
+        QVERIFY(_db.listFilesInPath("mvdst/sub", [&](const SyncJournalFileRecord &record) { children.append(record._path); }));
+        QCOMPARE(children, QByteArrayList{ "mvdst/sub/file" });
+
+        QCOMPARE(*_db.internalPinStates().rawForPath("mvdst/sub"), PinState::OnlineOnly);
+        QCOMPARE(*_db.internalPinStates().rawForPath("mvsrc/sub"), PinState::Inherited);
+
+        QVERIFY(_db.deleteFileRecord("mvsrc", true));
+        QVERIFY(_db.deleteFileRecord("mvsrc2", true));
+        QVERIFY(_db.deleteFileRecord("mvdst", true));
+        _db.internalPinStates().wipeForPathAndBelow("mvdst");
+    }
+
+    void testInvalidPinStateIgnored()
+    {
+        _db.internalPinStates().setForPath("valid", PinState::OnlineOnly);
+        _db.internalPinStates().setForPath("invalid", PinState::OnlineOnly);
+        _db.close();
+
+        // A corrupt database or one written by a future version
+        {
+            SqlDatabase db;
+            QVERIFY(db.openOrCreateReadWrite(_db.databaseFilePath()));
+            SqlQuery query("UPDATE flags SET pinState = 7 WHERE path = 'invalid';", db);
+            QVERIFY(query.exec());
+        }
+
+        QCOMPARE(*_db.internalPinStates().rawForPath("valid"), PinState::OnlineOnly);
+        QCOMPARE(*_db.internalPinStates().rawForPath("invalid"), PinState::Inherited);
+        QCOMPARE(*_db.internalPinStates().effectiveForPathRecursive(""), PinState::Inherited);
+
+        _db.internalPinStates().wipeForPathAndBelow("valid");
+        _db.internalPinStates().wipeForPathAndBelow("invalid");
+    }
+
     void testPinState()
     {
         auto make = [&](const QByteArray &path, PinState state) {
@@ -433,6 +507,21 @@ private slots:
         QCOMPARE(get("inherit"), PinState::AlwaysLocal);
         QCOMPARE(get("nonexistant"), PinState::AlwaysLocal);
 
+        // Reopening the db reloads the in-memory pin states
+        _db.close();
+        QCOMPARE(getRaw("local/local"), PinState::AlwaysLocal);
+        QCOMPARE(getRaw("inherit"), PinState::Inherited);
+        QCOMPARE(get("online/local/inherit"), PinState::AlwaysLocal);
+        QCOMPARE(getRecursive("local"), PinState::Inherited);
+        QCOMPARE(getRecursive("inherit/online/inherit"), PinState::OnlineOnly);
+
+        // Resetting an explicit state to inherited updates the recursive state
+        make("inherit/online/online", PinState::Inherited);
+        make("inherit/online/local", PinState::Inherited);
+        QCOMPARE(getRecursive("inherit/online"), PinState::OnlineOnly);
+        make("inherit/online/local", PinState::AlwaysLocal);
+        QCOMPARE(getRecursive("inherit/online"), PinState::Inherited);
+
         // Wiping
         QCOMPARE(getRaw("local/local"), PinState::AlwaysLocal);
         _db.internalPinStates().wipeForPathAndBelow("local/local");
@@ -440,6 +529,8 @@ private slots:
         QCOMPARE(getRaw("local/local"), PinState::Inherited);
         QCOMPARE(getRaw("local/local/local"), PinState::Inherited);
         QCOMPARE(getRaw("local/local/online"), PinState::Inherited);
+        QCOMPARE(getRecursive("local/local"), PinState::AlwaysLocal);
+        QCOMPARE(get("local/local/online"), PinState::AlwaysLocal);
         list = _db.internalPinStates().rawList();
         QCOMPARE(list->size(), 4 + 9 + 27 - 4);
 